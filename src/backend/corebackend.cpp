@@ -39,6 +39,12 @@ void CoreBackend::emitScanProgress(const QString& deviceNode, int i)
     Q_EMIT scanProgress(deviceNode, i);
 }
 
+Device* CoreBackend::scanDevice(const QString& deviceNode, const ScanFlags scanFlags)
+{
+    Q_UNUSED(scanFlags)
+    return scanDevice(deviceNode);
+}
+
 void CoreBackend::setPartitionTableForDevice(Device& d, PartitionTable* p)
 {
     d.setPartitionTable(p);
@@ -29,6 +29,8 @@ class QString;
 enum class ScanFlag : uint8_t {
     includeReadOnly = 0x1, /**< devices that are read-only according to the kernel */
     includeLoopback = 0x2,
+    deferFileSystemDetails = 0x4, /**< read used capacity, labels and UUIDs of file systems on first access */
+    useScanCache = 0x8, /**< restore disks that did not change since the last scan from the on-disk ScanCache */
 };
 Q_DECLARE_FLAGS(ScanFlags, ScanFlag)
 Q_DECLARE_OPERATORS_FOR_FLAGS(ScanFlags)
@@ -132,6 +134,15 @@ public:
       */
     virtual Device* scanDevice(const QString& deviceNode) = 0;
 
+    /**
+      * Scan a single device in the system.
+      * @param deviceNode The path to the device that is to be scanned (e.g. /dev/sda)
+      * @param scanFlags only ScanFlag::deferFileSystemDetails applies to a single device
+      * @return a pointer to a Device instance. The caller is responsible for deleting
+      *         this object.
+      */
+    virtual Device* scanDevice(const QString& deviceNode, const ScanFlags scanFlags);
+
     /**
       * Open a device for reading.
       * @param deviceNode The path of the device that is to be opened (e.g. /dev/sda)
@@ -9,10 +9,13 @@
 
 #include "core/device.h"
 #include "core/device_p.h"
+#include "core/partition.h"
 #include "core/partitiontable.h"
 #include "core/smartstatus.h"
+#include "core/raid/mdinspector.h"
 
 #include "util/capacity.h"
+#include "util/sysfsblockdevice.h"
 
 #include <KLocalizedString>
 
@@ -56,6 +59,11 @@ Device::Device(const Device& other)
     d->m_SmartStatus = nullptr;
     d->m_Type = other.d->m_Type;
     d->m_SmartStatus = other.d->m_SmartStatus;
+    d->m_IoAlignment = other.d->m_IoAlignment;
+    d->m_AlignmentOffset = other.d->m_AlignmentOffset;
+    d->m_ZoneModel = other.d->m_ZoneModel;
+    d->m_ZoneSize = other.d->m_ZoneSize;
+    d->m_ZoneCount = other.d->m_ZoneCount;
 
     if (other.d->m_PartitionTable)
         d->m_PartitionTable = new PartitionTable(*other.d->m_PartitionTable);
@@ -146,3 +154,138 @@ Device::Type Device::type() const
 {
     return d->m_Type;
 }
+
+// Larger values reported by the kernel are usually bogus (e.g. 0xfffe00 from some USB bridges)
+static constexpr qint64 maxIoAlignment = 256 * 1024 * 1024;
+
+static qint64 gcd(qint64 a, qint64 b)
+{
+    while (b != 0) {
+        const qint64 t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/** Combines an I/O size with the alignment found so far, ignoring sizes that are not usable. */
+static qint64 combineAlignment(qint64 alignment, qint64 ioSize)
+{
+    if (ioSize <= 0 || (ioSize % alignment != 0 && alignment % ioSize != 0))
+        return alignment;
+
+    const qint64 combined = alignment / gcd(alignment, ioSize) * ioSize;
+    return combined <= maxIoAlignment ? combined : alignment;
+}
+
+/** Reads the I/O limits of the device from /sys/block/<dev>/queue and, for RAID arrays, the stripe size. */
+static void readTopology(DevicePrivate& d)
+{
+    d.m_IoAlignment = 0;
+    d.m_AlignmentOffset = 0;
+    d.m_ZoneModel = Device::ZoneModel::None;
+    d.m_ZoneSize = 0;
+    d.m_ZoneCount = 0;
+
+    const SysfsBlockDevice sysfs(d.m_DeviceNode);
+    if (!sysfs.isValid())
+        return;
+
+    // chunk_sectors is the zone size for zoned devices, always in 512 byte units
+    const QString zoned = sysfs.readAttribute(QStringLiteral("queue/zoned"));
+    const qint64 chunkSectors = sysfs.readAttributeNumber(QStringLiteral("queue/chunk_sectors"), 0);
+    if ((zoned == QStringLiteral("host-aware") || zoned == QStringLiteral("host-managed")) && chunkSectors > 0) {
+        d.m_ZoneModel = zoned == QStringLiteral("host-managed") ? Device::ZoneModel::HostManaged : Device::ZoneModel::HostAware;
+        d.m_ZoneSize = chunkSectors * 512;
+        d.m_ZoneCount = sysfs.readAttributeNumber(QStringLiteral("queue/nr_zones"), 0);
+    }
+
+    qint64 alignment = qMax(qMax(sysfs.logicalSectorSize(), sysfs.physicalSectorSize()), sysfs.readAttributeNumber(QStringLiteral("queue/minimum_io_size")));
+    if (alignment <= 0)
+        return;
+
+    alignment = combineAlignment(alignment, sysfs.readAttributeNumber(QStringLiteral("queue/optimal_io_size")));
+    alignment = combineAlignment(alignment, sysfs.readAttributeNumber(QStringLiteral("queue/discard_granularity")));
+
+    if (d.m_Type == Device::Type::SoftwareRAID_Device) {
+        // A full stripe: chunk size times the number of disks that hold data
+        const auto inspector = MdInspector::current();
+        const MdArray* current = inspector->array(d.m_DeviceNode);
+        const MdArray array = current ? *current : MdInspector::inspect(d.m_DeviceNode);
+        qint64 dataDisks = 0;
+        if (array.level == 0)
+            dataDisks = array.raidDisks;
+        else if (array.level == 4 || array.level == 5)
+            dataDisks = array.raidDisks - 1;
+        else if (array.level == 6)
+            dataDisks = array.raidDisks - 2;
+        else if (array.level == 10)
+            dataDisks = array.raidDisks / 2;
+
+        if (dataDisks > 0 && array.chunkSize > 0)
+            alignment = combineAlignment(alignment, array.chunkSize * dataDisks);
+    }
+
+    d.m_IoAlignment = alignment;
+    d.m_AlignmentOffset = qMax(sysfs.readAttributeNumber(QStringLiteral("alignment_offset"), 0), 0LL);
+}
+
+/** @return preferred I/O alignment in bytes derived from the device's topology, 0 if unknown */
+qint64 Device::ioAlignment() const
+{
+    if (d->m_IoAlignment < 0)
+        readTopology(*d);
+
+    return d->m_IoAlignment;
+}
+
+/** @return number of bytes the device's first naturally aligned sector is offset from sector 0 */
+qint64 Device::alignmentOffset() const
+{
+    if (d->m_IoAlignment < 0)
+        readTopology(*d);
+
+    return d->m_AlignmentOffset;
+}
+
+/** @return the zone model of the device, ZoneModel::None for conventional devices */
+Device::ZoneModel Device::zoneModel() const
+{
+    if (d->m_IoAlignment < 0)
+        readTopology(*d);
+
+    return d->m_ZoneModel;
+}
+
+/** @return size of a zone in bytes, 0 if the device is not zoned */
+qint64 Device::zoneSize() const
+{
+    if (d->m_IoAlignment < 0)
+        readTopology(*d);
+
+    return d->m_ZoneSize;
+}
+
+/** @return number of zones on the device, 0 if the device is not zoned */
+qint64 Device::zoneCount() const
+{
+    if (d->m_IoAlignment < 0)
+        readTopology(*d);
+
+    return d->m_ZoneCount;
+}
+
+/** Reads used capacity, labels and UUIDs of all FileSystems on this Device that were deferred during the scan.
+    @see ScanFlag::deferFileSystemDetails
+*/
+void Device::resolveFileSystems() const
+{
+    if (partitionTable() == nullptr)
+        return;
+
+    for (const auto &p : partitionTable()->children()) {
+        p->fileSystem().resolve();
+        for (const auto &child : p->children())
+            child->fileSystem().resolve();
+    }
+}
@@ -52,6 +52,13 @@ public:
         FakeRAID_Device, /* fake RAID device, i.e. dmraid */
     };
 
+    /** Zone model of the device as reported in /sys/block/<dev>/queue/zoned */
+    enum class ZoneModel {
+        None,
+        HostAware, /* SMR or ZNS device that also accepts random writes */
+        HostManaged, /* sequential zones must be written at their write pointer */
+    };
+
     explicit Device(std::shared_ptr<DevicePrivate> d_ptr, const QString& name, const QString& deviceNode, const qint64 logicalSectorSize, const qint64 totalLogicalSectors, const QString& iconName = QString(), Device::Type type = Device::Type::Disk_Device);
 
 public:
@@ -102,6 +109,18 @@ public:
 
     virtual QString prettyName() const;
 
+    void resolveFileSystems() const;
+
+    qint64 ioAlignment() const;
+    qint64 alignmentOffset() const;
+
+    ZoneModel zoneModel() const;
+    qint64 zoneSize() const;
+    qint64 zoneCount() const;
+    bool isZoned() const { /**< @return true if the device is divided into zones */
+        return zoneModel() != ZoneModel::None;
+    }
+
 protected:
     std::shared_ptr<DevicePrivate> d;
 };
@@ -27,6 +27,11 @@ public:
     QString m_IconName;
     std::shared_ptr<SmartStatus> m_SmartStatus;
     Device::Type m_Type;
+    mutable qint64 m_IoAlignment = -1; // read from sysfs on first use
+    mutable qint64 m_AlignmentOffset = 0;
+    mutable Device::ZoneModel m_ZoneModel = Device::ZoneModel::None;
+    mutable qint64 m_ZoneSize = 0;
+    mutable qint64 m_ZoneCount = 0;
 };
 
 #endif
@@ -0,0 +1,203 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "core/devicemonitor.h"
+
+#include <QByteArray>
+#include <QDebug>
+#include <QFileInfo>
+#include <QHash>
+#include <QSocketNotifier>
+
+#include <cerrno>
+#include <cstring>
+
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// multicast groups of NETLINK_KOBJECT_UEVENT
+static constexpr unsigned int kernelEventGroup = 1;
+static constexpr unsigned int udevEventGroup = 2;
+
+// messages sent by udev start with "libudev\0" followed by this header
+struct UdevMessageHeader
+{
+    char prefix[8];
+    unsigned int magic;
+    unsigned int headerSize;
+    unsigned int propertiesOffset;
+    unsigned int propertiesLength;
+};
+
+struct DeviceMonitorPrivate
+{
+    int m_Socket = -1;
+    QSocketNotifier* m_Notifier = nullptr;
+};
+
+/** Splits KEY=VALUE\0 pairs of a uevent.
+    @param data start of the first pair
+    @param size length of all pairs
+    @return the uevent properties
+*/
+static QHash<QByteArray, QByteArray> parseProperties(const char* data, int size)
+{
+    QHash<QByteArray, QByteArray> properties;
+
+    const QList<QByteArray> lines = QByteArray::fromRawData(data, size).split('\0');
+    for (const auto &line : lines) {
+        const int separator = line.indexOf('=');
+        if (separator > 0)
+            properties.insert(line.left(separator), line.mid(separator + 1));
+    }
+
+    return properties;
+}
+
+/** Parses a uevent message sent either by the kernel or by udev.
+    @param message the received message
+    @return uevent properties or empty hash if message is malformed
+*/
+static QHash<QByteArray, QByteArray> parseUevent(const QByteArray& message)
+{
+    if (message.startsWith(QByteArrayLiteral("libudev"))) {
+        if (message.size() < static_cast<int>(sizeof(UdevMessageHeader)))
+            return {};
+
+        UdevMessageHeader header;
+        std::memcpy(&header, message.constData(), sizeof(header));
+        if (header.propertiesOffset < sizeof(UdevMessageHeader) ||
+            static_cast<qint64>(header.propertiesOffset) + header.propertiesLength > message.size())
+            return {};
+
+        return parseProperties(message.constData() + header.propertiesOffset, header.propertiesLength);
+    }
+
+    // kernel events start with "action@devpath\0"
+    const int headerEnd = message.indexOf('\0');
+    if (headerEnd < 0 || !message.left(headerEnd).contains('@'))
+        return {};
+
+    return parseProperties(message.constData() + headerEnd + 1, message.size() - headerEnd - 1);
+}
+
+DeviceMonitor::DeviceMonitor(QObject* parent) :
+    QObject(parent),
+    d(std::make_unique<DeviceMonitorPrivate>())
+{
+}
+
+DeviceMonitor::~DeviceMonitor()
+{
+    stop();
+}
+
+bool DeviceMonitor::start()
+{
+    if (isActive())
+        return true;
+
+    d->m_Socket = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (d->m_Socket < 0) {
+        qWarning() << "Could not open uevent socket:" << strerror(errno);
+        return false;
+    }
+
+    sockaddr_nl address;
+    std::memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    // Prefer udev events, device nodes and symlinks are already created when they arrive
+    address.nl_groups = QFileInfo::exists(QStringLiteral("/run/udev/control")) ? udevEventGroup : kernelEventGroup;
+
+    if (bind(d->m_Socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        qWarning() << "Could not bind uevent socket:" << strerror(errno);
+        close(d->m_Socket);
+        d->m_Socket = -1;
+        return false;
+    }
+
+    d->m_Notifier = new QSocketNotifier(d->m_Socket, QSocketNotifier::Read, this);
+    connect(d->m_Notifier, &QSocketNotifier::activated, this, &DeviceMonitor::readEvents);
+
+    return true;
+}
+
+void DeviceMonitor::stop()
+{
+    if (!isActive())
+        return;
+
+    delete d->m_Notifier;
+    d->m_Notifier = nullptr;
+    close(d->m_Socket);
+    d->m_Socket = -1;
+}
+
+bool DeviceMonitor::isActive() const
+{
+    return d->m_Socket >= 0;
+}
+
+/** Parses a uevent message sent either by the kernel or by udev.
+    @param message the received message
+    @param deviceNode set to the disk the event is about (e.g. "/dev/sda"), also for events of its partitions
+    @param action set to what happened to the disk
+    @return false if the message is malformed or not about a block device
+*/
+bool DeviceMonitor::parseEvent(const QByteArray& message, QString& deviceNode, Action& action)
+{
+    const auto properties = parseUevent(message);
+    if (properties.value(QByteArrayLiteral("SUBSYSTEM")) != "block")
+        return false;
+
+    const QByteArray devType = properties.value(QByteArrayLiteral("DEVTYPE"));
+    const QByteArray devPath = properties.value(QByteArrayLiteral("DEVPATH"));
+    QString name;
+    if (devType == "disk") {
+        name = QString::fromLocal8Bit(properties.value(QByteArrayLiteral("DEVNAME")));
+        if (name.startsWith(QStringLiteral("/dev/")))
+            name.remove(0, 5);
+    }
+    else if (devType == "partition") {
+        // DEVPATH of a partition is .../block/<disk>/<partition>
+        const QList<QByteArray> components = devPath.split('/');
+        if (components.size() >= 2)
+            name = QString::fromLocal8Bit(components[components.size() - 2]);
+    }
+
+    if (name.isEmpty())
+        return false;
+
+    const QByteArray actionName = properties.value(QByteArrayLiteral("ACTION"));
+    if (devType == "disk" && actionName == "add")
+        action = Action::Add;
+    else if (devType == "disk" && actionName == "remove")
+        action = Action::Remove;
+    else if (actionName == "add" || actionName == "remove" || actionName == "change")
+        action = Action::Change;
+    else
+        return false;
+
+    deviceNode = QStringLiteral("/dev/") + name.replace(QLatin1Char('!'), QLatin1Char('/'));
+    return true;
+}
+
+void DeviceMonitor::readEvents()
+{
+    QByteArray buffer(8192, '\0');
+
+    while (true) {
+        const ssize_t size = recv(d->m_Socket, buffer.data(), buffer.size(), 0);
+        if (size <= 0)
+            break;
+
+        QString deviceNode;
+        Action action;
+        if (parseEvent(QByteArray::fromRawData(buffer.constData(), size), deviceNode, action))
+            Q_EMIT deviceChanged(deviceNode, action);
+    }
+}
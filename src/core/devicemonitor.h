@@ -0,0 +1,64 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_DEVICEMONITOR_H
+#define KPMCORE_DEVICEMONITOR_H
+
+#include "util/libpartitionmanagerexport.h"
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+
+#include <memory>
+
+struct DeviceMonitorPrivate;
+
+/** Watches for block devices being added, removed or changed.
+
+    Listens to uevents on a NETLINK_KOBJECT_UEVENT socket. Events from udev are
+    used if udev is running (device nodes are ready by then), otherwise
+    kernel events are used. Events for partitions are reported for the disk
+    that contains them.
+
+    @author Andrius Štikonas <andrius@stikonas.eu>
+*/
+class LIBKPMCORE_EXPORT DeviceMonitor : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(DeviceMonitor)
+
+public:
+    enum class Action {
+        Add,
+        Remove,
+        Change
+    };
+
+    explicit DeviceMonitor(QObject* parent = nullptr);
+    ~DeviceMonitor() override;
+
+public:
+    bool start(); /**< start listening to uevents; @return true on success */
+    void stop(); /**< stop listening to uevents */
+    bool isActive() const; /**< @return true if monitor is listening to uevents */
+
+    static bool parseEvent(const QByteArray& message, QString& deviceNode, Action& action);
+
+Q_SIGNALS:
+    /**< Emitted for each uevent of a disk or of one of its partitions.
+         @param deviceNode the disk device node (e.g. "/dev/sda")
+         @param action what happened to the device
+    */
+    void deviceChanged(const QString& deviceNode, DeviceMonitor::Action action);
+
+private:
+    void readEvents();
+
+    std::unique_ptr<DeviceMonitorPrivate> d;
+};
+
+#endif
@@ -13,24 +13,128 @@
 
 #include "core/operationstack.h"
 #include "core/device.h"
+#include "core/devicemonitor.h"
 #include "core/diskdevice.h"
+#include "core/lvmreport.h"
+#include "core/partition.h"
+#include "core/partitiontable.h"
+#include "core/raid/mdinspector.h"
 
+#include "fs/filesystem.h"
+#include "fs/luks.h"
 #include "fs/lvm2_pv.h"
 
+#include "ops/operation.h"
+
 #include "util/externalcommand.h"
+#include "util/sysfsblockdevice.h"
 
+#include <QMetaObject>
+#include <QReadLocker>
 #include <QRegularExpression>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QTimer>
+#include <QWriteLocker>
+
+#include <functional>
+
+namespace
+{
+class ResolveFileSystemsRunnable : public QRunnable
+{
+public:
+    explicit ResolveFileSystemsRunnable(const std::function<void()>& function) :
+        m_Function(function)
+    {
+    }
+
+    void run() override {
+        m_Function();
+    }
+
+private:
+    std::function<void()> m_Function;
+};
+
+// Deferred details of the FileSystem on one Partition, read in the background
+struct FileSystemDetails
+{
+    QString partitionNode;
+    const FileSystem* fileSystem;
+    FileSystem::Details details;
+};
+
+QList<Partition*> partitionsOf(Device& d)
+{
+    QList<Partition*> partitions;
+    if (d.partitionTable() == nullptr)
+        return partitions;
+
+    for (const auto &p : d.partitionTable()->children()) {
+        partitions.append(p);
+        for (const auto &child : p->children())
+            partitions.append(child);
+    }
+
+    return partitions;
+}
+
+QList<FileSystemDetails> readFileSystemDetails(Device& d)
+{
+    QList<FileSystemDetails> details;
+    for (const auto &p : partitionsOf(d))
+        if (!p->fileSystem().isResolved())
+            details.append({ p->deviceNode(), &p->fileSystem(), p->fileSystem().readDetails() });
+
+    return details;
+}
+
+// Only FileSystems that are still on the same Partition get the details, operations
+// might have replaced them while they were read.
+void applyFileSystemDetails(Device& d, const QList<FileSystemDetails>& details)
+{
+    for (const auto &p : partitionsOf(d))
+        for (const auto &detail : details)
+            if (p->deviceNode() == detail.partitionNode && &p->fileSystem() == detail.fileSystem)
+                p->fileSystem().applyDetails(detail.details);
+}
+}
 
 /** Constructs a DeviceScanner
     @param ostack the OperationStack where the devices will be created
 */
 DeviceScanner::DeviceScanner(QObject* parent, OperationStack& ostack) :
     QThread(parent),
-    m_OperationStack(ostack)
+    m_OperationStack(ostack),
+    m_DeviceMonitor(nullptr),
+    m_RescanTimer(new QTimer(this)),
+    m_DeferFileSystemDetails(false),
+    m_UseScanCache(false),
+    m_ResolvePool(new QThreadPool(this))
 {
+    // Device changes usually come in bursts (e.g. one event per partition), wait a bit and rescan them together
+    m_RescanTimer->setSingleShot(true);
+    m_RescanTimer->setInterval(500);
+    connect(m_RescanTimer, &QTimer::timeout, this, &DeviceScanner::startRescan);
+    connect(this, &QThread::finished, this, [this] {
+        if (m_DeferFileSystemDetails)
+            resolveFileSystems();
+
+        if (!m_PendingDevices.isEmpty())
+            m_RescanTimer->start();
+    });
+
     setupConnections();
 }
 
+DeviceScanner::~DeviceScanner()
+{
+    // Background reads use the OperationStack and emit our signals
+    m_ResolvePool->clear();
+    m_ResolvePool->waitForDone();
+}
+
 void DeviceScanner::setupConnections()
 {
     connect(CoreBackendManager::self()->backend(), &CoreBackend::scanProgress, this, &DeviceScanner::progress);
@@ -44,16 +148,22 @@ void DeviceScanner::clear()
 
 void DeviceScanner::run()
 {
-    scan();
+    if (m_RescanDevices.isEmpty())
+        scan();
+    else {
+        rescan(m_RescanDevices);
+        m_RescanDevices.clear();
+    }
 }
 
 void DeviceScanner::scan()
 {
     Q_EMIT progress(QString(), 0);
 
+    m_ResolvePool->clear();
     clear();
 
-    const QList<Device*> deviceList = CoreBackendManager::self()->backend()->scanDevices(ScanFlag::includeLoopback);
+    const QList<Device*> deviceList = CoreBackendManager::self()->backend()->scanDevices(scanFlags());
 
     for (const auto &d : deviceList)
         operationStack().addDevice(d);
@@ -61,3 +171,310 @@ void DeviceScanner::scan()
     operationStack().sortDevices();
 }
 
+ScanFlags DeviceScanner::scanFlags() const
+{
+    ScanFlags flags = ScanFlag::includeLoopback;
+    if (m_DeferFileSystemDetails)
+        flags |= ScanFlag::deferFileSystemDetails;
+    if (m_UseScanCache)
+        flags |= ScanFlag::useScanCache;
+
+    return flags;
+}
+
+/** Rescans only the given Devices and updates the OperationStack in place.
+
+    Devices that no longer exist are removed. If one of the Devices is part of a
+    volume manager device (LVM or software RAID), all Devices are scanned again.
+
+    Pending operations are never discarded: Devices that operations refer to
+    are kept as they are, and so are all Devices if a full scan would be needed
+    while there are operations. Such Devices are reported with devicesChanged().
+
+    @param deviceNodes the device nodes of the disks to rescan
+*/
+void DeviceScanner::rescan(const QStringList& deviceNodes)
+{
+    QList<Device*> newDevices;
+    QStringList scannedDevices;
+    QStringList keptDevices;
+    bool fullScan = false;
+
+    // Physical volumes and arrays might have been created or removed
+    LvmReport::invalidate();
+    MdInspector::invalidate();
+
+    for (int i = 0; i < deviceNodes.size() && !fullScan; ++i) {
+        const QString& deviceNode = deviceNodes[i];
+        Q_EMIT progress(deviceNode, i * 100 / deviceNodes.size());
+
+        // Skip scanning Devices that operations refer to, they are checked again below
+        bool needsFullRescan = false;
+        {
+            QReadLocker lockDevices(&operationStack().lock());
+            const Device* oldDevice = findDevice(deviceNode);
+            if (oldDevice && hasOperations(*oldDevice)) {
+                keptDevices.append(deviceNode);
+                continue;
+            }
+            needsFullRescan = needsFullScan(oldDevice);
+        }
+
+        if (needsFullRescan || deviceNode.startsWith(QStringLiteral("/dev/md"))) {
+            fullScan = true;
+            break;
+        }
+
+        Device* newDevice = nullptr;
+        const SysfsBlockDevice sysfsDevice(deviceNode);
+        // Same devices as lsblk lists in a full scan: no empty loop devices, read-only devices or CD drives
+        if (sysfsDevice.isValid() && sysfsDevice.size() > 0 &&
+            sysfsDevice.readAttributeNumber(QStringLiteral("ro"), 0) == 0 &&
+            sysfsDevice.readAttributeNumber(QStringLiteral("device/type"), 0) != 5)
+            newDevice = CoreBackendManager::self()->backend()->scanDevice(deviceNode, m_DeferFileSystemDetails ? ScanFlags(ScanFlag::deferFileSystemDetails) : ScanFlags());
+
+        if (needsFullScan(newDevice)) {
+            delete newDevice;
+            fullScan = true;
+            break;
+        }
+
+        scannedDevices.append(deviceNode);
+        newDevices.append(newDevice);
+    }
+
+    if (fullScan) {
+        qDeleteAll(newDevices);
+        if (!rescanAll())
+            keptDevices = deviceNodes;
+    } else {
+        // Operations are pushed with the write lock held, so none can start to refer
+        // to a Device between the check and its removal
+        QWriteLocker lockDevices(&operationStack().lock());
+        for (int i = 0; i < scannedDevices.size(); ++i) {
+            Device* oldDevice = findDevice(scannedDevices[i]);
+            if (oldDevice && hasOperations(*oldDevice)) {
+                keptDevices.append(scannedDevices[i]);
+                delete newDevices[i];
+                continue;
+            }
+
+            if (oldDevice)
+                operationStack().removeDevice(oldDevice);
+            if (newDevices[i])
+                operationStack().addDevice(newDevices[i]);
+        }
+
+        operationStack().sortDevices();
+    }
+
+    if (!keptDevices.isEmpty())
+        Q_EMIT devicesChanged(keptDevices);
+}
+
+/** Finds a Device of the OperationStack. Must be called with its lock held.
+    @param deviceNode the device node of the Device
+    @return the Device or nullptr if there is none
+*/
+Device* DeviceScanner::findDevice(const QString& deviceNode)
+{
+    for (const auto &d : qAsConst(operationStack().previewDevices()))
+        if (d->deviceNode() == deviceNode)
+            return d;
+
+    return nullptr;
+}
+
+/** @return true if pending operations refer to a Device. Must be called with the lock of the OperationStack held. */
+bool DeviceScanner::hasOperations(const Device& d) const
+{
+    for (const auto &op : qAsConst(operationStack().operations()))
+        if (op->targets(d))
+            return true;
+
+    return false;
+}
+
+/** Replaces all Devices with newly scanned ones unless there are pending operations.
+    @return false if the Devices were kept because of pending operations
+*/
+bool DeviceScanner::rescanAll()
+{
+    // Only saves scanning, operations can still be pushed until the write lock is taken below
+    {
+        QReadLocker lockDevices(&operationStack().lock());
+        if (!operationStack().operations().isEmpty())
+            return false;
+    }
+
+    const QList<Device*> deviceList = CoreBackendManager::self()->backend()->scanDevices(scanFlags());
+
+    // Operations might have been added while scanning
+    QWriteLocker lockDevices(&operationStack().lock());
+    if (!operationStack().operations().isEmpty()) {
+        qDeleteAll(deviceList);
+        return false;
+    }
+
+    m_ResolvePool->clear();
+    operationStack().clearDevices();
+
+    for (const auto &d : deviceList)
+        operationStack().addDevice(d);
+
+    operationStack().sortDevices();
+    return true;
+}
+
+/** Starts watching for added, removed or changed Devices.
+
+    Affected Devices are rescanned in the background. Call start() or scan() first
+    to find the initial list of Devices.
+
+    @return true if device changes can be monitored
+*/
+bool DeviceScanner::startMonitoring()
+{
+    if (!m_DeviceMonitor) {
+        m_DeviceMonitor = new DeviceMonitor(this);
+        connect(m_DeviceMonitor, &DeviceMonitor::deviceChanged, this, &DeviceScanner::deviceChanged);
+    }
+
+    return m_DeviceMonitor->start();
+}
+
+void DeviceScanner::stopMonitoring()
+{
+    if (m_DeviceMonitor)
+        m_DeviceMonitor->stop();
+
+    m_RescanTimer->stop();
+    m_PendingDevices.clear();
+}
+
+void DeviceScanner::setDeferFileSystemDetails(bool defer)
+{
+    m_DeferFileSystemDetails = defer;
+}
+
+void DeviceScanner::setUseScanCache(bool use)
+{
+    m_UseScanCache = use;
+}
+
+/** Reads deferred file system details of all Devices in the background.
+
+    Each Device is read on its own, so results become available one Device at a time,
+    each followed by fileSystemsResolved(). The details are only read in the background
+    and are stored in the FileSystems in the thread that owns them, while the
+    OperationStack is locked for writing.
+*/
+void DeviceScanner::resolveFileSystems()
+{
+    QStringList deviceNodes;
+    {
+        QReadLocker lockDevices(&operationStack().lock());
+        for (const auto &d : qAsConst(operationStack().previewDevices()))
+            deviceNodes.append(d->deviceNode());
+    }
+
+    for (const auto &deviceNode : qAsConst(deviceNodes)) {
+        m_ResolvePool->start(new ResolveFileSystemsRunnable([this, deviceNode] {
+            QList<FileSystemDetails> details;
+            {
+                // Devices might have been rescanned in the meantime, so look them up again.
+                // The read lock keeps their FileSystems alive while they are read.
+                QReadLocker lockDevices(&operationStack().lock());
+                for (const auto &d : qAsConst(operationStack().previewDevices()))
+                    if (d->deviceNode() == deviceNode)
+                        details = readFileSystemDetails(*d);
+            }
+
+            QMetaObject::invokeMethod(this, [this, deviceNode, details] {
+                {
+                    QWriteLocker lockDevices(&operationStack().lock());
+                    if (Device* d = findDevice(deviceNode))
+                        applyFileSystemDetails(*d, details);
+                }
+
+                Q_EMIT fileSystemsResolved(deviceNode);
+            }, Qt::QueuedConnection);
+        }));
+    }
+}
+
+void DeviceScanner::deviceChanged(const QString& deviceNode)
+{
+    // Device mapper devices (LVM logical volumes, LUKS containers) are not shown as disks
+    // and change every time LVs are activated while scanning, so they are not tracked.
+    if (deviceNode.startsWith(QStringLiteral("/dev/dm-")))
+        return;
+
+    if (!m_PendingDevices.contains(deviceNode))
+        m_PendingDevices.append(deviceNode);
+
+    if (!isRunning())
+        m_RescanTimer->start();
+}
+
+void DeviceScanner::startRescan()
+{
+    if (isRunning() || m_PendingDevices.isEmpty())
+        return;
+
+    // Applying operations changes the disks they work on, wait until it is done
+    if (isApplying()) {
+        m_RescanTimer->start();
+        return;
+    }
+
+    m_RescanDevices = m_PendingDevices;
+    m_PendingDevices.clear();
+    start();
+}
+
+/** @return true if an OperationRunner is running operations */
+bool DeviceScanner::isApplying()
+{
+    QReadLocker lockDevices(&operationStack().lock());
+    for (const auto &op : qAsConst(operationStack().operations()))
+        if (op->status() == Operation::StatusRunning)
+            return true;
+
+    return false;
+}
+
+/** Checks if a Device can be rescanned on its own.
+    @param d the Device to check, might be nullptr
+    @return true if a full scan is required
+*/
+bool DeviceScanner::needsFullScan(const Device* d) const
+{
+    if (d == nullptr)
+        return false;
+
+    if (d->type() != Device::Type::Disk_Device)
+        return true;
+
+    if (d->partitionTable() == nullptr)
+        return false;
+
+    // LVM volume groups and RAID arrays built on this disk have to be rescanned as well
+    QList<const Partition*> partitions;
+    for (const auto &p : d->partitionTable()->children()) {
+        partitions.append(p);
+        for (const auto &child : p->children())
+            partitions.append(child);
+    }
+
+    for (const auto &p : qAsConst(partitions)) {
+        const FileSystem* fs = &p->fileSystem();
+        if (p->roles().has(PartitionRole::Luks) && static_cast<const FS::luks*>(fs)->innerFS())
+            fs = static_cast<const FS::luks*>(fs)->innerFS();
+
+        if (fs->type() == FileSystem::Type::Lvm2_PV || fs->type() == FileSystem::Type::LinuxRaidMember)
+            return true;
+    }
+
+    return false;
+}
@@ -10,11 +10,18 @@
 #ifndef KPMCORE_DEVICESCANNER_H
 #define KPMCORE_DEVICESCANNER_H
 
+#include "backend/corebackend.h"
+
 #include "util/libpartitionmanagerexport.h"
 
+#include <QStringList>
 #include <QThread>
 
+class Device;
+class DeviceMonitor;
 class OperationStack;
+class QThreadPool;
+class QTimer;
 
 /** Thread to scan for all available Devices on this computer.
 
@@ -28,14 +35,27 @@ class LIBKPMCORE_EXPORT DeviceScanner : public QThread
 
 public:
     DeviceScanner(QObject* parent, OperationStack& ostack);
+    ~DeviceScanner() override;
 
 public:
     void clear(); /**< clear Devices and the OperationStack */
     void scan(); /**< do the actual scanning; blocks if called directly */
+    void rescan(const QStringList& deviceNodes); /**< rescan only the given Devices; blocks if called directly */
     void setupConnections();
 
+    bool startMonitoring(); /**< rescan Devices in the background when they are added, removed or changed, except while operations are applied */
+    void stopMonitoring(); /**< stop watching for changed Devices */
+
+    /**< @param defer finish scanning after reading the layout and read used capacity, labels and UUIDs in the background */
+    void setDeferFileSystemDetails(bool defer);
+
+    /**< @param use restore unchanged disks from the on-disk ScanCache instead of scanning them */
+    void setUseScanCache(bool use);
+
 Q_SIGNALS:
     void progress(const QString& deviceNode, int progress);
+    void fileSystemsResolved(const QString& deviceNode); /**< deferred file system details of a Device have been read */
+    void devicesChanged(const QStringList& deviceNodes); /**< Devices changed but were kept because of pending operations */
 
 protected:
     void run() override;
@@ -46,8 +66,26 @@ protected:
         return m_OperationStack;
     }
 
+private:
+    void deviceChanged(const QString& deviceNode);
+    void startRescan();
+    bool needsFullScan(const Device* d) const;
+    Device* findDevice(const QString& deviceNode);
+    bool hasOperations(const Device& d) const;
+    bool isApplying();
+    bool rescanAll();
+    ScanFlags scanFlags() const;
+    void resolveFileSystems();
+
 private:
     OperationStack& m_OperationStack;
+    DeviceMonitor* m_DeviceMonitor;
+    QTimer* m_RescanTimer;
+    QStringList m_PendingDevices;
+    QStringList m_RescanDevices;
+    bool m_DeferFileSystemDetails;
+    bool m_UseScanCache;
+    QThreadPool* m_ResolvePool;
 };
 
 #endif
@@ -8,6 +8,8 @@
 */
 
 #include "core/lvmdevice.h"
+#include "core/lvmreport.h"
+#include "core/mounttable.h"
 #include "core/partition.h"
 #include "core/partitiontable.h"
 #include "core/volumemanagerdevice_p.h"
@@ -16,12 +18,16 @@
 #include "fs/luks.h"
 #include "fs/filesystemfactory.h"
 
+#include "util/devicemapper.h"
 #include "util/externalcommand.h"
 #include "util/helpers.h"
 #include "util/globallog.h"
 #include "util/report.h"
 
-#include <QRegularExpression>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QStorageInfo>
 #include <QtMath>
 
@@ -41,8 +47,21 @@ public:
     mutable QStringList m_LVPathList;
     QVector <const Partition*> m_PVs;
     mutable std::unique_ptr<QHash<QString, qint64>> m_LVSizeMap;
+    QHash<QString, qint64> m_LVOffsets; // first sector of each LV in the abstract partition table
 };
 
+/** Runs an lvm command that changes LVM metadata.
+ *
+ *  @param cmd the command to run
+ *  @return true if the command succeeded
+ */
+static bool runModifyingCommand(ExternalCommand& cmd)
+{
+    const bool rval = cmd.run(-1) && cmd.exitCode() == 0;
+    LvmReport::invalidate();
+    return rval;
+}
+
 /** Constructs a representation of LVM device with initialized LV as Partitions
  *
  *  @param vgName Volume Group name
@@ -90,6 +109,15 @@ void LvmDevice::initPartitions()
     qint64 lastUsable  = totalPE() - 1;
     PartitionTable* pTable = new PartitionTable(PartitionTable::vmd, firstUsable, lastUsable);
 
+    // LVs are laid out one after another, so each one starts where the previous ones end
+    d_ptr->m_LVOffsets.clear();
+    qint64 offset = 0;
+    for (const auto &lvPath : partitionNodes()) {
+        d_ptr->m_LVOffsets.insert(lvPath, offset);
+        offset += getTotalLE(lvPath);
+    }
+
+    const MountTable::Scope mountTableScope;
     for (const auto &p : scanPartitions(pTable)) {
         LVSizeMap()->insert(p->partitionPath(), p->length());
         pTable->append(p);
@@ -112,6 +140,14 @@ void LvmDevice::initPartitions()
 const QList<Partition*> LvmDevice::scanPartitions(PartitionTable* pTable) const
 {
     QList<Partition*> pList;
+
+    // Only activate LVs that do not have a device-mapper device yet
+    const DeviceMapper deviceMapper;
+    for (const auto &lvPath : partitionNodes()) {
+        if (!deviceMapper.mapping(lvPath))
+            activateLV(lvPath);
+    }
+
     for (const auto &lvPath : partitionNodes()) {
         Partition *p = scanPartition(lvPath, pTable);
         pList.append(p);
@@ -135,8 +171,6 @@ const QList<Partition*> LvmDevice::scanPartitions(PartitionTable* pTable) const
  */
 Partition* LvmDevice::scanPartition(const QString& lvPath, PartitionTable* pTable) const
 {
-    activateLV(lvPath);
-
     qint64 lvSize = getTotalLE(lvPath);
     qint64 startSector = mappedSector(lvPath, 0);
     qint64 endSector = startSector + lvSize - 1;
@@ -167,15 +201,21 @@ Partition* LvmDevice::scanPartition(const QString& lvPath, PartitionTable* pTabl
             if (logicalSize() > 0 && fs->type() != FileSystem::Type::Luks && mounted && storage.isValid())
                 fs->setSectorsUsed( (storage.bytesTotal() - storage.bytesFree()) / logicalSize() );
         }
-        else if (fs->supportGetUsed() == FileSystem::cmdSupportFileSystem)
-            fs->setSectorsUsed(qCeil(fs->readUsedCapacity(lvPath) / static_cast<double>(logicalSize())));
+        else if (fs->supportGetUsed() != FileSystem::cmdSupportNone) {
+            const qint64 extentSize = logicalSize();
+            fs->setSectorsUsedReader([fs, lvPath, extentSize] {
+                const qint64 used = fs->readUsedCapacity(lvPath);
+                return used < 0 ? -1 : qCeil(used / static_cast<double>(extentSize));
+            });
+        }
    }
 
+    // Unmounted file systems are only read when first needed, see ScanFlag::deferFileSystemDetails
     if (fs->supportGetLabel() != FileSystem::cmdSupportNone) {
-        fs->setLabel(fs->readLabel(lvPath));
+        fs->setLabelReader([fs, lvPath] { return fs->readLabel(lvPath); });
     }
     if (fs->supportGetUUID() != FileSystem::cmdSupportNone)
-        fs->setUUID(fs->readUUID(lvPath));
+        fs->setUUIDReader([fs, lvPath] { return fs->readUUID(lvPath); });
 
     Partition* part = new Partition(pTable,
                     *this,
@@ -223,17 +263,7 @@ void LvmDevice::scanSystemLVM(QList<Device*>& devices)
 
 qint64 LvmDevice::mappedSector(const QString& lvPath, qint64 sector) const
 {
-    qint64 mSector = 0;
-    QStringList lvpathList = partitionNodes();
-    qint32 devIndex = lvpathList.indexOf(lvPath);
-
-    if (devIndex) {
-        for (int i = 0; i < devIndex; i++) {
-            mSector += LVSizeMap()->value(lvpathList[i]);
-        }
-        mSector += sector;
-    }
-    return mSector;
+    return d_ptr->m_LVOffsets.value(lvPath, 0) + sector;
 }
 
 const QStringList LvmDevice::deviceNodes() const
@@ -261,103 +291,60 @@ qint64 LvmDevice::partitionSize(QString& partitionPath) const
 
 const QStringList LvmDevice::getVGs()
 {
-    QStringList vgList;
-    QString output = getField(QStringLiteral("vg_name"));
-    if (!output.isEmpty()) {
-        const QStringList vgNameList = output.split(QLatin1Char('\n'), QString::SkipEmptyParts);
-        for (const auto &vgName : vgNameList) {
-            vgList.append(vgName.trimmed());
-        }
-    }
-    return vgList;
+    return LvmReport::current()->volumeGroups();
 }
 
 const QStringList LvmDevice::getLVs(const QString& vgName)
 {
-    QStringList lvPathList;
-    QString cmdOutput = getField(QStringLiteral("lv_path"), vgName);
-
-    if (cmdOutput.size()) {
-        const QStringList tempPathList = cmdOutput.split(QLatin1Char('\n'), QString::SkipEmptyParts);
-        for (const auto &lvPath : tempPathList) {
-            lvPathList.append(lvPath.trimmed());
-        }
-    }
-    return lvPathList;
+    const auto report = LvmReport::current();
+    const LvmReport::VolumeGroup* vg = report->volumeGroup(vgName);
+    return vg ? vg->logicalVolumes : QStringList();
 }
 
 qint64 LvmDevice::getPeSize(const QString& vgName)
 {
-    QString val = getField(QStringLiteral("vg_extent_size"), vgName);
-    return val.isEmpty() ? -1 : val.toLongLong();
+    const auto report = LvmReport::current();
+    const LvmReport::VolumeGroup* vg = report->volumeGroup(vgName);
+    return vg ? vg->extentSize : -1;
 }
 
 qint64 LvmDevice::getTotalPE(const QString& vgName)
 {
-    QString val = getField(QStringLiteral("vg_extent_count"), vgName);
-    return val.isEmpty() ? -1 : val.toInt();
+    const auto report = LvmReport::current();
+    const LvmReport::VolumeGroup* vg = report->volumeGroup(vgName);
+    return vg ? vg->extentCount : -1;
 }
 
 qint64 LvmDevice::getAllocatedPE(const QString& vgName)
 {
-    return getTotalPE(vgName) - getFreePE(vgName);
+    const auto report = LvmReport::current();
+    const LvmReport::VolumeGroup* vg = report->volumeGroup(vgName);
+    return vg ? vg->extentCount - vg->freeCount : -1;
 }
 
 qint64 LvmDevice::getFreePE(const QString& vgName)
 {
-    QString val =  getField(QStringLiteral("vg_free_count"), vgName);
-    return val.isEmpty() ? -1 : val.toInt();
+    const auto report = LvmReport::current();
+    const LvmReport::VolumeGroup* vg = report->volumeGroup(vgName);
+    return vg ? vg->freeCount : -1;
 }
 
 QString LvmDevice::getUUID(const QString& vgName)
 {
-    QString val = getField(QStringLiteral("vg_uuid"), vgName);
-    return val.isEmpty() ? QStringLiteral("---") : val;
-
-}
-
-/** Get LVM vgs command output with field name
- *
- * @param fieldName LVM field name
- * @param vgName the name of LVM Volume Group
- * @return raw output of command output, usually with many spaces within the returned string
- * */
-
-QString LvmDevice::getField(const QString& fieldName, const QString& vgName)
-{
-    QStringList args = { QStringLiteral("vgs"),
-              QStringLiteral("--foreign"),
-              QStringLiteral("--readonly"),
-              QStringLiteral("--noheadings"),
-              QStringLiteral("--units"),
-              QStringLiteral("B"),
-              QStringLiteral("--nosuffix"),
-              QStringLiteral("--options"),
-              fieldName };
-    if  (!vgName.isEmpty()) {
-        args << vgName;
-    }
-    ExternalCommand cmd(QStringLiteral("lvm"), args, QProcess::ProcessChannelMode::SeparateChannels);
-    if (cmd.run(-1) && cmd.exitCode() == 0) {
-        return cmd.output().trimmed();
-    }
-    return QString();
+    const auto report = LvmReport::current();
+    const LvmReport::VolumeGroup* vg = report->volumeGroup(vgName);
+    return vg && !vg->uuid.isEmpty() ? vg->uuid : QStringLiteral("---");
 }
 
 qint64 LvmDevice::getTotalLE(const QString& lvPath)
 {
-    ExternalCommand cmd(QStringLiteral("lvm"),
-            { QStringLiteral("lvdisplay"),
-              lvPath});
-
-    if (cmd.run(-1) && cmd.exitCode() == 0) {
-        QRegularExpression re(QStringLiteral("Current LE\\h+(\\d+)"));
-        QRegularExpressionMatch match = re.match(cmd.output());
-        if (match.hasMatch()) {
-             return  match.captured(1).toInt();
-        }
-    }
-    Log(Log::Level::error) << xi18nc("@info:status", "An error occurred while running lvdisplay.");
+    const auto report = LvmReport::current();
+    const LvmReport::LogicalVolume* lv = report->logicalVolume(lvPath);
+    const LvmReport::VolumeGroup* vg = lv ? report->volumeGroup(lv->vgName) : nullptr;
+    if (vg && vg->extentSize > 0 && lv->size >= 0)
+        return lv->size / vg->extentSize;
+
+    Log(Log::Level::error) << xi18nc("@info:status", "Could not read the size of logical volume %1.", lvPath);
     return -1;
 }
 
@@ -368,11 +355,10 @@ bool LvmDevice::removeLV(Report& report, LvmDevice& d, Partition& p)
               QStringLiteral("--yes"),
               p.partitionPath()});
 
-    if (cmd.run(-1) && cmd.exitCode() == 0) {
+    const bool rval = runModifyingCommand(cmd);
+    if (rval)
         d.partitionTable()->remove(&p);
-        return  true;
-    }
-    return false;
+    return rval;
 }
 
 bool LvmDevice::createLV(Report& report, LvmDevice& d, Partition& p, const QString& lvName)
@@ -386,7 +372,7 @@ bool LvmDevice::createLV(Report& report, LvmDevice& d, Partition& p, const QStri
               lvName,
               d.name()});
 
-    return (cmd.run(-1) && cmd.exitCode() == 0);
+    return runModifyingCommand(cmd);
 }
 
 bool LvmDevice::createLVSnapshot(Report& report, Partition& p, const QString& name, const qint64 extents)
@@ -402,7 +388,7 @@ bool LvmDevice::createLVSnapshot(Report& report, Partition& p, const QString& na
               QStringLiteral("--name"),
               name,
               p.partitionPath() });
-    return (cmd.run(-1) && cmd.exitCode() == 0);
+    return runModifyingCommand(cmd);
 }
 
 bool LvmDevice::resizeLV(Report& report, Partition& p)
@@ -415,7 +401,7 @@ bool LvmDevice::resizeLV(Report& report, Partition& p)
               QString::number(p.length()),
               p.partitionPath()});
 
-    return (cmd.run(-1) && cmd.exitCode() == 0);
+    return runModifyingCommand(cmd);
 }
 
 bool LvmDevice::removePV(Report& report, LvmDevice& d, const QString& pvPath)
@@ -425,7 +411,7 @@ bool LvmDevice::removePV(Report& report, LvmDevice& d, const QString& pvPath)
               d.name(),
               pvPath});
 
-    return (cmd.run(-1) && cmd.exitCode() == 0);
+    return runModifyingCommand(cmd);
 }
 
 bool LvmDevice::insertPV(Report& report, LvmDevice& d, const QString& pvPath)
@@ -436,22 +422,87 @@ bool LvmDevice::insertPV(Report& report, LvmDevice& d, const QString& pvPath)
               d.name(),
               pvPath});
 
-    return (cmd.run(-1) && cmd.exitCode() == 0);
+    return runModifyingCommand(cmd);
 }
 
-bool LvmDevice::movePV(Report& report, const QString& pvPath, const QStringList& destinations)
+/** Moves allocated extents off a physical volume.
+ *
+ *  @param report report to add command output to
+ *  @param pvPath physical volume to evacuate
+ *  @param destinations physical volumes to move the extents to, any free space in the volume group if empty
+ *  @param background if true, only start an atomic move and let LVM finish it; see movePVProgress()
+ *  @return true if the extents were moved or, in the background, the move was started
+ */
+bool LvmDevice::movePV(Report& report, const QString& pvPath, const QStringList& destinations, bool background)
 {
-    if (FS::lvm2_pv::getAllocatedPE(pvPath) <= 0)
+    // Only name the allocated ranges so that pvmove does not have to scan free extents
+    QStringList ranges;
+    const auto lvmReport = LvmReport::current();
+    for (const auto &segment : lvmReport->physicalVolumeSegments(pvPath))
+        ranges << QStringLiteral("%1-%2").arg(segment.pvExtent).arg(segment.pvExtent + segment.extents - 1);
+
+    if (ranges.isEmpty() && FS::lvm2_pv::getAllocatedPE(pvPath) <= 0)
         return true;
 
     QStringList args = { QStringLiteral("pvmove") };
-    args << pvPath;
+    if (background)
+        args << QStringLiteral("--background") << QStringLiteral("--atomic");
+    args << (QStringList(pvPath) + ranges).join(QLatin1Char(':'));
     if (!destinations.isEmpty())
         for (const auto &destPath : destinations)
             args << destPath.trimmed();
 
     ExternalCommand cmd(report, QStringLiteral("lvm"), args);
-    return (cmd.run(-1) && cmd.exitCode() == 0);
+    return runModifyingCommand(cmd);
+}
+
+/** Reads the progress of running pvmoves.
+ *  @param progress copy percentage of running pvmoves keyed by the canonical path of their source physical volume
+ *  @return false if LVM could not be queried; progress is only complete if true is returned
+ */
+bool LvmDevice::movePVProgress(QHash<QString, int>& progress)
+{
+    progress.clear();
+    ExternalCommand cmd(QStringLiteral("lvm"),
+                        { QStringLiteral("lvs"),
+                          QStringLiteral("--all"),
+                          QStringLiteral("--readonly"),
+                          QStringLiteral("--reportformat"), QStringLiteral("json"),
+                          QStringLiteral("--options"), QStringLiteral("move_pv,copy_percent") },
+                        QProcess::ProcessChannelMode::SeparateChannels);
+    if (!cmd.run(-1) || cmd.exitCode() != 0)
+        return false;
+
+    const QJsonObject json = QJsonDocument::fromJson(cmd.rawOutput()).object();
+    if (!json.contains(QLatin1String("report")))
+        return false;
+
+    const QJsonArray reports = json[QLatin1String("report")].toArray();
+    for (const auto &reportValue : reports) {
+        for (const auto &lvValue : reportValue.toObject()[QLatin1String("lv")].toArray()) {
+            const QJsonObject lv = lvValue.toObject();
+            const QString movePV = lv[QLatin1String("move_pv")].toString();
+            if (!movePV.isEmpty())
+                progress.insert(QFileInfo(movePV).canonicalFilePath(), static_cast<int>(lv[QLatin1String("copy_percent")].toString().toDouble()));
+        }
+    }
+
+    return true;
+}
+
+/** Aborts a running pvmove; atomic moves are rolled back completely.
+ *  @param report report to add command output to
+ *  @param pvPath source physical volume of the move
+ *  @return true if the move was aborted
+ */
+bool LvmDevice::abortMovePV(Report& report, const QString& pvPath)
+{
+    ExternalCommand cmd(report, QStringLiteral("lvm"),
+            { QStringLiteral("pvmove"),
+              QStringLiteral("--abort"),
+              pvPath });
+
+    return runModifyingCommand(cmd);
 }
 
 bool LvmDevice::createVG(Report& report, const QString vgName, const QVector<const Partition*>& pvList, const qint32 peSize)
@@ -467,7 +518,7 @@ bool LvmDevice::createVG(Report& report, const QString vgName, const QVector<con
 
     ExternalCommand cmd(report, QStringLiteral("lvm"), args);
 
-    return (cmd.run(-1) && cmd.exitCode() == 0);
+    return runModifyingCommand(cmd);
 }
 
 bool LvmDevice::removeVG(Report& report, LvmDevice& d)
@@ -477,7 +528,7 @@ bool LvmDevice::removeVG(Report& report, LvmDevice& d)
             { QStringLiteral("vgremove"),
               QStringLiteral("--force"),
               d.name() });
-    return (deactivated && cmd.run(-1) && cmd.exitCode() == 0);
+    return deactivated && runModifyingCommand(cmd);
 }
 
 bool LvmDevice::deactivateVG(Report& report, const LvmDevice& d)
@@ -58,7 +58,6 @@ public:
     static qint64 getAllocatedPE(const QString& vgName);
     static qint64 getFreePE(const QString& vgName);
     static QString getUUID(const QString& vgName);
-    static QString getField(const QString& fieldName, const QString& vgName = QString());
 
     static qint64 getTotalLE(const QString& lvPath);
 
@@ -71,7 +70,9 @@ public:
 
     static bool removePV(Report& report, LvmDevice& d, const QString& pvPath);
     static bool insertPV(Report& report, LvmDevice& d, const QString& pvPath);
-    static bool movePV(Report& report, const QString& pvPath, const QStringList& destinations = QStringList());
+    static bool movePV(Report& report, const QString& pvPath, const QStringList& destinations = QStringList(), bool background = false);
+    static bool movePVProgress(QHash<QString, int>& progress);
+    static bool abortMovePV(Report& report, const QString& pvPath);
 
     static bool removeVG(Report& report, LvmDevice& d);
     static bool createVG(Report& report, const QString vgName, const QVector<const Partition*>& pvList, const qint32 peSize = 4); // peSize in megabytes
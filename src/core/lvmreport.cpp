@@ -0,0 +1,282 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "core/lvmreport.h"
+
+#include "util/externalcommand.h"
+
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegularExpression>
+
+#include <algorithm>
+
+struct LvmReportPrivate
+{
+    bool m_Valid = false;
+    QStringList m_VolumeGroupNames;
+    QHash<QString, LvmReport::VolumeGroup> m_VolumeGroups;
+    QHash<QString, LvmReport::PhysicalVolume> m_PhysicalVolumes;
+    QHash<QString, QString> m_PhysicalVolumeAliases; // canonical device path -> pv_name
+    QHash<QString, LvmReport::LogicalVolume> m_LogicalVolumes;
+    QHash<QString, QVector<LvmReport::Segment>> m_PvSegments; // sorted by pvExtent
+
+    void parse(const QByteArray& fullReport);
+    QString physicalVolumePath(const QString& deviceNode) const;
+};
+
+static QMutex s_CurrentMutex;
+static std::shared_ptr<const LvmReport> s_Current;
+
+/** @return a numeric field reported with --units b --nosuffix or -1 if it is missing */
+static qint64 number(const QJsonObject& object, const QString& field)
+{
+    bool ok = false;
+    const qint64 value = object[field].toString().toLongLong(&ok);
+    return ok ? value : -1;
+}
+
+/** @return LV name without the brackets LVM puts around hidden volumes */
+static QString visibleName(const QString& name)
+{
+    return name.startsWith(QLatin1Char('[')) && name.endsWith(QLatin1Char(']')) ? name.mid(1, name.size() - 2) : name;
+}
+
+/** Parses seg_pe_ranges, e.g. "/dev/sda2:0-255 /dev/sdb1:0-255" (ranges on sub-volumes are skipped)
+    @return list of (physical volume, first extent, number of extents) */
+static QVector<LvmReport::Segment> physicalRanges(const QJsonValue& value)
+{
+    QStringList items;
+    if (value.isArray())
+        for (const auto &item : value.toArray())
+            items << item.toString();
+    else
+        items = value.toString().split(QRegularExpression(QStringLiteral("[\\s,]+")), QString::SkipEmptyParts);
+
+    QVector<LvmReport::Segment> ranges;
+    for (const auto &item : qAsConst(items)) {
+        const int colon = item.lastIndexOf(QLatin1Char(':'));
+        const QStringList bounds = item.mid(colon + 1).split(QLatin1Char('-'));
+        if (colon < 0 || !item.startsWith(QLatin1Char('/')) || bounds.size() != 2)
+            continue;
+
+        LvmReport::Segment range;
+        range.pvPath = item.left(colon);
+        range.pvExtent = bounds[0].toLongLong();
+        range.extents = bounds[1].toLongLong() - range.pvExtent + 1;
+        ranges.append(range);
+    }
+
+    return ranges;
+}
+
+LvmReport::LvmReport() :
+    d(std::make_unique<LvmReportPrivate>())
+{
+    ExternalCommand cmd(QStringLiteral("lvm"),
+                        { QStringLiteral("fullreport"),
+                          QStringLiteral("--foreign"),
+                          QStringLiteral("--readonly"),
+                          QStringLiteral("--reportformat"), QStringLiteral("json"),
+                          QStringLiteral("--units"), QStringLiteral("b"),
+                          QStringLiteral("--nosuffix"),
+                          QStringLiteral("--configreport"), QStringLiteral("vg"), QStringLiteral("--options"),
+                          QStringLiteral("vg_name,vg_uuid,vg_extent_size,vg_extent_count,vg_free_count"),
+                          QStringLiteral("--configreport"), QStringLiteral("pv"), QStringLiteral("--options"),
+                          QStringLiteral("pv_name,pv_uuid,pv_pe_count,pv_pe_alloc_count,pe_start,pv_used"),
+                          QStringLiteral("--configreport"), QStringLiteral("lv"), QStringLiteral("--options"),
+                          QStringLiteral("lv_path,lv_name,lv_uuid,lv_size,lv_parent"),
+                          QStringLiteral("--configreport"), QStringLiteral("seg"), QStringLiteral("--options"),
+                          QStringLiteral("lv_uuid,seg_pe_ranges") },
+                        QProcess::ProcessChannelMode::SeparateChannels);
+
+    if (cmd.run(-1) && cmd.exitCode() == 0)
+        d->parse(cmd.rawOutput());
+}
+
+/** @param fullReport output of "lvm fullreport --reportformat json" with the fields that LvmReport() asks for */
+LvmReport::LvmReport(const QByteArray& fullReport) :
+    d(std::make_unique<LvmReportPrivate>())
+{
+    d->parse(fullReport);
+}
+
+void LvmReportPrivate::parse(const QByteArray& fullReport)
+{
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(fullReport, &error);
+    if (error.error != QJsonParseError::NoError)
+        return;
+
+    m_Valid = true;
+
+    // One report per volume group and one for physical volumes without a volume group
+    const QJsonArray reports = document.object()[QLatin1String("report")].toArray();
+    for (const auto &reportValue : reports) {
+        const QJsonObject report = reportValue.toObject();
+
+        LvmReport::VolumeGroup vg;
+        const QJsonArray vgs = report[QLatin1String("vg")].toArray();
+        if (!vgs.isEmpty()) {
+            const QJsonObject vgObject = vgs.first().toObject();
+            vg.name = vgObject[QLatin1String("vg_name")].toString();
+            vg.uuid = vgObject[QLatin1String("vg_uuid")].toString();
+            vg.extentSize = number(vgObject, QStringLiteral("vg_extent_size"));
+            vg.extentCount = number(vgObject, QStringLiteral("vg_extent_count"));
+            vg.freeCount = number(vgObject, QStringLiteral("vg_free_count"));
+        }
+
+        for (const auto &pvValue : report[QLatin1String("pv")].toArray()) {
+            const QJsonObject pvObject = pvValue.toObject();
+            LvmReport::PhysicalVolume pv;
+            pv.path = pvObject[QLatin1String("pv_name")].toString();
+            pv.uuid = pvObject[QLatin1String("pv_uuid")].toString();
+            pv.vgName = vg.name;
+            pv.extentCount = number(pvObject, QStringLiteral("pv_pe_count"));
+            pv.allocatedExtents = number(pvObject, QStringLiteral("pv_pe_alloc_count"));
+            pv.extentStart = number(pvObject, QStringLiteral("pe_start"));
+            pv.used = number(pvObject, QStringLiteral("pv_used"));
+            pv.extentSize = vg.extentSize;
+
+            const QString canonicalPath = QFileInfo(pv.path).canonicalFilePath();
+            if (!canonicalPath.isEmpty() && canonicalPath != pv.path)
+                m_PhysicalVolumeAliases.insert(canonicalPath, pv.path);
+            m_PhysicalVolumes.insert(pv.path, pv);
+        }
+
+        if (vg.name.isEmpty())
+            continue;
+
+        // Sub-volumes (RAID images, thin pool data, ...) are attributed to their top level volume.
+        // Top level volumes without a path (thin pools, pool metadata spares) are kept under the
+        // path they would have, so that the extents they use are not missing from the report.
+        QHash<QString, QString> lvPaths;    // name -> path of top level volumes
+        QHash<QString, QString> lvParents;  // name -> parent name of sub-volumes
+        QHash<QString, QString> lvNames;    // uuid -> name
+        for (const auto &lvValue : report[QLatin1String("lv")].toArray()) {
+            const QJsonObject lvObject = lvValue.toObject();
+            const QString name = visibleName(lvObject[QLatin1String("lv_name")].toString());
+            const QString parent = visibleName(lvObject[QLatin1String("lv_parent")].toString());
+            QString path = lvObject[QLatin1String("lv_path")].toString();
+            lvNames.insert(lvObject[QLatin1String("lv_uuid")].toString(), name);
+            if (path.isEmpty() && !parent.isEmpty()) {
+                lvParents.insert(name, parent);
+                continue;
+            }
+
+            LvmReport::LogicalVolume lv;
+            lv.hasPath = !path.isEmpty();
+            lv.path = lv.hasPath ? path : QStringLiteral("/dev/%1/%2").arg(vg.name, name);
+            lv.name = name;
+            lv.uuid = lvObject[QLatin1String("lv_uuid")].toString();
+            lv.vgName = vg.name;
+            lv.size = number(lvObject, QStringLiteral("lv_size"));
+
+            lvPaths.insert(name, lv.path);
+            if (lv.hasPath)
+                vg.logicalVolumes.append(lv.path);
+            m_LogicalVolumes.insert(lv.path, lv);
+        }
+
+        for (const auto &segValue : report[QLatin1String("seg")].toArray()) {
+            const QJsonObject segObject = segValue.toObject();
+            QString name = lvNames.value(segObject[QLatin1String("lv_uuid")].toString());
+            for (int depth = 0; !lvPaths.contains(name) && lvParents.contains(name) && depth < 8; ++depth)
+                name = lvParents.value(name);
+
+            const QString lvPath = lvPaths.value(name);
+            if (lvPath.isEmpty())
+                continue;
+
+            for (auto &range : physicalRanges(segObject[QLatin1String("seg_pe_ranges")])) {
+                range.lvPath = lvPath;
+                m_PvSegments[range.pvPath].append(range);
+            }
+        }
+
+        m_VolumeGroupNames.append(vg.name);
+        m_VolumeGroups.insert(vg.name, vg);
+    }
+
+    for (auto &segments : m_PvSegments)
+        std::sort(segments.begin(), segments.end(), [] (const LvmReport::Segment& a, const LvmReport::Segment& b) { return a.pvExtent < b.pvExtent; });
+}
+
+LvmReport::~LvmReport()
+{
+}
+
+bool LvmReport::isValid() const
+{
+    return d->m_Valid;
+}
+
+/** @return names of all volume groups */
+QStringList LvmReport::volumeGroups() const
+{
+    return d->m_VolumeGroupNames;
+}
+
+/** @return the volume group or nullptr if there is no such volume group */
+const LvmReport::VolumeGroup* LvmReport::volumeGroup(const QString& name) const
+{
+    const auto it = d->m_VolumeGroups.constFind(name);
+    return it == d->m_VolumeGroups.constEnd() ? nullptr : &it.value();
+}
+
+/** @param deviceNode device node of the physical volume, symbolic links (e.g. in /dev/mapper) are resolved
+    @return the physical volume or nullptr if the device is not a physical volume */
+const LvmReport::PhysicalVolume* LvmReport::physicalVolume(const QString& deviceNode) const
+{
+    const auto it = d->m_PhysicalVolumes.constFind(d->physicalVolumePath(deviceNode));
+    return it == d->m_PhysicalVolumes.constEnd() ? nullptr : &it.value();
+}
+
+/** @return the name LVM uses for a physical volume, resolving symbolic links if needed */
+QString LvmReportPrivate::physicalVolumePath(const QString& deviceNode) const
+{
+    if (m_PhysicalVolumes.contains(deviceNode))
+        return deviceNode;
+
+    const QString canonicalPath = QFileInfo(deviceNode).canonicalFilePath();
+    return m_PhysicalVolumeAliases.value(canonicalPath, canonicalPath);
+}
+
+/** @return the logical volume or nullptr if there is no such logical volume */
+const LvmReport::LogicalVolume* LvmReport::logicalVolume(const QString& lvPath) const
+{
+    const auto it = d->m_LogicalVolumes.constFind(lvPath);
+    return it == d->m_LogicalVolumes.constEnd() ? nullptr : &it.value();
+}
+
+/** @return allocated segments of a physical volume ordered by their first extent */
+QVector<LvmReport::Segment> LvmReport::physicalVolumeSegments(const QString& deviceNode) const
+{
+    return d->m_PvSegments.value(d->physicalVolumePath(deviceNode));
+}
+
+/** @return the current snapshot, lvm is only run if there is none since the last invalidate() */
+std::shared_ptr<const LvmReport> LvmReport::current()
+{
+    QMutexLocker locker(&s_CurrentMutex);
+    if (!s_Current)
+        s_Current = std::make_shared<const LvmReport>();
+
+    return s_Current;
+}
+
+/** Drops the current snapshot, e.g. after LVM metadata was changed. */
+void LvmReport::invalidate()
+{
+    QMutexLocker locker(&s_CurrentMutex);
+    s_Current.reset();
+}
@@ -0,0 +1,101 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_LVMREPORT_H
+#define KPMCORE_LVMREPORT_H
+
+#include "util/libpartitionmanagerexport.h"
+
+#include <memory>
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QtGlobal>
+
+struct LvmReportPrivate;
+
+/** Snapshot of all LVM volume groups, physical and logical volumes.
+
+    Reads everything with a single "lvm fullreport" instead of running vgs,
+    pvs or lvs for every field of every volume group. The snapshot is shared
+    by all callers until invalidate() is called, which is done at the start
+    of each device scan and after every command that changes LVM metadata.
+
+    Segments are indexed by physical volume, so that pvmove can be given
+    only the ranges that are allocated.
+
+    @author Andrius Štikonas <andrius@stikonas.eu>
+*/
+class LIBKPMCORE_EXPORT LvmReport
+{
+    Q_DISABLE_COPY(LvmReport)
+
+public:
+    struct VolumeGroup
+    {
+        QString name;
+        QString uuid;
+        qint64 extentSize = -1;
+        qint64 extentCount = -1;
+        qint64 freeCount = -1;
+        QStringList logicalVolumes; /**< paths of logical volumes in the order LVM reports them */
+    };
+
+    struct PhysicalVolume
+    {
+        QString path;
+        QString uuid;
+        QString vgName; /**< empty for physical volumes that are not in a volume group */
+        qint64 extentCount = -1;
+        qint64 allocatedExtents = -1;
+        qint64 extentStart = -1; /**< offset of the first extent in bytes */
+        qint64 used = -1;
+        qint64 extentSize = -1;
+    };
+
+    struct LogicalVolume
+    {
+        QString path; /**< /dev/<vg>/<name> for volumes LVM reports without a path, e.g. thin pools */
+        QString name;
+        QString uuid;
+        QString vgName;
+        qint64 size = -1;
+        bool hasPath = true; /**< false for volumes without a device node, they are not in VolumeGroup::logicalVolumes */
+    };
+
+    /** A contiguous range of extents on a physical volume that belongs to a logical volume. */
+    struct Segment
+    {
+        QString lvPath; /**< top level logical volume, also for segments of its sub-volumes */
+        qint64 extents = 0;
+        QString pvPath;
+        qint64 pvExtent = -1; /**< first extent on the physical volume */
+    };
+
+    LvmReport();
+    explicit LvmReport(const QByteArray& fullReport);
+    ~LvmReport();
+
+public:
+    bool isValid() const; /**< @return true if the report could be read */
+
+    QStringList volumeGroups() const;
+    const VolumeGroup* volumeGroup(const QString& name) const;
+    const PhysicalVolume* physicalVolume(const QString& deviceNode) const;
+    const LogicalVolume* logicalVolume(const QString& lvPath) const;
+
+    QVector<Segment> physicalVolumeSegments(const QString& deviceNode) const;
+
+    static std::shared_ptr<const LvmReport> current();
+    static void invalidate();
+
+private:
+    std::unique_ptr<LvmReportPrivate> d;
+};
+
+#endif
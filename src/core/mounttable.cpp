@@ -0,0 +1,168 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "core/mounttable.h"
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/types.h>
+
+struct MountTablePrivate
+{
+    QHash<quint64, QStringList> m_MountPoints;
+    QSet<quint64> m_Swaps;
+};
+
+static QMutex s_ScopeMutex;
+static int s_ScopeDepth = 0;
+static std::shared_ptr<const MountTable> s_ScopeTable;
+
+static quint64 deviceKey(quint64 major, quint64 minor)
+{
+    return (major << 32) | minor;
+}
+
+/** @return device number key of a block device node or 0 if path is not a block device */
+static quint64 blockDeviceKey(const QByteArray& path)
+{
+    struct stat st;
+    if (stat(path.constData(), &st) != 0 || !S_ISBLK(st.st_mode))
+        return 0;
+
+    return deviceKey(major(st.st_rdev), minor(st.st_rdev));
+}
+
+/** Decodes octal escapes (e.g. "\040" for space) used in /proc/self/mountinfo and /proc/swaps. */
+static QByteArray unescape(const QByteArray& field)
+{
+    if (!field.contains('\\'))
+        return field;
+
+    QByteArray result;
+    result.reserve(field.size());
+    for (int i = 0; i < field.size(); ++i) {
+        if (field[i] == '\\' && i + 3 < field.size()) {
+            bool ok = false;
+            const char c = static_cast<char>(field.mid(i + 1, 3).toInt(&ok, 8));
+            if (ok) {
+                result.append(c);
+                i += 3;
+                continue;
+            }
+        }
+        result.append(field[i]);
+    }
+
+    return result;
+}
+
+MountTable::MountTable() :
+    d(std::make_unique<MountTablePrivate>())
+{
+    QFile mountInfo(QStringLiteral("/proc/self/mountinfo"));
+    if (mountInfo.open(QIODevice::ReadOnly)) {
+        // The same source is usually mounted several times (bind mounts, btrfs subvolumes)
+        QHash<QByteArray, quint64> sourceKeys;
+
+        // 36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 - ext3 /dev/root rw,errors=continue
+        const QList<QByteArray> lines = mountInfo.readAll().split('\n');
+        for (const auto &line : lines) {
+            const QList<QByteArray> fields = line.split(' ');
+            const int separator = fields.indexOf(QByteArrayLiteral("-"));
+            if (fields.size() < 5 || separator < 0 || separator + 2 >= fields.size())
+                continue;
+
+            const QString mountPoint = QFile::decodeName(unescape(fields[4]));
+
+            const QList<QByteArray> deviceNumber = fields[2].split(':');
+            quint64 key = 0;
+            if (deviceNumber.size() == 2) {
+                key = deviceKey(deviceNumber[0].toULongLong(), deviceNumber[1].toULongLong());
+                d->m_MountPoints[key].append(mountPoint);
+            }
+
+            // Some file systems (e.g. btrfs) report an anonymous device number,
+            // so also index by the device number of the mount source.
+            const QByteArray source = unescape(fields[separator + 2]);
+            if (!source.startsWith("/dev/"))
+                continue;
+
+            auto it = sourceKeys.constFind(source);
+            if (it == sourceKeys.constEnd())
+                it = sourceKeys.insert(source, blockDeviceKey(source));
+
+            if (it.value() != 0 && it.value() != key)
+                d->m_MountPoints[it.value()].append(mountPoint);
+        }
+    }
+
+    QFile swaps(QStringLiteral("/proc/swaps"));
+    if (swaps.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> lines = swaps.readAll().split('\n');
+        for (int i = 1; i < lines.size(); ++i) { // skip header line
+            const QByteArray fileName = lines[i].left(lines[i].indexOf(' '));
+            if (fileName.isEmpty())
+                continue;
+
+            const quint64 key = blockDeviceKey(unescape(fileName));
+            if (key != 0)
+                d->m_Swaps.insert(key);
+        }
+    }
+}
+
+MountTable::~MountTable()
+{
+}
+
+QStringList MountTable::mountPoints(const QString& deviceNode) const
+{
+    const quint64 key = blockDeviceKey(QFile::encodeName(deviceNode));
+    if (key == 0)
+        return QStringList();
+
+    return d->m_MountPoints.value(key);
+}
+
+bool MountTable::isMounted(const QString& deviceNode) const
+{
+    const quint64 key = blockDeviceKey(QFile::encodeName(deviceNode));
+    if (key == 0)
+        return false;
+
+    return d->m_MountPoints.contains(key) || d->m_Swaps.contains(key);
+}
+
+/** @return the MountTable of the current Scope or a new snapshot if there is no Scope */
+std::shared_ptr<const MountTable> MountTable::current()
+{
+    QMutexLocker locker(&s_ScopeMutex);
+    if (s_ScopeTable)
+        return s_ScopeTable;
+
+    locker.unlock();
+    return std::make_shared<const MountTable>();
+}
+
+MountTable::Scope::Scope()
+{
+    QMutexLocker locker(&s_ScopeMutex);
+    if (s_ScopeDepth++ == 0)
+        s_ScopeTable = std::make_shared<const MountTable>();
+}
+
+MountTable::Scope::~Scope()
+{
+    QMutexLocker locker(&s_ScopeMutex);
+    if (--s_ScopeDepth == 0)
+        s_ScopeTable.reset();
+}
@@ -0,0 +1,61 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_MOUNTTABLE_H
+#define KPMCORE_MOUNTTABLE_H
+
+#include "util/libpartitionmanagerexport.h"
+
+#include <memory>
+
+#include <QString>
+#include <QStringList>
+
+struct MountTablePrivate;
+
+/** Snapshot of currently mounted file systems and active swap.
+
+    Parses /proc/self/mountinfo and /proc/swaps once and indexes them by
+    device number (major:minor), so that looking up mount points of a
+    device does not depend on the number of mounts.
+
+    While a MountTable::Scope object exists (e.g. during a device scan) all
+    callers of current() share the same snapshot.
+
+    @author Andrius Štikonas <andrius@stikonas.eu>
+*/
+class LIBKPMCORE_EXPORT MountTable
+{
+    Q_DISABLE_COPY(MountTable)
+
+public:
+    /** Shares one MountTable snapshot between all lookups while it exists. */
+    class LIBKPMCORE_EXPORT Scope
+    {
+        Q_DISABLE_COPY(Scope)
+
+    public:
+        Scope();
+        ~Scope();
+    };
+
+    MountTable();
+    ~MountTable();
+
+public:
+    /**< @return mount points of the device node in the order they were mounted */
+    QStringList mountPoints(const QString& deviceNode) const;
+
+    /**< @return true if the device node is mounted or used as swap */
+    bool isMounted(const QString& deviceNode) const;
+
+    static std::shared_ptr<const MountTable> current();
+
+private:
+    std::unique_ptr<MountTablePrivate> d;
+};
+
+#endif
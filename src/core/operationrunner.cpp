@@ -14,6 +14,7 @@
 #include <QDBusInterface>
 #include <QDBusReply>
 #include <QMutex>
+#include <QWriteLocker>
 
 /** Constructs an OperationRunner.
     @param ostack the OperationStack to act on
@@ -64,7 +65,11 @@ void OperationRunner::run()
         connect(op, &Operation::progress, this, &OperationRunner::progressSub);
 
         status = op->execute(report());
-        op->preview();
+        {
+            // FileSystems might be replaced, see DeviceScanner::resolveFileSystems()
+            QWriteLocker lockDevices(&operationStack().lock());
+            op->preview();
+        }
 
         disconnect(op, &Operation::progress, this, &OperationRunner::progressSub);
 
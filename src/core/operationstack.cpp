@@ -413,6 +413,9 @@ void OperationStack::push(Operation* o)
 {
     Q_ASSERT(o);
 
+    // DeviceScanner replaces Devices in the background unless operations refer to them
+    QWriteLocker lockDevices(&lock());
+
     if (mergeResizeVolumeGroupResizeOperation(o))
         return;
 
@@ -451,6 +454,8 @@ void OperationStack::push(Operation* o)
 /** Removes the topmost Operation from the OperationStack, calls Operation::undo() on it and deletes it. */
 void OperationStack::pop()
 {
+    QWriteLocker lockDevices(&lock());
+
     Operation* o = operations().takeLast();
     o->undo();
     delete o;
@@ -483,6 +488,8 @@ bool OperationStack::contains(const Partition* p) const
 /** Removes all Operations from the OperationStack, calling Operation::undo() on them and deleting them. */
 void OperationStack::clearOperations()
 {
+    QWriteLocker lockDevices(&lock());
+
     while (!operations().isEmpty()) {
         Operation* o = operations().takeLast();
         if (o->status() == Operation::StatusPending)
@@ -543,6 +550,20 @@ void OperationStack::addDevice(Device* d)
     Q_EMIT devicesChanged();
 }
 
+/** Removes a Device from the OperationStack and deletes it
+    @param d pointer to the Device to remove. Must not be nullptr.
+*/
+void OperationStack::removeDevice(Device* d)
+{
+    Q_ASSERT(d);
+
+    QWriteLocker lockDevices(&lock());
+
+    previewDevices().removeAll(d);
+    delete d;
+    Q_EMIT devicesChanged();
+}
+
 static bool deviceLessThan(const Device* d1, const Device* d2)
 {
     // Display alphabetically sorted disk devices above LVM VGs
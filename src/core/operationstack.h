@@ -83,6 +83,7 @@ public:
 protected:
     void clearDevices();
     void addDevice(Device* d);
+    void removeDevice(Device* d);
     void sortDevices();
 
     bool mergeNewOperation(Operation*& currentOp, Operation*& pushedOp);
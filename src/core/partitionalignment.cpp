@@ -23,37 +23,64 @@
 
 int PartitionAlignment::s_sectorAlignment = 2048;
 
-qint64 PartitionAlignment::firstDelta(const Device& d, const Partition& p, qint64 s)
+// Same limit as for the I/O alignment read by Device, larger alignments waste too much space
+static constexpr qint64 maxAlignment = 256 * 1024 * 1024;
+
+/** @return distance of s from the previous multiple of alignment, also for negative s */
+static qint64 alignmentDelta(qint64 s, qint64 alignment)
 {
-    if (d.partitionTable()->type() == PartitionTable::msdos) {
-        const DiskDevice& diskDevice = dynamic_cast<const DiskDevice&>(d);
-        if (p.roles().has(PartitionRole::Logical) && s == 2 * diskDevice.sectorsPerTrack())
-            return (s - (2 * diskDevice.sectorsPerTrack())) % sectorAlignment(d);
+    return (s % alignment + alignment) % alignment;
+}
 
-        if (p.roles().has(PartitionRole::Logical) || s == diskDevice.sectorsPerTrack())
-            return (s - diskDevice.sectorsPerTrack()) % sectorAlignment(d);
+static qint64 gcd(qint64 a, qint64 b)
+{
+    while (b != 0) {
+        const qint64 t = a % b;
+        a = b;
+        b = t;
     }
+    return a;
+}
+
+/** @return sectors in front of a partition on an msdos table that belong to it, i.e. the
+    extended boot record of logical partitions and the track of legacy first partitions */
+static qint64 msdosLeadIn(const Device& d, const Partition& p, qint64 first)
+{
+    if (d.partitionTable()->type() != PartitionTable::msdos)
+        return 0;
 
-    return s % sectorAlignment(d);
+    const DiskDevice& diskDevice = dynamic_cast<const DiskDevice&>(d);
+    if (p.roles().has(PartitionRole::Logical) && first == 2 * diskDevice.sectorsPerTrack())
+        return 2 * diskDevice.sectorsPerTrack();
+
+    if (p.roles().has(PartitionRole::Logical) || first == diskDevice.sectorsPerTrack())
+        return diskDevice.sectorsPerTrack();
+
+    return 0;
 }
 
-qint64 PartitionAlignment::lastDelta(const Device& d, const Partition&, qint64 s)
+/** @return true if the device's I/O topology applies to partitions on it */
+static bool hasTopology(const Device& d)
 {
-    return (s + 1) % sectorAlignment(d);
+    return d.type() == Device::Type::Disk_Device || d.type() == Device::Type::SoftwareRAID_Device;
 }
 
-bool PartitionAlignment::isLengthAligned(const Device& d, const Partition& p)
+qint64 PartitionAlignment::firstDelta(const Device& d, const Partition& p, qint64 s)
 {
-    if (d.partitionTable()->type() == PartitionTable::msdos) {
-        const DiskDevice& diskDevice = dynamic_cast<const DiskDevice&>(d);
-        if (p.roles().has(PartitionRole::Logical) && p.firstSector() == 2 * diskDevice.sectorsPerTrack())
-            return (p.length() + (2 * diskDevice.sectorsPerTrack())) % sectorAlignment(d) == 0;
+    return alignmentDelta(s - msdosLeadIn(d, p, s) - alignmentOffset(d), sectorAlignment(d));
+}
 
-        if (p.roles().has(PartitionRole::Logical) || p.firstSector() == diskDevice.sectorsPerTrack())
-            return (p.length() + diskDevice.sectorsPerTrack()) % sectorAlignment(d) == 0;
-    }
+qint64 PartitionAlignment::lastDelta(const Device& d, const Partition&, qint64 s)
+{
+    return alignmentDelta(s + 1 - alignmentOffset(d), sectorAlignment(d));
+}
 
-    return p.length() % sectorAlignment(d) == 0;
+/** @return true if the partition, including its msdos lead-in, starts and ends at the same
+    distance from an aligned sector, i.e. moving it to an aligned start also aligns its end */
+bool PartitionAlignment::isLengthAligned(const Device& d, const Partition& p)
+{
+    const qint64 first = p.firstSector() - msdosLeadIn(d, p, p.firstSector());
+    return alignmentDelta(first - alignmentOffset(d), sectorAlignment(d)) == alignmentDelta(p.lastSector() + 1 - alignmentOffset(d), sectorAlignment(d));
 }
 
 /** Checks if the Partition is properly aligned to the PartitionTable's alignment requirements.
@@ -85,12 +112,47 @@ bool PartitionAlignment::isAligned(const Device& d, const Partition& p, qint64 n
     return firstDelta(d, p, newFirst) == 0 && lastDelta(d, p, newLast) == 0;
 }
 
-/** @return the sector size to align the partition start and end to
+/** @return the number of sectors to align the partition start and end to
+
+    This is the configured alignment (2048 sectors by default) combined with
+    the device's physical sector size, minimum and optimal I/O size, discard
+    granularity and, for RAID arrays, the full stripe size, as long as the
+    result is not larger than 256 MiB. Partitions on zoned devices always
+    start and end on a zone boundary.
 */
 qint64 PartitionAlignment::sectorAlignment(const Device& d)
 {
-    Q_UNUSED(d)
-    return s_sectorAlignment;
+    qint64 alignment = s_sectorAlignment;
+    if (!hasTopology(d) || d.logicalSize() <= 0)
+        return alignment;
+
+    const qint64 maxSectors = maxAlignment / d.logicalSize();
+    const qint64 ioAlignment = d.ioAlignment();
+    if (ioAlignment > 0 && ioAlignment % d.logicalSize() == 0) {
+        const qint64 ioSectors = ioAlignment / d.logicalSize();
+        const qint64 combined = alignment / gcd(alignment, ioSectors) * ioSectors;
+        if (combined <= maxSectors)
+            alignment = combined;
+    }
+
+    // Zone boundaries cannot be given up, if the combination is too large only they are kept
+    const qint64 zoneSize = d.zoneSize();
+    if (zoneSize > 0 && zoneSize % d.logicalSize() == 0) {
+        const qint64 zoneSectors = zoneSize / d.logicalSize();
+        const qint64 combined = alignment / gcd(alignment, zoneSectors) * zoneSectors;
+        alignment = combined <= maxSectors ? combined : zoneSectors;
+    }
+
+    return alignment;
+}
+
+/** @return the number of sectors the naturally aligned sectors of the device are offset by */
+qint64 PartitionAlignment::alignmentOffset(const Device& d)
+{
+    if (!hasTopology(d) || d.logicalSize() <= 0)
+        return 0;
+
+    return d.alignmentOffset() / d.logicalSize();
 }
 
 void PartitionAlignment::setSectorAlignment(int sectorAlignment)
@@ -121,7 +183,8 @@ qint64 PartitionAlignment::alignedFirstSector(const Device& d, const Partition&
     while (s > d.partitionTable()->lastUsable() || (max_first > -1 && s > max_first) || p.lastSector() - s + 1 < min_length)
         s -= sectorAlignment(d);
 
-    return s;
+    // The limits above can contradict each other, the partition must stay within the usable sectors in any case
+    return qBound(d.partitionTable()->firstUsable(), s, d.partitionTable()->lastUsable());
 }
 
 qint64 PartitionAlignment::alignedLastSector(const Device& d, const Partition& p, qint64 s, qint64 min_last, qint64 max_last, qint64 min_length, qint64 max_length, qint64 original_length, bool original_aligned)
@@ -141,5 +204,6 @@ qint64 PartitionAlignment::alignedLastSector(const Device& d, const Partition& p
     while (s > d.partitionTable()->lastUsable() || (max_last > -1 && s > max_last) || (max_length > -1 && s - p.firstSector() + 1 > max_length))
         s -= sectorAlignment(d);
 
-    return s;
+    // The limits above can contradict each other, the partition must stay within the usable sectors in any case
+    return qBound(d.partitionTable()->firstUsable(), s, d.partitionTable()->lastUsable());
 }
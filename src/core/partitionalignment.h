@@ -32,6 +32,7 @@ public:
     static qint64 alignedLastSector(const Device& d, const Partition& p, qint64 s, qint64 min_last, qint64 max_last, qint64 min_length, qint64 max_length, qint64 original_length = -1, bool original_aligned = false);
 
     static qint64 sectorAlignment(const Device& d);
+    static qint64 alignmentOffset(const Device& d);
 
     /** Sets the sector alignment multiplier for ALL devices henceforth except
      *  for devices that have a disklabel which aligns to cylinder boundaries.
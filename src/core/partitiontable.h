@@ -39,6 +39,7 @@ class LIBKPMCORE_EXPORT PartitionTable : public PartitionNode
     PartitionTable &operator=(const PartitionTable &) = delete;
 
     friend class CoreBackend;
+    friend class ScanCache;
     friend LIBKPMCORE_EXPORT QTextStream& operator<<(QTextStream& stream, const PartitionTable& ptable);
 
 public:
@@ -0,0 +1,160 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "core/raid/mdinspector.h"
+
+#include "util/devicemapper.h"
+#include "util/sysfsblockdevice.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegularExpression>
+
+static QMutex s_CurrentMutex;
+static std::shared_ptr<const MdInspector> s_Current;
+
+static QString readFile(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return QString();
+
+    return QString::fromLocal8Bit(file.readAll()).trimmed();
+}
+
+static qint64 readNumber(const QString& fileName)
+{
+    bool ok = false;
+    const qint64 value = readFile(fileName).toLongLong(&ok);
+    return ok ? value : -1;
+}
+
+/** @return the RAID level, e.g. 10 for "raid10", or -1 for "linear", "multipath" and containers */
+static qint32 raidLevel(const QString& level)
+{
+    const QRegularExpressionMatch match = QRegularExpression(QStringLiteral("^raid(\\d+)$")).match(level);
+    return match.hasMatch() ? match.captured(1).toInt() : -1;
+}
+
+/** @return the UUID in the format mdadm prints, e.g. "3a8e8b7c:12f0d9a4:5c6d7e8f:01234567" */
+static QString arrayUuid(const QString& name, const QString& sysfsPath)
+{
+    // udev names the link after mdadm --detail --export
+    const QString canonicalPath = QStringLiteral("/dev/") + name;
+    const QDir byId(QStringLiteral("/dev/disk/by-id"));
+    for (const auto &link : byId.entryInfoList({ QStringLiteral("md-uuid-*") }, QDir::System | QDir::Files)) {
+        if (link.canonicalFilePath() == canonicalPath)
+            return link.fileName().mid(8);
+    }
+
+    QString uuid = readFile(sysfsPath + QStringLiteral("/md/uuid")).remove(QLatin1Char('-'));
+    if (uuid.size() != 32)
+        return QString();
+
+    for (int i = 24; i > 0; i -= 8)
+        uuid.insert(i, QLatin1Char(':'));
+    return uuid;
+}
+
+/** Reads one array from /sys/block.
+    @param deviceNode e.g. "/dev/md127" or "/dev/md/name"
+    @return the array, invalid if the device is not an md array
+*/
+MdArray MdInspector::inspect(const QString& deviceNode)
+{
+    MdArray array;
+    const QString name = SysfsBlockDevice::kernelName(deviceNode);
+    const QString path = QStringLiteral("/sys/block/") + name;
+    if (name.isEmpty() || !QFileInfo::exists(path + QStringLiteral("/md")))
+        return array;
+
+    array.name = name;
+    array.deviceNode = QStringLiteral("/dev/") + name;
+    array.arrayState = readFile(path + QStringLiteral("/md/array_state"));
+    array.active = !array.arrayState.isEmpty() && array.arrayState != QStringLiteral("inactive") && array.arrayState != QStringLiteral("clear");
+    array.syncAction = readFile(path + QStringLiteral("/md/sync_action"));
+    array.level = raidLevel(readFile(path + QStringLiteral("/md/level")));
+    array.chunkSize = readNumber(path + QStringLiteral("/md/chunk_size"));
+    array.raidDisks = static_cast<qint32>(readNumber(path + QStringLiteral("/md/raid_disks")));
+    array.logicalSectorSize = readNumber(path + QStringLiteral("/queue/logical_block_size"));
+    array.uuid = arrayUuid(name, path);
+
+    // /sys/block/<dev>/size is always in 512 byte units regardless of the sector size
+    const qint64 sectors = readNumber(path + QStringLiteral("/size"));
+    if (sectors >= 0)
+        array.size = sectors * 512;
+
+    const DeviceMapper deviceMapper;
+    const QStringList devices = QDir(path + QStringLiteral("/md")).entryList({ QStringLiteral("dev-*") }, QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const auto &device : devices)
+        array.members.append(deviceMapper.deviceNode(device.mid(4)));
+
+    return array;
+}
+
+/** Reads all arrays listed in /proc/mdstat. */
+MdInspector::MdInspector()
+{
+    const QString mdstat = readFile(QStringLiteral("/proc/mdstat"));
+
+    // e.g. "md127 : active raid1 sdb1[1] sda1[0]"
+    QRegularExpression re(QStringLiteral("^(md[\\w/]+)\\s+:\\s+(\\w+)(.*)$"), QRegularExpression::MultilineOption);
+    QRegularExpressionMatchIterator i = re.globalMatch(mdstat);
+    while (i.hasNext()) {
+        const QRegularExpressionMatch match = i.next();
+        MdArray array = inspect(QStringLiteral("/dev/") + match.captured(1));
+        if (!array.isValid())
+            continue;
+
+        array.active = match.captured(2) != QStringLiteral("inactive");
+        m_Arrays.append(array);
+    }
+}
+
+/** @param deviceNode e.g. "/dev/md127" or "/dev/md/name"
+    @return the array or nullptr if there is no such array
+*/
+const MdArray* MdInspector::array(const QString& deviceNode) const
+{
+    const QString name = SysfsBlockDevice::kernelName(deviceNode);
+    for (const auto &array : m_Arrays)
+        if (array.name == name)
+            return &array;
+
+    return nullptr;
+}
+
+/** @return true if the device is a member of any array */
+bool MdInspector::isMember(const QString& deviceNode) const
+{
+    const QString canonicalPath = QFileInfo(deviceNode).canonicalFilePath();
+    for (const auto &array : m_Arrays)
+        for (const auto &member : array.members)
+            if (member == deviceNode || (!canonicalPath.isEmpty() && QFileInfo(member).canonicalFilePath() == canonicalPath))
+                return true;
+
+    return false;
+}
+
+/** @return the current snapshot, /proc/mdstat is only read if there is none since the last invalidate() */
+std::shared_ptr<const MdInspector> MdInspector::current()
+{
+    QMutexLocker locker(&s_CurrentMutex);
+    if (!s_Current)
+        s_Current = std::make_shared<const MdInspector>();
+
+    return s_Current;
+}
+
+/** Drops the current snapshot, e.g. after an array was assembled or stopped. */
+void MdInspector::invalidate()
+{
+    QMutexLocker locker(&s_CurrentMutex);
+    s_Current.reset();
+}
@@ -0,0 +1,72 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_MDINSPECTOR_H
+#define KPMCORE_MDINSPECTOR_H
+
+#include "util/libpartitionmanagerexport.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QtGlobal>
+
+#include <memory>
+
+/** Properties of a Linux software RAID array as reported by the kernel. */
+struct LIBKPMCORE_EXPORT MdArray
+{
+    QString name;             /**< kernel name, e.g. "md127" */
+    QString deviceNode;       /**< e.g. "/dev/md127" */
+    bool active = false;      /**< false if the array is assembled but not started */
+    QString arrayState;       /**< md/array_state, e.g. "clean", "active", "inactive" */
+    QString syncAction;       /**< md/sync_action, e.g. "idle", "resync", "recover" */
+    qint32 level = -1;        /**< RAID level, -1 for linear, multipath and containers */
+    qint64 chunkSize = -1;    /**< chunk size in bytes */
+    qint32 raidDisks = -1;    /**< number of devices in the array, excluding spares */
+    qint64 size = -1;         /**< array size in bytes */
+    qint64 logicalSectorSize = -1;
+    QString uuid;             /**< in mdadm's format, e.g. "3a8e8b7c:12f0d9a4:..." */
+    QStringList members;      /**< device nodes of the member devices */
+
+    bool isValid() const {
+        return !name.isEmpty();
+    }
+};
+
+/** Single-pass inspection of Linux software RAID arrays.
+
+    Reads /proc/mdstat once and /sys/block/mdX/md/{level,chunk_size,
+    array_state,sync_action,dev-*} for each array, so scanning an array
+    does not need to run mdadm --detail for every property. The snapshot
+    returned by current() is shared by all callers until invalidate() is
+    called, which is done at the start of every device scan.
+
+    @author Andrius Štikonas <andrius@stikonas.eu>
+*/
+class LIBKPMCORE_EXPORT MdInspector
+{
+public:
+    MdInspector();
+
+public:
+    const QVector<MdArray>& arrays() const {
+        return m_Arrays; /**< @return all arrays listed in /proc/mdstat */
+    }
+
+    const MdArray* array(const QString& deviceNode) const;
+    bool isMember(const QString& deviceNode) const;
+
+    static MdArray inspect(const QString& deviceNode);
+
+    static std::shared_ptr<const MdInspector> current();
+    static void invalidate();
+
+private:
+    QVector<MdArray> m_Arrays;
+};
+
+#endif
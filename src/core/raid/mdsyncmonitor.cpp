@@ -0,0 +1,177 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "core/raid/mdsyncmonitor.h"
+
+#include "util/sysfsblockdevice.h"
+
+#include <QByteArray>
+#include <QDebug>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QVector>
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Attributes md calls sysfs_notify() on when they change
+static const char* const watchedAttributes[] = { "md/sync_action", "md/array_state", "md/sync_completed" };
+
+// md notifies sync_completed only every few percent, so progress is polled while a sync runs
+static constexpr int pollInterval = 1500;
+
+struct MdSyncMonitorPrivate
+{
+    QString m_DeviceNode;
+    QString m_Path;
+    QVector<int> m_Files;
+    QVector<QSocketNotifier*> m_Notifiers;
+    QTimer* m_PollTimer = nullptr;
+    QString m_SyncAction;
+    qint64 m_Completed = -1;
+    qint64 m_Total = -1;
+};
+
+/** Reads a sysfs attribute from an open file and rearms its notification.
+    sysfs only notifies pollers again after the attribute has been read from the start.
+*/
+static QByteArray readAttribute(int fd)
+{
+    char buffer[256];
+    if (lseek(fd, 0, SEEK_SET) < 0)
+        return QByteArray();
+
+    const ssize_t size = read(fd, buffer, sizeof(buffer) - 1);
+    return size > 0 ? QByteArray(buffer, size).trimmed() : QByteArray();
+}
+
+static QByteArray readAttribute(const QString& fileName)
+{
+    const int fd = open(fileName.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return QByteArray();
+
+    const QByteArray value = readAttribute(fd);
+    close(fd);
+    return value;
+}
+
+/** @param deviceNode the array, e.g. "/dev/md127" or "/dev/md/name" */
+MdSyncMonitor::MdSyncMonitor(const QString& deviceNode, QObject* parent) :
+    QObject(parent),
+    d(std::make_unique<MdSyncMonitorPrivate>())
+{
+    d->m_DeviceNode = deviceNode;
+    d->m_Path = QStringLiteral("/sys/block/") + SysfsBlockDevice::kernelName(deviceNode) + QLatin1Char('/');
+
+    d->m_PollTimer = new QTimer(this);
+    d->m_PollTimer->setInterval(pollInterval);
+    connect(d->m_PollTimer, &QTimer::timeout, this, &MdSyncMonitor::update);
+}
+
+MdSyncMonitor::~MdSyncMonitor()
+{
+    stop();
+}
+
+bool MdSyncMonitor::start()
+{
+    if (isActive())
+        return true;
+
+    for (const char* attribute : watchedAttributes) {
+        const int fd = open((d->m_Path + QLatin1String(attribute)).toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            qWarning() << "Could not open" << d->m_Path + QLatin1String(attribute) << strerror(errno);
+            stop();
+            return false;
+        }
+
+        // Changes of sysfs attributes are reported as POLLPRI, which QSocketNotifier calls an exception
+        readAttribute(fd);
+        QSocketNotifier* notifier = new QSocketNotifier(fd, QSocketNotifier::Exception, this);
+        connect(notifier, &QSocketNotifier::activated, this, &MdSyncMonitor::update);
+        d->m_Files.append(fd);
+        d->m_Notifiers.append(notifier);
+    }
+
+    update();
+    return true;
+}
+
+void MdSyncMonitor::stop()
+{
+    d->m_PollTimer->stop();
+    qDeleteAll(d->m_Notifiers);
+    d->m_Notifiers.clear();
+    for (const int fd : qAsConst(d->m_Files))
+        close(fd);
+    d->m_Files.clear();
+}
+
+bool MdSyncMonitor::isActive() const
+{
+    return !d->m_Files.isEmpty();
+}
+
+const QString& MdSyncMonitor::deviceNode() const
+{
+    return d->m_DeviceNode;
+}
+
+const QString& MdSyncMonitor::syncAction() const
+{
+    return d->m_SyncAction;
+}
+
+qint64 MdSyncMonitor::completed() const
+{
+    return d->m_Completed;
+}
+
+qint64 MdSyncMonitor::total() const
+{
+    return d->m_Total;
+}
+
+void MdSyncMonitor::update()
+{
+    // Rearm all notifications, whichever attribute changed
+    for (const int fd : qAsConst(d->m_Files))
+        readAttribute(fd);
+
+    const QString action = QString::fromLatin1(readAttribute(d->m_Path + QStringLiteral("md/sync_action")));
+    if (action != d->m_SyncAction) {
+        d->m_SyncAction = action;
+        Q_EMIT syncActionChanged(action);
+    }
+
+    if (action.isEmpty() || action == QStringLiteral("idle") || action == QStringLiteral("frozen"))
+        d->m_PollTimer->stop();
+    else if (!d->m_PollTimer->isActive())
+        d->m_PollTimer->start();
+
+    // "<completed> / <total>" in sectors, or "none" and "delayed"
+    const QList<QByteArray> completed = readAttribute(d->m_Path + QStringLiteral("md/sync_completed")).split('/');
+    bool ok = completed.size() == 2;
+    const qint64 done = ok ? completed[0].trimmed().toLongLong(&ok) : -1;
+    const qint64 total = ok ? completed[1].trimmed().toLongLong(&ok) : -1;
+    d->m_Completed = ok ? done : -1;
+    d->m_Total = ok ? total : -1;
+    if (!ok || total <= 0)
+        return;
+
+    Q_EMIT progressChanged(static_cast<int>(done * 100 / total));
+
+    // sync_speed is in KiB/s, averaged by the kernel over the last few seconds
+    const qint64 rate = readAttribute(d->m_Path + QStringLiteral("md/sync_speed")).toLongLong() * 1024;
+    Q_EMIT rateChanged(rate);
+    if (rate > 0)
+        Q_EMIT etaChanged((total - done) * 512 / rate);
+}
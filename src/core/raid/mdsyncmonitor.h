@@ -0,0 +1,67 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_MDSYNCMONITOR_H
+#define KPMCORE_MDSYNCMONITOR_H
+
+#include "util/libpartitionmanagerexport.h"
+
+#include <QObject>
+#include <QString>
+
+#include <memory>
+
+struct MdSyncMonitorPrivate;
+
+/** Follows resync, recovery, check and reshape of a software RAID array.
+
+    Watches md/sync_action, md/array_state and md/sync_completed of the
+    array. The kernel notifies pollers of these attributes when they change,
+    so an idle array is not polled. While a sync runs, progress, speed and
+    estimated time are read again every 1.5 seconds, because the kernel only
+    notifies sync_completed every few percent.
+
+    @author Andrius Štikonas <andrius@stikonas.eu>
+*/
+class LIBKPMCORE_EXPORT MdSyncMonitor : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(MdSyncMonitor)
+
+public:
+    explicit MdSyncMonitor(const QString& deviceNode, QObject* parent = nullptr);
+    ~MdSyncMonitor() override;
+
+public:
+    bool start(); /**< start watching the array; @return true on success */
+    void stop(); /**< stop watching the array */
+    bool isActive() const; /**< @return true if the array is being watched */
+
+    const QString& deviceNode() const; /**< @return the array's device node */
+    const QString& syncAction() const; /**< @return current sync action, e.g. "idle", "resync", "recover" */
+    qint64 completed() const; /**< @return synced sectors (512 bytes) or -1 if no sync is running */
+    qint64 total() const; /**< @return sectors (512 bytes) to sync or -1 if no sync is running */
+
+Q_SIGNALS:
+    /**< @param action the new sync action, "idle" once the sync has finished */
+    void syncActionChanged(const QString& action);
+
+    /**< @param percent progress of the running sync */
+    void progressChanged(int percent);
+
+    /**< @param bytesPerSecond current sync speed as reported by the kernel */
+    void rateChanged(qint64 bytesPerSecond);
+
+    /**< @param seconds estimated time until the sync finishes at the current speed */
+    void etaChanged(qint64 seconds);
+
+private:
+    void update();
+
+    std::unique_ptr<MdSyncMonitorPrivate> d;
+};
+
+#endif
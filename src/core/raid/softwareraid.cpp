@@ -9,10 +9,12 @@
 #include "backend/corebackend.h"
 #include "backend/corebackendmanager.h"
 #include "core/partition.h"
+#include "core/raid/mdinspector.h"
 #include "core/volumemanagerdevice_p.h"
 #include "fs/filesystem.h"
 #include "fs/filesystemfactory.h"
 #include "util/externalcommand.h"
+#include "util/sysfsblockdevice.h"
 
 #include <KLocalizedString>
 #include <QFile>
@@ -33,21 +35,55 @@ public:
     SoftwareRAID::Status m_status;
 };
 
+/** @return what mdadm --detail reported: the sector size for RAID 1, the chunk size in KiB otherwise */
+static qint64 chunkSize(const MdArray& array)
+{
+    if (array.level == 1)
+        return array.logicalSectorSize;
+
+    return array.chunkSize > 0 ? array.chunkSize / 1024 : -1;
+}
+
+static qint64 totalChunk(const MdArray& array)
+{
+    const qint64 chunk = chunkSize(array);
+    return chunk > 0 && array.size >= 0 ? array.size / chunk : -1;
+}
+
+/** @return the array from the current snapshot, or read again if it is not listed there */
+static MdArray currentArray(const QString& name)
+{
+    const QString deviceNode = QStringLiteral("/dev/") + name;
+    const MdArray* array = MdInspector::current()->array(deviceNode);
+    return array ? *array : MdInspector::inspect(deviceNode);
+}
+
 SoftwareRAID::SoftwareRAID(const QString& name, SoftwareRAID::Status status, const QString& iconName)
+    : SoftwareRAID(name, currentArray(name), status, iconName)
+{
+}
+
+/** Creates a SoftwareRAID from an array that was already inspected, e.g. during a device scan.
+    @param name kernel name of the array, e.g. "md127"
+    @param array the inspected array
+    @param status the array's status
+    @param iconName name of the icon to use
+*/
+SoftwareRAID::SoftwareRAID(const QString& name, const MdArray& array, SoftwareRAID::Status status, const QString& iconName)
     : VolumeManagerDevice(std::make_shared<SoftwareRAIDPrivate>(),
                           name,
                           (QStringLiteral("/dev/") + name),
-                          getChunkSize(QStringLiteral("/dev/") + name),
-                          getTotalChunk(QStringLiteral("/dev/") + name),
+                          chunkSize(array),
+                          totalChunk(array),
                           iconName,
                           Device::Type::SoftwareRAID_Device)
 {
-    d_ptr->m_raidLevel = getRaidLevel(deviceNode());
+    d_ptr->m_raidLevel = array.level;
     d_ptr->m_chunkSize = logicalSize();
     d_ptr->m_totalChunk = totalLogical();
-    d_ptr->m_arraySize = getArraySize(deviceNode());
-    d_ptr->m_UUID = getUUID(deviceNode());
-    d_ptr->m_devicePathList = getDevicePathList(deviceNode());
+    d_ptr->m_arraySize = array.size;
+    d_ptr->m_UUID = array.uuid.isEmpty() ? getUUID(deviceNode()) : array.uuid;
+    d_ptr->m_devicePathList = array.members;
     d_ptr->m_status = status;
 
     initPartitions();
@@ -172,53 +208,28 @@ void SoftwareRAID::scanSoftwareRAID(QList<Device*>& devices)
         }
     }
 
-    QFile mdstat(QStringLiteral("/proc/mdstat"));
-
-    if (mdstat.open(QIODevice::ReadOnly)) {
-        QTextStream stream(&mdstat);
-
-        QString content = stream.readAll();
-
-        mdstat.close();
-
-        QRegularExpression re(QStringLiteral("md([\\/\\w]+)\\s+:\\s+([\\w]+)"));
-        QRegularExpressionMatchIterator i  = re.globalMatch(content);
-        while (i.hasNext()) {
-            QRegularExpressionMatch reMatch = i.next();
-
-            QString deviceNode = QStringLiteral("/dev/md") + reMatch.captured(1).trimmed();
-            QString status = reMatch.captured(2).trimmed();
-
-            SoftwareRAID* d = static_cast<SoftwareRAID *>(CoreBackendManager::self()->backend()->scanDevice(deviceNode));
-
-            // Just to prevent segfault in some case
-            if (d == nullptr)
-                continue;
+    const auto inspector = MdInspector::current();
+    for (const auto &array : inspector->arrays()) {
+        SoftwareRAID* d = static_cast<SoftwareRAID *>(CoreBackendManager::self()->backend()->scanDevice(array.deviceNode));
 
-            const QStringList constAvailableInConf = availableInConf;
+        // Just to prevent segfault in some case
+        if (d == nullptr)
+            continue;
 
-            for (const QString& path : constAvailableInConf)
-                if (getUUID(QStringLiteral("/dev/") + path) == d->uuid())
-                    availableInConf.removeAll(path);
+        const QStringList constAvailableInConf = availableInConf;
 
-            devices << d;
+        for (const QString& path : constAvailableInConf)
+            if (getUUID(QStringLiteral("/dev/") + path) == d->uuid())
+                availableInConf.removeAll(path);
 
-            if (status == QStringLiteral("inactive"))
-                d->setStatus(SoftwareRAID::Status::Inactive);
+        devices << d;
 
-            if (d->raidLevel() > 0) {
-                QRegularExpression reMirrorStatus(d->name() + QStringLiteral("\\s+:\\s+(.*\\n\\s+)+\\[[=>.]+\\]\\s+(resync|recovery)"));
-
-                QRegularExpressionMatch reMirrorStatusMatch = reMirrorStatus.match(content);
-
-                if (reMirrorStatusMatch.hasMatch()) {
-                    if (reMirrorStatusMatch.captured(2) == QStringLiteral("resync"))
-                        d->setStatus(SoftwareRAID::Status::Resync);
-                    else if (reMirrorStatusMatch.captured(2) == QStringLiteral("recovery"))
-                        d->setStatus(SoftwareRAID::Status::Recovery);
-                }
-            }
-        }
+        if (!array.active)
+            d->setStatus(SoftwareRAID::Status::Inactive);
+        else if (d->raidLevel() > 0 && array.syncAction == QStringLiteral("resync"))
+            d->setStatus(SoftwareRAID::Status::Resync);
+        else if (d->raidLevel() > 0 && array.syncAction == QStringLiteral("recover"))
+            d->setStatus(SoftwareRAID::Status::Recovery);
     }
 
     for (const QString& name : qAsConst(availableInConf)) {
@@ -229,78 +240,31 @@ void SoftwareRAID::scanSoftwareRAID(QList<Device*>& devices)
 
 qint32 SoftwareRAID::getRaidLevel(const QString &path)
 {
-    QString output = getDetail(path);
-
-    if (!output.isEmpty()) {
-        QRegularExpression re(QStringLiteral("Raid Level :\\s+\\w+(\\d+)"));
-        QRegularExpressionMatch reMatch = re.match(output);
-        if (reMatch.hasMatch())
-            return reMatch.captured(1).toLongLong();
-    }
-
-    return -1;
+    return MdInspector::inspect(path).level;
 }
 
 qint64 SoftwareRAID::getChunkSize(const QString &path)
 {
-    if (getRaidLevel(path) == 1) {
-        QStringList devices = getDevicePathList(path);
-
-        if (!devices.isEmpty()) {
-            QString device = devices[0];
-            // Look sector size for the first device/partition on the list, as RAID 1 is composed by mirrored devices
-            ExternalCommand sectorSize(QStringLiteral("blockdev"), { QStringLiteral("--getss"), device });
-
-            if (sectorSize.run(-1) && sectorSize.exitCode() == 0) {
-                int sectors = sectorSize.output().trimmed().toLongLong();
-                return sectors;
-            }
-        }
-    }
-    else {
-        QString output = getDetail(path);
-        if (!output.isEmpty()) {
-            QRegularExpression re(QStringLiteral("Chunk Size :\\s+(\\d+)"));
-            QRegularExpressionMatch reMatch = re.match(output);
-            if (reMatch.hasMatch())
-                return reMatch.captured(1).toLongLong();
-        }
-    }
-    return -1;
-
+    return chunkSize(MdInspector::inspect(path));
 }
 
 qint64 SoftwareRAID::getTotalChunk(const QString &path)
 {
-    return getArraySize(path) / getChunkSize(path);
+    return totalChunk(MdInspector::inspect(path));
 }
 
 qint64 SoftwareRAID::getArraySize(const QString &path)
 {
-    QString output = getDetail(path);
-    if (!output.isEmpty()) {
-        QRegularExpression re(QStringLiteral("Array Size :\\s+(\\d+)"));
-        QRegularExpressionMatch reMatch = re.match(output);
-        if (reMatch.hasMatch())
-            return reMatch.captured(1).toLongLong() * 1024;
-    }
-    return -1;
-
+    return MdInspector::inspect(path).size;
 }
 
 QString SoftwareRAID::getUUID(const QString &path)
 {
-    QString output = getDetail(path);
-
-    if (!output.isEmpty()) {
-        QRegularExpression re(QStringLiteral("UUID :\\s+([\\w:]+)"));
-        QRegularExpressionMatch reMatch = re.match(output);
-
-        if (reMatch.hasMatch())
-            return reMatch.captured(1);
-    }
+    const QString uuid = MdInspector::inspect(path).uuid;
+    if (!uuid.isEmpty())
+        return uuid;
 
-    // If UUID was not found in detail output, it should be searched in config file
+    // If the array is not assembled, its UUID should be searched in config file
 
     // TODO: Support custom config files.
     QString config = getRAIDConfiguration(QStringLiteral("/etc/mdadm.conf"));
@@ -339,29 +303,12 @@ QString SoftwareRAID::getUUID(const QString &path)
 
 QStringList SoftwareRAID::getDevicePathList(const QString &path)
 {
-    QStringList result;
-
-    QString detail = getDetail(path);
-
-    if (!detail.isEmpty()) {
-        QRegularExpression re(QStringLiteral("\\s+\\/dev\\/(\\w+)"));
-        QRegularExpressionMatchIterator i = re.globalMatch(detail);
-
-        while (i.hasNext()) {
-            QRegularExpressionMatch match = i.next();
-
-            QString device = QStringLiteral("/dev/") + match.captured(1);
-            if (device != path)
-                result << device;
-        }
-    }
-
-    return result;
+    return MdInspector::inspect(path).members;
 }
 
 bool SoftwareRAID::isRaidPath(const QString &path)
 {
-    return !getDetail(path).isEmpty();
+    return MdInspector::inspect(path).isValid();
 }
 
 bool SoftwareRAID::createSoftwareRAID(Report &report,
@@ -394,7 +341,9 @@ bool SoftwareRAID::assembleSoftwareRAID(const QString& deviceNode)
     ExternalCommand cmd(QStringLiteral("mdadm"),
                         { QStringLiteral("--assemble"), QStringLiteral("--scan"), deviceNode });
 
-    return cmd.run(-1) && cmd.exitCode() == 0;
+    const bool success = cmd.run(-1) && cmd.exitCode() == 0;
+    MdInspector::invalidate();
+    return success;
 }
 
 bool SoftwareRAID::stopSoftwareRAID(const QString& deviceNode)
@@ -405,7 +354,9 @@ bool SoftwareRAID::stopSoftwareRAID(const QString& deviceNode)
     ExternalCommand cmd(QStringLiteral("mdadm"),
                         { QStringLiteral("--manage"), QStringLiteral("--stop"), deviceNode });
 
-    return cmd.run(-1) && cmd.exitCode() == 0;
+    const bool success = cmd.run(-1) && cmd.exitCode() == 0;
+    MdInspector::invalidate();
+    return success;
 }
 
 bool SoftwareRAID::reassembleSoftwareRAID(const QString &deviceNode)
@@ -415,30 +366,48 @@ bool SoftwareRAID::reassembleSoftwareRAID(const QString &deviceNode)
 
 bool SoftwareRAID::isRaidMember(const QString &path)
 {
-    QFile mdstat(QStringLiteral("/proc/mdstat"));
-
-    if (!mdstat.open(QIODevice::ReadOnly))
-        return false;
-
-    QTextStream stream(&mdstat);
-
-    QString content = stream.readAll();
-
-    mdstat.close();
+    return MdInspector::current()->isMember(path);
+}
 
-    QRegularExpression re(QStringLiteral("(\\w+)\\[\\d+\\]"));
-    QRegularExpressionMatchIterator i  = re.globalMatch(content);
+/** Limits the speed of resync and recovery of an array.
+    @param report report to add the result to
+    @param deviceNode the array
+    @param minimum speed in KiB/s that is kept even if there is other I/O, -1 for the system-wide default
+    @param maximum speed in KiB/s, -1 for the system-wide default
+    @return true on success
+*/
+bool SoftwareRAID::setSyncSpeedLimits(Report& report, const QString& deviceNode, qint64 minimum, qint64 maximum)
+{
+    const QString path = QStringLiteral("/sys/block/") + SysfsBlockDevice::kernelName(deviceNode) + QStringLiteral("/md/");
+    auto limit = [] (qint64 value) { return value < 0 ? QByteArrayLiteral("system") : QByteArray::number(value); };
 
-    while (i.hasNext()) {
-        QRegularExpressionMatch reMatch = i.next();
+    // sysfs attributes need root, so write them through the helper
+    ExternalCommand cmd;
+    return cmd.writeData(report, limit(minimum), path + QStringLiteral("sync_speed_min"), 0) &&
+           cmd.writeData(report, limit(maximum), path + QStringLiteral("sync_speed_max"), 0);
+}
 
-        QString match = QStringLiteral("/dev/") + reMatch.captured(1);
+/** @param deviceNode the array
+    @param minimum current minimum resync speed in KiB/s
+    @param maximum current maximum resync speed in KiB/s
+    @return false if the limits could not be read
+*/
+bool SoftwareRAID::getSyncSpeedLimits(const QString& deviceNode, qint64& minimum, qint64& maximum)
+{
+    const QString path = QStringLiteral("/sys/block/") + SysfsBlockDevice::kernelName(deviceNode) + QStringLiteral("/md/");
 
-        if (match == path)
-            return true;
-    }
+    // e.g. "1000 (system)" or "50000 (local)"
+    auto read = [&path] (const QString& attribute, bool* ok) {
+        QFile file(path + attribute);
+        if (!file.open(QIODevice::ReadOnly))
+            return qint64(-1);
+        return QString::fromLatin1(file.readAll()).section(QLatin1Char(' '), 0, 0).trimmed().toLongLong(ok);
+    };
 
-    return false;
+    bool minimumOk = false, maximumOk = false;
+    minimum = read(QStringLiteral("sync_speed_min"), &minimumOk);
+    maximum = read(QStringLiteral("sync_speed_max"), &maximumOk);
+    return minimumOk && maximumOk;
 }
 
 void SoftwareRAID::initPartitions()
@@ -453,13 +422,6 @@ qint64 SoftwareRAID::mappedSector(const QString &partitionPath, qint64 sector) c
     return -1;
 }
 
-QString SoftwareRAID::getDetail(const QString &path)
-{
-    ExternalCommand cmd(QStringLiteral("mdadm"),
-                       { QStringLiteral("--misc"), QStringLiteral("--detail"), path });
-    return (cmd.run(-1) && cmd.exitCode() == 0) ? cmd.output() : QString();
-}
-
 QString SoftwareRAID::getRAIDConfiguration(const QString &configurationPath)
 {
     QFile config(configurationPath);
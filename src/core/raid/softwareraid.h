@@ -11,6 +11,8 @@
 #include "util/libpartitionmanagerexport.h"
 #include "util/report.h"
 
+struct MdArray;
+
 class LIBKPMCORE_EXPORT SoftwareRAID : public VolumeManagerDevice
 {
     Q_DISABLE_COPY(SoftwareRAID)
@@ -28,6 +30,10 @@ public:
     explicit SoftwareRAID(const QString& name,
                  SoftwareRAID::Status status = SoftwareRAID::Status::Active,
                  const QString& iconName = QString());
+    SoftwareRAID(const QString& name,
+                 const MdArray& array,
+                 SoftwareRAID::Status status = SoftwareRAID::Status::Active,
+                 const QString& iconName = QString());
 
     const QStringList deviceNodes() const override;
     const QStringList& partitionNodes() const override;
@@ -78,6 +84,9 @@ public:
 
     static bool isRaidMember(const QString& path);
 
+    static bool setSyncSpeedLimits(Report& report, const QString& deviceNode, qint64 minimum, qint64 maximum);
+    static bool getSyncSpeedLimits(const QString& deviceNode, qint64& minimum, qint64& maximum);
+
 protected:
     void initPartitions() override;
 
@@ -86,8 +95,6 @@ protected:
 private:
     static void scanSoftwareRAID(QList<Device*>& devices);
 
-    static QString getDetail(const QString& path);
-
     static QString getRAIDConfiguration(const QString& configurationPath);
 };
 
@@ -0,0 +1,402 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "core/scancache.h"
+
+#include "core/diskdevice.h"
+#include "core/mounttable.h"
+#include "core/partition.h"
+#include "core/partitiontable.h"
+
+#include "fs/filesystem.h"
+#include "fs/filesystemfactory.h"
+#include "fs/superblock.h"
+
+#include "util/sysfsblockdevice.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QStorageInfo>
+
+#include <algorithm>
+
+#include <sys/stat.h>
+
+static const int cacheVersion = 2;
+
+struct ScanCachePrivate
+{
+    QString m_FileName;
+    mutable QMutex m_Mutex;
+    QJsonObject m_Loaded; // entries read from the cache file
+    QJsonObject m_Current; // entries of Devices restored or stored since then
+    QHash<QString, QString> m_Stamps; // stamps of Devices that were not found, taken before they are scanned
+};
+
+/** @return identity of the disk that does not depend on its device node or an empty string */
+static QString identity(const SysfsBlockDevice& sysfsDevice)
+{
+    const QStringList attributes = {
+        QStringLiteral("wwid"),
+        QStringLiteral("device/wwid"),
+        QStringLiteral("serial"),
+        QStringLiteral("device/serial"),
+        QStringLiteral("loop/backing_file"),
+    };
+
+    for (const auto &attribute : attributes) {
+        const QString value = sysfsDevice.readAttribute(attribute);
+        if (!value.isEmpty())
+            return attribute + QLatin1Char('=') + value;
+    }
+
+    return QString();
+}
+
+/** @return a value that changes whenever the partition table or a file system on the disk might have changed */
+static QString stamp(const SysfsBlockDevice& sysfsDevice)
+{
+    // Without udev nothing notices file systems that were written without changing the partition table
+    if (!QFileInfo(QStringLiteral("/run/udev/data")).isDir())
+        return QString();
+
+    const qint64 size = sysfsDevice.size();
+    const qint64 sectorSize = sysfsDevice.logicalSectorSize();
+    if (size <= 0 || sectorSize <= 0)
+        return QString();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(size) + ' ' + QByteArray::number(sectorSize) + ' ');
+    hash.addData(sysfsDevice.readAttribute(QStringLiteral("diskseq")).toLatin1());
+
+    // MBR or protective MBR, GPT header and the default 128 GPT entries
+    QByteArray partitionTable;
+    if (!FS::Superblock::read(sysfsDevice.deviceNode(), 0, std::min(34 * sectorSize, size), partitionTable))
+        return QString();
+
+    hash.addData(partitionTable);
+
+    // udev rewrites its database entry of a device on every change event
+    QStringList devNumbers = { sysfsDevice.readAttribute(QStringLiteral("dev")) };
+    const QStringList entries = QDir(sysfsDevice.path()).entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    for (const auto &entry : entries)
+        if (QFile::exists(sysfsDevice.path() + QLatin1Char('/') + entry + QStringLiteral("/partition")))
+            devNumbers.append(sysfsDevice.readAttribute(entry + QStringLiteral("/dev")));
+
+    for (const auto &devNumber : qAsConst(devNumbers)) {
+        hash.addData(devNumber.toLatin1() + ' ');
+
+        struct stat st;
+        const QByteArray udevData = QByteArray("/run/udev/data/b") + devNumber.toLatin1();
+        if (stat(udevData.constData(), &st) == 0)
+            hash.addData(QByteArray::number(static_cast<qint64>(st.st_mtim.tv_sec)) + '.' + QByteArray::number(static_cast<qint64>(st.st_mtim.tv_nsec)) + ' ');
+    }
+
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+/** @return true if the Partition and its children can be restored from the cache */
+static bool isCacheable(const Partition& p)
+{
+    if (p.roles().has(PartitionRole::Unallocated))
+        return true;
+
+    const FileSystem& fs = p.fileSystem();
+    if (p.roles().has(PartitionRole::Luks) ||
+        fs.type() == FileSystem::Type::Luks ||
+        fs.type() == FileSystem::Type::Luks2 ||
+        fs.type() == FileSystem::Type::Lvm2_PV ||
+        fs.type() == FileSystem::Type::LinuxRaidMember)
+        return false;
+
+    // Do not force reading details that were deferred during the scan
+    if (!fs.isResolved())
+        return false;
+
+    for (const auto &child : p.children())
+        if (!isCacheable(*child))
+            return false;
+
+    return true;
+}
+
+static QJsonArray partitionsToJson(const PartitionNode& parent)
+{
+    QJsonArray partitions;
+    for (const auto &p : parent.children()) {
+        if (p->roles().has(PartitionRole::Unallocated))
+            continue;
+
+        const FileSystem& fs = p->fileSystem();
+        QJsonObject fileSystem;
+        fileSystem[QLatin1String("type")] = static_cast<int>(fs.type());
+        fileSystem[QLatin1String("label")] = fs.label();
+        fileSystem[QLatin1String("uuid")] = fs.uuid();
+        fileSystem[QLatin1String("features")] = QJsonObject::fromVariantMap(fs.features());
+
+        QJsonObject partition;
+        partition[QLatin1String("node")] = p->partitionPath();
+        partition[QLatin1String("roles")] = static_cast<int>(p->roles().roles());
+        partition[QLatin1String("first")] = p->firstSector();
+        partition[QLatin1String("last")] = p->lastSector();
+        partition[QLatin1String("availableFlags")] = static_cast<int>(p->availableFlags());
+        partition[QLatin1String("activeFlags")] = static_cast<int>(p->activeFlags());
+        partition[QLatin1String("label")] = p->label();
+        partition[QLatin1String("uuid")] = p->uuid();
+        partition[QLatin1String("type")] = p->type();
+        partition[QLatin1String("attributes")] = QString::number(p->attributes());
+        partition[QLatin1String("fileSystem")] = fileSystem;
+        partition[QLatin1String("children")] = partitionsToJson(*p);
+
+        partitions.append(partition);
+    }
+
+    return partitions;
+}
+
+static void restorePartitions(Device& d, PartitionNode& parent, const QJsonArray& partitions)
+{
+    for (const auto &value : partitions) {
+        const QJsonObject partition = value.toObject();
+        const QJsonObject fileSystem = partition[QLatin1String("fileSystem")].toObject();
+
+        const QString partitionNode = partition[QLatin1String("node")].toString();
+        const qint64 start = partition[QLatin1String("first")].toVariant().toLongLong();
+        const qint64 lastSector = partition[QLatin1String("last")].toVariant().toLongLong();
+
+        FileSystem* fs = FileSystemFactory::create(static_cast<FileSystem::Type>(fileSystem[QLatin1String("type")].toInt()),
+                                                   start, lastSector, d.logicalSize(), -1,
+                                                   fileSystem[QLatin1String("label")].toString(),
+                                                   fileSystem[QLatin1String("features")].toObject().toVariantMap(),
+                                                   fileSystem[QLatin1String("uuid")].toString());
+
+        // Mount status and usage change without touching the partition table, so they are
+        // never cached. Usage of unmounted file systems is read from their superblocks
+        // when it is first needed, as during a scan.
+        const QString mountPoint = FileSystem::detectMountPoint(fs, partitionNode);
+        const bool mounted = FileSystem::detectMountStatus(fs, partitionNode);
+        if (mounted && !mountPoint.isEmpty() && fs->type() != FileSystem::Type::LinuxSwap) {
+            const QStorageInfo storage = QStorageInfo(mountPoint);
+            if (storage.isValid())
+                fs->setSectorsUsed( (storage.bytesTotal() - storage.bytesFree()) / d.logicalSize());
+        }
+        else if (fs->supportGetUsed() != FileSystem::cmdSupportNone) {
+            const qint64 logicalSize = d.logicalSize();
+            fs->setSectorsUsedReader([fs, partitionNode, logicalSize] {
+                const qint64 used = fs->readUsedCapacity(partitionNode);
+                return used < 0 ? -1 : used / logicalSize;
+            });
+        }
+
+        Partition* part = new Partition(&parent, d, PartitionRole(PartitionRole::Roles(partition[QLatin1String("roles")].toInt())),
+                                        fs, start, lastSector, partitionNode,
+                                        PartitionTable::Flags(partition[QLatin1String("availableFlags")].toInt()),
+                                        mountPoint, mounted,
+                                        PartitionTable::Flags(partition[QLatin1String("activeFlags")].toInt()));
+
+        part->setLabel(partition[QLatin1String("label")].toString());
+        part->setUUID(partition[QLatin1String("uuid")].toString());
+        part->setType(partition[QLatin1String("type")].toString());
+        part->setAttributes(partition[QLatin1String("attributes")].toString().toULongLong());
+
+        restorePartitions(d, *part, partition[QLatin1String("children")].toArray());
+
+        parent.append(part);
+    }
+}
+
+/** Creates a ScanCache. Call load() to read the cached Devices.
+    @param fileName the file the cache is stored in
+*/
+ScanCache::ScanCache(const QString& fileName) :
+    d(std::make_unique<ScanCachePrivate>())
+{
+    d->m_FileName = fileName;
+}
+
+ScanCache::~ScanCache()
+{
+}
+
+/** Reads the cache file.
+    @return true if the cache file was read
+*/
+bool ScanCache::load()
+{
+    QFile file(fileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const QJsonObject cache = QJsonDocument::fromJson(file.readAll()).object();
+    if (cache[QLatin1String("version")].toInt() != cacheVersion)
+        return false;
+
+    QMutexLocker locker(&d->m_Mutex);
+    d->m_Loaded = cache[QLatin1String("devices")].toObject();
+    return true;
+}
+
+/** Writes all Devices that were restored or stored since the cache was loaded.
+
+    Devices that were not seen, e.g. because they were unplugged, are dropped from the cache.
+
+    @return true if the cache file was written
+*/
+bool ScanCache::save() const
+{
+    QJsonObject cache;
+    cache[QLatin1String("version")] = cacheVersion;
+    {
+        QMutexLocker locker(&d->m_Mutex);
+        cache[QLatin1String("devices")] = d->m_Current;
+    }
+
+    if (!QDir().mkpath(QFileInfo(fileName()).absolutePath()))
+        return false;
+
+    QSaveFile file(fileName());
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    file.write(QJsonDocument(cache).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+/** Forgets all cached Devices. */
+void ScanCache::clear()
+{
+    QMutexLocker locker(&d->m_Mutex);
+    d->m_Loaded = QJsonObject();
+    d->m_Current = QJsonObject();
+    d->m_Stamps.clear();
+}
+
+/** Creates a Device from the cache if the disk did not change since it was stored.
+    @param deviceNode the device node of the disk (e.g. "/dev/sda")
+    @return the restored Device or nullptr if the disk has to be scanned. Callers need to free the Device.
+*/
+Device* ScanCache::restoreDevice(const QString& deviceNode)
+{
+    const SysfsBlockDevice sysfsDevice(deviceNode);
+    const QString id = identity(sysfsDevice);
+    if (id.isEmpty())
+        return nullptr;
+
+    const QString key = deviceNode + QLatin1Char(' ') + id;
+    const QString deviceStamp = stamp(sysfsDevice);
+
+    QJsonObject entry;
+    {
+        QMutexLocker locker(&d->m_Mutex);
+        entry = d->m_Loaded[key].toObject();
+        if (deviceStamp.isEmpty() || entry[QLatin1String("stamp")].toString() != deviceStamp) {
+            // Remember the stamp from before the scan, so that changes made during the scan invalidate the cache
+            d->m_Stamps.insert(deviceNode, deviceStamp);
+            return nullptr;
+        }
+    }
+
+    const QJsonObject device = entry[QLatin1String("device")].toObject();
+    const qint64 sectorSize = sysfsDevice.logicalSectorSize();
+    DiskDevice* disk = new DiskDevice(device[QLatin1String("name")].toString(), deviceNode, 255, 63,
+                                    sysfsDevice.size() / sectorSize / 255 / 63, sectorSize,
+                                    device[QLatin1String("icon")].toString());
+
+    if (device.contains(QLatin1String("partitionTable"))) {
+        const QJsonObject table = device[QLatin1String("partitionTable")].toObject();
+        PartitionTable* partitionTable = new PartitionTable(static_cast<PartitionTable::TableType>(table[QLatin1String("type")].toInt()),
+                                                            table[QLatin1String("firstUsable")].toVariant().toLongLong(),
+                                                            table[QLatin1String("lastUsable")].toVariant().toLongLong());
+        partitionTable->setMaxPrimaries(table[QLatin1String("maxPrimaries")].toInt());
+        disk->setPartitionTable(partitionTable);
+
+        const MountTable::Scope mountTableScope;
+        restorePartitions(*disk, *partitionTable, table[QLatin1String("partitions")].toArray());
+        partitionTable->updateUnallocated(*disk);
+    }
+
+    QMutexLocker locker(&d->m_Mutex);
+    d->m_Current.insert(key, entry);
+
+    return disk;
+}
+
+/** Stores a scanned Device in the cache.
+    @param device the Device to store
+    @return true if the Device can be restored from the cache
+*/
+bool ScanCache::storeDevice(const Device& device)
+{
+    if (device.type() != Device::Type::Disk_Device)
+        return false;
+
+    const PartitionTable* table = device.partitionTable();
+    if (table)
+        for (const auto &p : table->children())
+            if (!isCacheable(*p))
+                return false;
+
+    const SysfsBlockDevice sysfsDevice(device.deviceNode());
+    const QString id = identity(sysfsDevice);
+    if (id.isEmpty())
+        return false;
+
+    QString deviceStamp;
+    {
+        QMutexLocker locker(&d->m_Mutex);
+        deviceStamp = d->m_Stamps.take(device.deviceNode());
+    }
+
+    if (deviceStamp.isEmpty())
+        deviceStamp = stamp(sysfsDevice);
+
+    if (deviceStamp.isEmpty())
+        return false;
+
+    QJsonObject deviceObject;
+    deviceObject[QLatin1String("name")] = device.name();
+    deviceObject[QLatin1String("icon")] = device.iconName();
+
+    if (table) {
+        QJsonObject tableObject;
+        tableObject[QLatin1String("type")] = static_cast<int>(table->type());
+        tableObject[QLatin1String("firstUsable")] = table->firstUsable();
+        tableObject[QLatin1String("lastUsable")] = table->lastUsable();
+        tableObject[QLatin1String("maxPrimaries")] = table->maxPrimaries();
+        tableObject[QLatin1String("partitions")] = partitionsToJson(*table);
+        deviceObject[QLatin1String("partitionTable")] = tableObject;
+    }
+
+    QJsonObject entry;
+    entry[QLatin1String("stamp")] = deviceStamp;
+    entry[QLatin1String("device")] = deviceObject;
+
+    QMutexLocker locker(&d->m_Mutex);
+    d->m_Current.insert(device.deviceNode() + QLatin1Char(' ') + id, entry);
+
+    return true;
+}
+
+const QString& ScanCache::fileName() const
+{
+    return d->m_FileName;
+}
+
+/** @return the cache file in the user's cache directory */
+QString ScanCache::defaultFileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/kpmcore/scancache.json");
+}
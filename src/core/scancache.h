@@ -0,0 +1,66 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_SCANCACHE_H
+#define KPMCORE_SCANCACHE_H
+
+#include "util/libpartitionmanagerexport.h"
+
+#include <memory>
+
+#include <QString>
+
+class Device;
+struct ScanCachePrivate;
+
+/** On-disk cache of scanned Devices.
+
+    Stores the Device, PartitionTable, Partition and FileSystem model of
+    each disk, keyed by the disk's identity (WWN, serial or loop backing
+    file) and device node. A cached Device is only reused while its stamp
+    is unchanged: the size from sysfs, the kernel's disk sequence number,
+    a hash of the partition table area and the modification times of the
+    udev database entries of the disk and its partitions (udev rewrites
+    them on every change event, e.g. after the partition table or a file
+    system was written).
+
+    Mount points and used capacity are never cached: mount points and the
+    usage of mounted file systems are read again when a Device is restored,
+    the usage of unmounted file systems is read from their superblocks when
+    first needed. Disks with LUKS, LVM or RAID members are never cached,
+    because those depend on state outside of the disk. Without a udev
+    database in /run/udev/data nothing is cached at all.
+
+    All methods are thread-safe.
+
+    @author Andrius Štikonas <andrius@stikonas.eu>
+*/
+class LIBKPMCORE_EXPORT ScanCache
+{
+    Q_DISABLE_COPY(ScanCache)
+
+public:
+    explicit ScanCache(const QString& fileName = defaultFileName());
+    ~ScanCache();
+
+public:
+    bool load();
+    bool save() const;
+    void clear();
+
+    Device* restoreDevice(const QString& deviceNode);
+    bool storeDevice(const Device& d);
+
+    /**< @return the file name of the cache */
+    const QString& fileName() const;
+
+    static QString defaultFileName();
+
+private:
+    std::unique_ptr<ScanCachePrivate> d;
+};
+
+#endif
@@ -10,7 +10,6 @@
 #include "core/smartdiskinformation.h"
 
 #include <QJsonObject>
-#include <QMap>
 #include <QRegularExpression>
 #include <QVariant>
 #include <QVector>
@@ -22,9 +21,6 @@
 #define MSECOND_VALID_SHORT_MAX (60ULL * 60ULL * 1000ULL)
 #define MSECOND_VALID_LONG_MAX (30ULL * 365ULL * 24ULL * 60ULL * 60ULL * 1000ULL)
 
-static QMap<qint32, SmartAttributeUnit> tableUnit();
-static SmartQuirk getQuirk(QString model, QString firmware);
-
 /** Creates a new SmartAttributeParsedData object.
     @param disk the reference to the disk that this attribute is allocated to
     @param jsonAttribute JSON attribute data
@@ -52,7 +48,7 @@ SmartAttributeParsedData::SmartAttributeParsedData(SmartDiskInformation *disk,
     m_Quirk(SmartQuirk::None)
 {
     if (disk)
-        m_Quirk = getQuirk(disk->model(), disk->firmware());
+        m_Quirk = disk->quirk();
 
     if (!jsonAttribute.isEmpty()) {
         QString id = QStringLiteral("id");
@@ -386,90 +382,135 @@ bool SmartAttributeParsedData::updateUnit()
         }
     }
 
-    if (tableUnit().contains(id())) {
-        m_PrettyUnit = tableUnit()[id()];
+    if (id() < 256 && unitTable.known[id()]) {
+        m_PrettyUnit = unitTable.unit[id()];
         return true;
     }
 
     return false;
 }
 
-static QMap<qint32, SmartAttributeUnit> tableUnit()
+namespace
 {
-    QMap<qint32, SmartAttributeUnit> table;
-    table.insert(1, SmartAttributeUnit::None);
-    table.insert(2, SmartAttributeUnit::Unknown);
-    table.insert(3, SmartAttributeUnit::Miliseconds);
-    table.insert(4, SmartAttributeUnit::None);
-    table.insert(5, SmartAttributeUnit::Sectors);
-    table.insert(6, SmartAttributeUnit::Unknown);
-    table.insert(7, SmartAttributeUnit::None);
-    table.insert(8, SmartAttributeUnit::Unknown);
-    table.insert(9, SmartAttributeUnit::Miliseconds);
-    table.insert(10, SmartAttributeUnit::None);
-    table.insert(11, SmartAttributeUnit::None);
-    table.insert(12, SmartAttributeUnit::None);
-    table.insert(13, SmartAttributeUnit::None);
-    table.insert(170, SmartAttributeUnit::Percent);
-    table.insert(171, SmartAttributeUnit::None);
-    table.insert(172, SmartAttributeUnit::None);
-    table.insert(175, SmartAttributeUnit::None);
-    table.insert(176, SmartAttributeUnit::None);
-    table.insert(177, SmartAttributeUnit::None);
-    table.insert(178, SmartAttributeUnit::None);
-    table.insert(179, SmartAttributeUnit::None);
-    table.insert(180, SmartAttributeUnit::None);
-    table.insert(181, SmartAttributeUnit::None);
-    table.insert(182, SmartAttributeUnit::None);
-    table.insert(183, SmartAttributeUnit::None);
-    table.insert(184, SmartAttributeUnit::None);
-    table.insert(187, SmartAttributeUnit::Sectors);
-    table.insert(188, SmartAttributeUnit::None);
-    table.insert(189, SmartAttributeUnit::None);
-    table.insert(190, SmartAttributeUnit::Milikelvin);
-    table.insert(191, SmartAttributeUnit::None);
-    table.insert(192, SmartAttributeUnit::None);
-    table.insert(193, SmartAttributeUnit::None);
-    table.insert(194, SmartAttributeUnit::Milikelvin);
-    table.insert(195, SmartAttributeUnit::None);
-    table.insert(196, SmartAttributeUnit::None);
-    table.insert(197, SmartAttributeUnit::Sectors);
-    table.insert(198, SmartAttributeUnit::Sectors);
-    table.insert(199, SmartAttributeUnit::None);
-    table.insert(200, SmartAttributeUnit::None);
-    table.insert(201, SmartAttributeUnit::None);
-    table.insert(202, SmartAttributeUnit::None);
-    table.insert(203, SmartAttributeUnit::Unknown);
-    table.insert(204, SmartAttributeUnit::None);
-    table.insert(205, SmartAttributeUnit::None);
-    table.insert(206, SmartAttributeUnit::Unknown);
-    table.insert(207, SmartAttributeUnit::Unknown);
-    table.insert(208, SmartAttributeUnit::Unknown);
-    table.insert(209, SmartAttributeUnit::Unknown);
-    table.insert(220, SmartAttributeUnit::Unknown);
-    table.insert(221, SmartAttributeUnit::None);
-    table.insert(222, SmartAttributeUnit::Miliseconds);
-    table.insert(223, SmartAttributeUnit::None);
-    table.insert(224, SmartAttributeUnit::Unknown);
-    table.insert(225, SmartAttributeUnit::None);
-    table.insert(226, SmartAttributeUnit::Miliseconds);
-    table.insert(227, SmartAttributeUnit::None);
-    table.insert(228, SmartAttributeUnit::None);
-    table.insert(230, SmartAttributeUnit::Unknown);
-    table.insert(231, SmartAttributeUnit::Milikelvin);
-    table.insert(232, SmartAttributeUnit::Percent);
-    table.insert(233, SmartAttributeUnit::Unknown);
-    table.insert(234, SmartAttributeUnit::Sectors);
-    table.insert(235, SmartAttributeUnit::Unknown);
-    table.insert(240, SmartAttributeUnit::Miliseconds);
-    table.insert(241, SmartAttributeUnit::MB);
-    table.insert(242, SmartAttributeUnit::MB);
-    table.insert(250, SmartAttributeUnit::None);
-
+struct UnitEntry {
+    quint8 id;
+    SmartAttributeUnit unit;
+};
+
+constexpr UnitEntry unitEntries[] = {
+    { 1, SmartAttributeUnit::None },
+    { 2, SmartAttributeUnit::Unknown },
+    { 3, SmartAttributeUnit::Miliseconds },
+    { 4, SmartAttributeUnit::None },
+    { 5, SmartAttributeUnit::Sectors },
+    { 6, SmartAttributeUnit::Unknown },
+    { 7, SmartAttributeUnit::None },
+    { 8, SmartAttributeUnit::Unknown },
+    { 9, SmartAttributeUnit::Miliseconds },
+    { 10, SmartAttributeUnit::None },
+    { 11, SmartAttributeUnit::None },
+    { 12, SmartAttributeUnit::None },
+    { 13, SmartAttributeUnit::None },
+    { 170, SmartAttributeUnit::Percent },
+    { 171, SmartAttributeUnit::None },
+    { 172, SmartAttributeUnit::None },
+    { 175, SmartAttributeUnit::None },
+    { 176, SmartAttributeUnit::None },
+    { 177, SmartAttributeUnit::None },
+    { 178, SmartAttributeUnit::None },
+    { 179, SmartAttributeUnit::None },
+    { 180, SmartAttributeUnit::None },
+    { 181, SmartAttributeUnit::None },
+    { 182, SmartAttributeUnit::None },
+    { 183, SmartAttributeUnit::None },
+    { 184, SmartAttributeUnit::None },
+    { 187, SmartAttributeUnit::Sectors },
+    { 188, SmartAttributeUnit::None },
+    { 189, SmartAttributeUnit::None },
+    { 190, SmartAttributeUnit::Milikelvin },
+    { 191, SmartAttributeUnit::None },
+    { 192, SmartAttributeUnit::None },
+    { 193, SmartAttributeUnit::None },
+    { 194, SmartAttributeUnit::Milikelvin },
+    { 195, SmartAttributeUnit::None },
+    { 196, SmartAttributeUnit::None },
+    { 197, SmartAttributeUnit::Sectors },
+    { 198, SmartAttributeUnit::Sectors },
+    { 199, SmartAttributeUnit::None },
+    { 200, SmartAttributeUnit::None },
+    { 201, SmartAttributeUnit::None },
+    { 202, SmartAttributeUnit::None },
+    { 203, SmartAttributeUnit::Unknown },
+    { 204, SmartAttributeUnit::None },
+    { 205, SmartAttributeUnit::None },
+    { 206, SmartAttributeUnit::Unknown },
+    { 207, SmartAttributeUnit::Unknown },
+    { 208, SmartAttributeUnit::Unknown },
+    { 209, SmartAttributeUnit::Unknown },
+    { 220, SmartAttributeUnit::Unknown },
+    { 221, SmartAttributeUnit::None },
+    { 222, SmartAttributeUnit::Miliseconds },
+    { 223, SmartAttributeUnit::None },
+    { 224, SmartAttributeUnit::Unknown },
+    { 225, SmartAttributeUnit::None },
+    { 226, SmartAttributeUnit::Miliseconds },
+    { 227, SmartAttributeUnit::None },
+    { 228, SmartAttributeUnit::None },
+    { 230, SmartAttributeUnit::Unknown },
+    { 231, SmartAttributeUnit::Milikelvin },
+    { 232, SmartAttributeUnit::Percent },
+    { 233, SmartAttributeUnit::Unknown },
+    { 234, SmartAttributeUnit::Sectors },
+    { 235, SmartAttributeUnit::Unknown },
+    { 240, SmartAttributeUnit::Miliseconds },
+    { 241, SmartAttributeUnit::MB },
+    { 242, SmartAttributeUnit::MB },
+    { 250, SmartAttributeUnit::None },
+};
+
+/** Units indexed by attribute id, built at compile time */
+struct UnitTable {
+    SmartAttributeUnit unit[256] = {};
+    bool known[256] = {};
+};
+
+constexpr UnitTable makeUnitTable()
+{
+    UnitTable table {};
+    for (const auto &entry : unitEntries) {
+        table.unit[entry.id] = entry.unit;
+        table.known[entry.id] = true;
+    }
     return table;
 }
 
-static const QVector<SmartAttributeParsedData::SmartQuirkDataBase> quirkDatabase()
+constexpr UnitTable unitTable = makeUnitTable();
+
+/** Quirk database with regular expressions that are compiled only once */
+struct CompiledQuirk {
+    QRegularExpression model;
+    QRegularExpression firmware;
+    SmartQuirk quirk;
+};
+
+const QVector<CompiledQuirk>& compiledQuirks()
+{
+    static const QVector<CompiledQuirk> quirks = [] {
+        QVector<CompiledQuirk> result;
+        for (const auto &item : SmartAttributeParsedData::quirkDatabase()) {
+            CompiledQuirk compiled { QRegularExpression(item.model), QRegularExpression(item.firmware), item.quirk };
+            compiled.model.optimize();
+            compiled.firmware.optimize();
+            result.append(compiled);
+        }
+        return result;
+    }();
+    return quirks;
+}
+}
+
+/** @return model and firmware patterns of drives with known quirks */
+QVector<SmartAttributeParsedData::SmartQuirkDataBase> SmartAttributeParsedData::quirkDatabase()
 {
     typedef SmartAttributeParsedData::SmartQuirkDataBase QuirkDatabase;
 
@@ -608,26 +649,18 @@ static const QVector<SmartAttributeParsedData::SmartQuirkDataBase> quirkDatabase
     return quirkDb;
 }
 
-static SmartQuirk getQuirk(QString model, QString firmware)
+/** Looks up the quirks of a drive. Patterns are compiled once, so this is cheap to call for every disk.
+    @param model the drive model
+    @param firmware the firmware version
+    @return the quirks of the first matching entry of the quirk database
+*/
+SmartQuirk SmartAttributeParsedData::quirk(const QString& model, const QString& firmware)
 {
-    const QVector<SmartAttributeParsedData::SmartQuirkDataBase> db = quirkDatabase();
-
-    QRegularExpression modelRegex;
-    QRegularExpression firmwareRegex;
-
-    for (const SmartAttributeParsedData::SmartQuirkDataBase &item : qAsConst(db)) {
-        if (!item.model.isEmpty()) {
-            modelRegex.setPattern(item.model);
-            QRegularExpressionMatch match = modelRegex.match(model);
-            if (!match.hasMatch())
-                continue;
-        }
-        if (!item.firmware.isEmpty()) {
-            firmwareRegex.setPattern(item.firmware);
-            QRegularExpressionMatch match = firmwareRegex.match(firmware);
-            if (!match.hasMatch())
-                continue;
-        }
+    for (const auto &item : compiledQuirks()) {
+        if (!item.model.pattern().isEmpty() && !item.model.match(model).hasMatch())
+            continue;
+        if (!item.firmware.pattern().isEmpty() && !item.firmware.match(firmware).hasMatch())
+            continue;
         return item.quirk;
     }
 
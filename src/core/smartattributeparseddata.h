@@ -10,6 +10,7 @@
 
 #include <QJsonObject>
 #include <QString>
+#include <QVector>
 
 class SmartDiskInformation;
 
@@ -82,6 +83,10 @@ public:
 
     SmartAttributeParsedData(const SmartAttributeParsedData &other);
 
+public:
+    static QVector<SmartQuirkDataBase> quirkDatabase();
+    static SmartQuirk quirk(const QString& model, const QString& firmware);
+
 public:
     quint32 id() const
     {
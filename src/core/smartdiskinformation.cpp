@@ -26,7 +26,8 @@ SmartDiskInformation::SmartDiskInformation() :
     m_BadAttributeNow(false),
     m_BadAttributeInThePast(false),
     m_SelfTestExecutionStatus(SmartStatus::SelfTestStatus::Success),
-    m_Overall(SmartStatus::Overall::Bad)
+    m_Overall(SmartStatus::Overall::Bad),
+    m_Quirk(SmartQuirk::None)
 {
 }
 
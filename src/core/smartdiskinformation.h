@@ -8,13 +8,12 @@
 #ifndef KPMCORE_SMARTDISKINFORMATION_H
 #define KPMCORE_SMARTDISKINFORMATION_H
 
+#include "core/smartattributeparseddata.h"
 #include "core/smartstatus.h"
 
 #include <QList>
 #include <QString>
 
-class SmartAttributeParsedData;
-
 /** Disk information retrieved by SMART.
 
     It includes a list with your SMART attributes.
@@ -95,6 +94,11 @@ public:
         return m_PowerCycles;    /**< @return quantity of power cycles */
     }
 
+    SmartQuirk quirk() const
+    {
+        return m_Quirk;    /**< @return quirks of the disk model and firmware */
+    }
+
     QList<SmartAttributeParsedData> attributes() const
     {
         return m_Attributes;    /**< @return a list that contains the disk SMART attributes */
@@ -126,6 +130,11 @@ public:
         m_PowerCycles = powerCycleCt;
     }
 
+    void setQuirk(SmartQuirk quirk)
+    {
+        m_Quirk = quirk;
+    }
+
     void setSmartStatus(bool smartStatus)
     {
         m_SmartStatus = smartStatus;
@@ -158,6 +167,7 @@ private:
     bool m_BadAttributeInThePast;
     SmartStatus::SelfTestStatus m_SelfTestExecutionStatus;
     SmartStatus::Overall m_Overall;
+    SmartQuirk m_Quirk;
     QList<SmartAttributeParsedData> m_Attributes;
 };
 
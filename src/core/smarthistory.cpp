@@ -0,0 +1,292 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "core/smarthistory.h"
+
+#include "core/smartattributeparseddata.h"
+#include "core/smartdiskinformation.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace
+{
+constexpr quint32 magic = 0x4b534d48; // "KSMH"
+
+// Increase when the format of the records changes
+constexpr quint32 formatVersion = 1;
+
+constexpr qint64 day = 24 * 60 * 60;
+
+// Every record younger than this is kept, older ones only once per day
+constexpr qint64 fullResolutionAge = 7 * day;
+
+// Records older than this are dropped
+constexpr qint64 maxAge = 2 * 365 * day;
+
+void writeRecord(QDataStream& stream, const SmartHistory::Record& record)
+{
+    stream << record.time << record.temperature << static_cast<quint8>(record.values.size());
+    for (const auto &value : record.values)
+        stream << value.id << value.current << value.worst << value.raw;
+}
+
+/** Drops records that are too old and all but the last record of each day that is older than a week.
+    @param records records ordered by time
+    @param now time of the newest record
+    @return the records that are kept
+*/
+QVector<SmartHistory::Record> retained(const QVector<SmartHistory::Record>& records, qint64 now)
+{
+    QVector<SmartHistory::Record> kept;
+    for (int i = 0; i < records.size(); ++i) {
+        const qint64 time = records[i].time;
+        if (now - time > maxAge)
+            continue;
+
+        const bool lastOfDay = i + 1 == records.size() || records[i + 1].time / day != time / day;
+        if (now - time > fullResolutionAge && !lastOfDay)
+            continue;
+
+        kept.append(records[i]);
+    }
+
+    return kept;
+}
+
+/** @return change of a value per period between the first and the last sample since a time */
+template<typename Sample>
+double rateOf(const QVector<SmartHistory::Record>& records, qint64 period, qint64 since, Sample sample)
+{
+    qint64 firstTime = 0, lastTime = 0;
+    double first = 0, last = 0;
+    bool found = false;
+    for (const auto &record : records) {
+        double value;
+        if (record.time < since || !sample(record, value))
+            continue;
+
+        if (!found) {
+            firstTime = record.time;
+            first = value;
+            found = true;
+        }
+        lastTime = record.time;
+        last = value;
+    }
+
+    if (lastTime <= firstTime)
+        return 0;
+
+    return (last - first) * period / (lastTime - firstTime);
+}
+}
+
+/** @param fileName the file the history is stored in, see SmartHistory::fileName */
+SmartHistory::SmartHistory(const QString& fileName) :
+    m_FileName(fileName)
+{
+}
+
+/** Reads all records from the history file.
+
+    A partially written last record, e.g. after a crash, is cut off the file,
+    so records appended later are not read as part of it.
+
+    @return false if the file exists but is not a SMART history
+*/
+bool SmartHistory::load()
+{
+    m_Records.clear();
+    m_Size = -1;
+
+    QFile file(fileName());
+    if (!file.exists()) {
+        m_Size = 0;
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_10);
+
+    quint32 fileMagic, version;
+    stream >> fileMagic >> version;
+
+    qint64 size = file.pos();
+    if (stream.status() != QDataStream::Ok)
+        size = 0; // not even the header was written
+    else if (fileMagic != magic || version != formatVersion)
+        return false;
+
+    while (size > 0 && !stream.atEnd()) {
+        Record record;
+        quint8 count;
+        stream >> record.time >> record.temperature >> count;
+        record.values.resize(count);
+        for (auto &value : record.values)
+            stream >> value.id >> value.current >> value.worst >> value.raw;
+
+        if (stream.status() != QDataStream::Ok)
+            break;
+
+        m_Records.append(record);
+        size = file.pos();
+    }
+
+    if (size < file.size()) {
+        file.close();
+        if (!QFile::resize(fileName(), size)) {
+            qWarning() << "Could not remove incomplete record from" << fileName();
+            return true;
+        }
+    }
+
+    m_Size = size;
+    return true;
+}
+
+/** Appends a record to the history and its file.
+
+    The file is loaded first if that has not been done yet. If older records
+    have to be thinned out or dropped, the file is written again.
+
+    @param record the record, its time must not be before the last record
+    @return true on success
+*/
+bool SmartHistory::append(const Record& record)
+{
+    if (m_Size < 0 && !load())
+        return false;
+
+    if (!QDir().mkpath(QFileInfo(fileName()).absolutePath()))
+        return false;
+
+    QVector<Record> records = m_Records;
+    records.append(record);
+    const QVector<Record> kept = retained(records, record.time);
+    if (kept.size() != records.size())
+        return rewrite(kept);
+
+    QFile file(fileName());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+        return false;
+
+    // Never write after an incomplete record, it would misalign everything that follows
+    if (file.size() != m_Size)
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_10);
+
+    if (file.size() == 0)
+        stream << magic << formatVersion;
+
+    writeRecord(stream, record);
+
+    if (stream.status() != QDataStream::Ok || !file.flush()) {
+        m_Size = -1;
+        return false;
+    }
+
+    m_Size = file.size();
+    m_Records.append(record);
+    return true;
+}
+
+/** Replaces the history and its file, the old file is kept if writing fails.
+    @param records the new records ordered by time
+    @return true on success
+*/
+bool SmartHistory::rewrite(const QVector<Record>& records)
+{
+    QSaveFile file(fileName());
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_10);
+
+    stream << magic << formatVersion;
+    for (const auto &record : records)
+        writeRecord(stream, record);
+
+    if (stream.status() != QDataStream::Ok || !file.commit())
+        return false;
+
+    m_Size = QFileInfo(fileName()).size();
+    m_Records = records;
+    return true;
+}
+
+/** Rate of change of the raw value of an attribute, e.g. reallocated sectors (id 5) per week.
+    @param id the attribute id
+    @param period length of the period in seconds
+    @param since ignore records older than this, in seconds since the epoch
+    @return change per period, 0 if there are not enough records
+*/
+double SmartHistory::rate(quint8 id, qint64 period, qint64 since) const
+{
+    return rateOf(records(), period, since, [id] (const Record& record, double& raw) {
+        for (const auto &value : record.values) {
+            if (value.id == id) {
+                raw = value.raw;
+                return true;
+            }
+        }
+        return false;
+    });
+}
+
+/** @return change of the temperature in mK per period, see SmartHistory::rate */
+double SmartHistory::temperatureRate(qint64 period, qint64 since) const
+{
+    return rateOf(records(), period, since, [] (const Record& record, double& temperature) {
+        temperature = record.temperature;
+        return record.temperature != 0;
+    });
+}
+
+/** @return a record of the current attributes and temperature of a disk */
+SmartHistory::Record SmartHistory::record(const SmartDiskInformation& disk, qint64 time)
+{
+    Record record;
+    record.time = time;
+    record.temperature = static_cast<quint32>(disk.temperature());
+
+    const QList<SmartAttributeParsedData> attributes = disk.attributes();
+    for (const auto &attribute : attributes) {
+        Value value;
+        value.id = static_cast<quint8>(attribute.id());
+        value.current = static_cast<quint8>(attribute.currentValue());
+        value.worst = static_cast<quint8>(attribute.worstValue());
+        value.raw = attribute.raw();
+        record.values.append(value);
+    }
+
+    return record;
+}
+
+/** @return the directory histories are stored in by default */
+QString SmartHistory::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QStringLiteral("/kpmcore/smart");
+}
+
+/** @return the history file of a disk. Disks are identified by model and serial number, device nodes can change. */
+QString SmartHistory::fileName(const QString& directory, const QString& model, const QString& serial)
+{
+    QString name = model + QLatin1Char('-') + serial;
+    name.replace(QRegularExpression(QStringLiteral("[^A-Za-z0-9._-]")), QStringLiteral("_"));
+    return directory + QLatin1Char('/') + name + QStringLiteral(".history");
+}
@@ -0,0 +1,73 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_SMARTHISTORY_H
+#define KPMCORE_SMARTHISTORY_H
+
+#include "util/libpartitionmanagerexport.h"
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+class SmartDiskInformation;
+
+/** Time series of SMART attributes and temperature of one disk.
+
+    Each poll appends a compact binary record to a file, so the history can
+    be queried without keeping or parsing smartctl output. Records of the
+    last week are all kept, older ones are thinned out to one per day and
+    records older than two years are dropped, so the file stays small.
+
+    @author Andrius Štikonas <andrius@stikonas.eu>
+*/
+class LIBKPMCORE_EXPORT SmartHistory
+{
+public:
+    struct Value {
+        quint8 id = 0;
+        quint8 current = 0;
+        quint8 worst = 0;
+        quint64 raw = 0;
+    };
+
+    struct Record {
+        qint64 time = 0;          /**< seconds since the epoch */
+        quint32 temperature = 0;  /**< mK, 0 if unknown */
+        QVector<Value> values;
+    };
+
+public:
+    explicit SmartHistory(const QString& fileName = QString());
+
+public:
+    const QString& fileName() const {
+        return m_FileName; /**< @return the file the history is stored in */
+    }
+    const QVector<Record>& records() const {
+        return m_Records; /**< @return records ordered by time */
+    }
+
+    bool load();
+    bool append(const Record& record);
+
+    double rate(quint8 id, qint64 period, qint64 since = 0) const;
+    double temperatureRate(qint64 period, qint64 since = 0) const;
+
+    static Record record(const SmartDiskInformation& disk, qint64 time);
+    static QString defaultDirectory();
+    static QString fileName(const QString& directory, const QString& model, const QString& serial);
+
+private:
+    bool rewrite(const QVector<Record>& records);
+
+private:
+    QString m_FileName;
+    QVector<Record> m_Records;
+    qint64 m_Size = -1; /**< size of the complete records in the file, -1 if not loaded */
+};
+
+#endif
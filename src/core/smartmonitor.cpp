@@ -0,0 +1,272 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "core/smartmonitor.h"
+
+#include "core/smartdiskinformation.h"
+#include "core/smartparser.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QSet>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace
+{
+/** @return the file that maps device nodes to the histories they were last polled into */
+QString indexFileName(const QString& directory)
+{
+    return directory + QStringLiteral("/devices");
+}
+
+/** Polls disks in QThreadPool. */
+class PollDevicesRunnable : public QRunnable
+{
+public:
+    explicit PollDevicesRunnable(std::function<void()> poll) : m_Poll(std::move(poll)) {}
+
+    void run() override {
+        m_Poll();
+    }
+
+private:
+    std::function<void()> m_Poll;
+};
+}
+
+struct SmartMonitorPrivate
+{
+    QTimer* m_Timer = nullptr;
+    QThreadPool* m_Pool = nullptr;
+    QStringList m_Devices;
+    QString m_HistoryDirectory;
+
+    // Guards the histories and the disks that are being polled
+    mutable QMutex m_Mutex;
+    QHash<QString, SmartHistory> m_Histories;
+    QSet<QString> m_Polling;
+};
+
+SmartMonitor::SmartMonitor(QObject* parent) :
+    QObject(parent),
+    d(std::make_unique<SmartMonitorPrivate>())
+{
+    d->m_Timer = new QTimer(this);
+    d->m_Timer->setInterval(30 * 60 * 1000);
+    connect(d->m_Timer, &QTimer::timeout, this, &SmartMonitor::poll);
+
+    d->m_Pool = new QThreadPool(this);
+    d->m_HistoryDirectory = SmartHistory::defaultDirectory();
+
+    QMutexLocker locker(&d->m_Mutex);
+    loadHistories();
+}
+
+SmartMonitor::~SmartMonitor()
+{
+    // Running polls emit our signals
+    stop();
+}
+
+void SmartMonitor::setDevices(const QStringList& deviceNodes)
+{
+    d->m_Devices = deviceNodes;
+}
+
+QStringList SmartMonitor::devices() const
+{
+    return d->m_Devices;
+}
+
+void SmartMonitor::setInterval(int seconds)
+{
+    d->m_Timer->setInterval(seconds * 1000);
+}
+
+int SmartMonitor::interval() const
+{
+    return d->m_Timer->interval() / 1000;
+}
+
+void SmartMonitor::setHistoryDirectory(const QString& directory)
+{
+    QMutexLocker locker(&d->m_Mutex);
+    d->m_HistoryDirectory = directory;
+    loadHistories();
+}
+
+QString SmartMonitor::historyDirectory() const
+{
+    QMutexLocker locker(&d->m_Mutex);
+    return d->m_HistoryDirectory;
+}
+
+void SmartMonitor::start()
+{
+    if (isActive())
+        return;
+
+    d->m_Timer->start();
+    poll();
+}
+
+void SmartMonitor::stop()
+{
+    d->m_Timer->stop();
+    d->m_Pool->clear();
+    d->m_Pool->waitForDone();
+
+    // Polls that were cleared before they started did not finish
+    QMutexLocker locker(&d->m_Mutex);
+    d->m_Polling.clear();
+}
+
+bool SmartMonitor::isActive() const
+{
+    return d->m_Timer->isActive();
+}
+
+void SmartMonitor::poll()
+{
+    QStringList deviceNodes;
+    {
+        // A slow disk might still be busy with the previous poll
+        QMutexLocker locker(&d->m_Mutex);
+        for (const auto &deviceNode : qAsConst(d->m_Devices)) {
+            if (d->m_Polling.contains(deviceNode))
+                continue;
+            d->m_Polling.insert(deviceNode);
+            deviceNodes.append(deviceNode);
+        }
+    }
+
+    if (deviceNodes.isEmpty())
+        return;
+
+    d->m_Pool->start(new PollDevicesRunnable([this, deviceNodes] {
+        std::vector<std::unique_ptr<SmartParser>> parsers;
+        QVector<SmartParser*> pointers;
+        for (const auto &deviceNode : deviceNodes) {
+            parsers.push_back(std::make_unique<SmartParser>(deviceNode));
+            parsers.back()->setSkipStandby(true);
+            pointers.append(parsers.back().get());
+        }
+
+        SmartParser::initAll(pointers);
+
+        for (const auto &parser : pointers)
+            recordPoll(*parser);
+
+        QMutexLocker locker(&d->m_Mutex);
+        for (const auto &deviceNode : deviceNodes)
+            d->m_Polling.remove(deviceNode);
+    }));
+}
+
+SmartHistory SmartMonitor::history(const QString& deviceNode) const
+{
+    QMutexLocker locker(&d->m_Mutex);
+    return d->m_Histories.value(deviceNode);
+}
+
+/** Records the SMART data of a disk that was polled. */
+void SmartMonitor::recordPoll(const SmartParser& parser)
+{
+    const QString& deviceNode = parser.devicePath();
+    if (!parser.diskInformation()) {
+        if (parser.isInStandby())
+            Q_EMIT skipped(deviceNode);
+        else
+            qDebug() << "polling SMART data failed for " << deviceNode;
+        return;
+    }
+
+    const SmartDiskInformation* disk = parser.diskInformation();
+    const SmartHistory::Record record = SmartHistory::record(*disk, QDateTime::currentSecsSinceEpoch());
+
+    {
+        QMutexLocker locker(&d->m_Mutex);
+        const QString fileName = SmartHistory::fileName(d->m_HistoryDirectory, disk->model(), disk->serial());
+
+        // Load the history once, or again if another disk now has this device node
+        auto it = d->m_Histories.find(deviceNode);
+        if (it == d->m_Histories.end() || it->fileName() != fileName) {
+            SmartHistory history(fileName);
+            if (!history.load())
+                qWarning() << "Could not read SMART history" << fileName;
+            it = d->m_Histories.insert(deviceNode, history);
+            saveIndex();
+        }
+
+        if (!it->append(record)) {
+            qWarning() << "Could not write SMART history" << fileName;
+            return;
+        }
+    }
+
+    Q_EMIT polled(deviceNode);
+}
+
+/** Loads the histories of the disks polled before, so they are known before the next poll.
+    Must be called with the mutex locked.
+*/
+void SmartMonitor::loadHistories()
+{
+    d->m_Histories.clear();
+
+    QFile index(indexFileName(d->m_HistoryDirectory));
+    if (!index.open(QIODevice::ReadOnly | QIODevice::Text))
+        return;
+
+    // One "<device node> <history file name>" per line
+    QTextStream stream(&index);
+    QString line;
+    while (stream.readLineInto(&line)) {
+        const QStringList fields = line.split(QLatin1Char(' '));
+        if (fields.size() != 2)
+            continue;
+
+        SmartHistory history(d->m_HistoryDirectory + QLatin1Char('/') + fields[1]);
+        if (history.load())
+            d->m_Histories.insert(fields[0], history);
+        else
+            qWarning() << "Could not read SMART history" << history.fileName();
+    }
+}
+
+/** Writes which history each device node was last polled into. Must be called with the mutex locked. */
+void SmartMonitor::saveIndex() const
+{
+    if (!QDir().mkpath(d->m_HistoryDirectory))
+        return;
+
+    QSaveFile index(indexFileName(d->m_HistoryDirectory));
+    if (!index.open(QIODevice::WriteOnly | QIODevice::Text))
+        return;
+
+    QTextStream stream(&index);
+    for (auto it = d->m_Histories.cbegin(); it != d->m_Histories.cend(); ++it)
+        stream << it.key() << QLatin1Char(' ') << QFileInfo(it->fileName()).fileName() << QLatin1Char('\n');
+    stream.flush();
+
+    if (!index.commit())
+        qWarning() << "Could not write" << index.fileName();
+}
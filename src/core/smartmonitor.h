@@ -0,0 +1,78 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_SMARTMONITOR_H
+#define KPMCORE_SMARTMONITOR_H
+
+#include "util/libpartitionmanagerexport.h"
+
+#include "core/smarthistory.h"
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+
+class SmartParser;
+struct SmartMonitorPrivate;
+
+/** Polls SMART data of disks in the background and records their history.
+
+    Disks in standby or sleep mode are skipped, so polling does not spin
+    them up. Every successful poll appends a record to the SmartHistory of
+    the disk. Histories of disks polled in earlier runs are loaded when the
+    monitor is created.
+
+    @author Andrius Štikonas <andrius@stikonas.eu>
+*/
+class LIBKPMCORE_EXPORT SmartMonitor : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(SmartMonitor)
+
+public:
+    explicit SmartMonitor(QObject* parent = nullptr);
+    ~SmartMonitor() override;
+
+public:
+    void setDevices(const QStringList& deviceNodes); /**< @param deviceNodes the disks to poll */
+    QStringList devices() const; /**< @return the disks that are polled */
+
+    void setInterval(int seconds); /**< @param seconds time between polls, default is 30 minutes */
+    int interval() const; /**< @return time between polls in seconds */
+
+    void setHistoryDirectory(const QString& directory); /**< @param directory where histories are stored, default is SmartHistory::defaultDirectory */
+    QString historyDirectory() const; /**< @return where histories are stored */
+
+    void start(); /**< poll now and then at every interval */
+    void stop(); /**< stop polling, waits for running polls */
+    bool isActive() const; /**< @return true if polling */
+
+    void poll(); /**< poll all disks now in the background */
+
+    SmartHistory history(const QString& deviceNode) const; /**< @return history of a disk, also from earlier runs; empty if it was never polled */
+
+Q_SIGNALS:
+    /**< Emitted when new SMART data of a disk has been recorded.
+         @param deviceNode the disk
+    */
+    void polled(const QString& deviceNode);
+
+    /**< Emitted when a disk was not polled because it is in standby or sleep mode.
+         @param deviceNode the disk
+    */
+    void skipped(const QString& deviceNode);
+
+private:
+    void recordPoll(const SmartParser& parser);
+    void loadHistories();
+    void saveIndex() const;
+
+    std::unique_ptr<SmartMonitorPrivate> d;
+};
+
+#endif
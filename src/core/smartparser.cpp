@@ -17,7 +17,43 @@
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QRunnable>
 #include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+
+namespace
+{
+/** Runs SmartParser::init in QThreadPool. */
+class SmartParserRunnable : public QRunnable
+{
+public:
+    explicit SmartParserRunnable(SmartParser& parser) : m_Parser(parser) {}
+
+    void run() override {
+        m_Parser.init();
+    }
+
+private:
+    SmartParser& m_Parser;
+};
+}
+
+/** @return true if smartctl skipped the disk, e.g. "Device is in STANDBY mode, exit(2)" */
+static bool isStandbyOutput(const QByteArray& output)
+{
+    const QJsonArray messages = QJsonDocument::fromJson(output).object()[QLatin1String("smartctl")].toObject()[QLatin1String("messages")].toArray();
+    for (const auto &message : messages) {
+        const QString text = message.toObject()[QLatin1String("string")].toString();
+        if (text.contains(QStringLiteral("STANDBY")) || text.contains(QStringLiteral("SLEEP")))
+            return true;
+    }
+
+    return false;
+}
 
 /** Creates a new SmartParser object
     @param device_path device path that indicates the device that SMART must analyze
@@ -28,6 +64,17 @@ SmartParser::SmartParser(const QString &device_path) :
 {
 }
 
+/** Creates a new SmartParser object for output that smartctl has already printed, e.g. recorded earlier
+    @param device_path device path that indicates the device that SMART must analyze
+    @param smartOutput output of smartctl --all --json
+*/
+SmartParser::SmartParser(const QString &device_path, const QJsonDocument &smartOutput) :
+    m_DevicePath(device_path),
+    m_SmartOutput(smartOutput),
+    m_DiskInformation(nullptr)
+{
+}
+
 SmartParser::~SmartParser()
 {
     delete m_DiskInformation;
@@ -80,6 +127,7 @@ bool SmartParser::init()
 
     m_DiskInformation->setModel(smartJson[model_name].toString());
     m_DiskInformation->setFirmware(smartJson[firmware].toString());
+    m_DiskInformation->setQuirk(SmartAttributeParsedData::quirk(m_DiskInformation->model(), m_DiskInformation->firmware()));
     m_DiskInformation->setSerial(smartJson[serial_number].toString());
 
     const auto user_capacity_object = smartJson[user_capacity].toObject();
@@ -109,17 +157,41 @@ bool SmartParser::init()
     return true;
 }
 
+/** Initializes several parsers concurrently, so that waiting for smartctl on one disk does not delay the others.
+    @param parsers the parsers, init() tells for each whether it succeeded
+*/
+void SmartParser::initAll(const QVector<SmartParser*> &parsers)
+{
+    QThreadPool pool;
+    pool.setMaxThreadCount(qBound(1, parsers.size(), std::max(QThread::idealThreadCount(), 4)));
+
+    for (const auto &parser : parsers)
+        pool.start(new SmartParserRunnable(*parser));
+
+    pool.waitForDone();
+}
+
 /** Run smartctl command and recover its output */
 void SmartParser::loadSmartOutput()
 {
     if (m_SmartOutput.isEmpty()) {
-        ExternalCommand smartctl(QStringLiteral("smartctl"), { QStringLiteral("--all"), QStringLiteral("--json"), devicePath() });
+        QStringList args = { QStringLiteral("--all"), QStringLiteral("--json"), devicePath() };
+        // smartctl checks the power mode without spinning the disk up and exits with 2 if it is asleep
+        if (m_SkipStandby)
+            args.prepend(QStringLiteral("--nocheck=standby"));
+
+        ExternalCommand smartctl(QStringLiteral("smartctl"), args);
 
-        if (smartctl.run() && smartctl.exitCode() == 0) {
+        // Bits 0 and 1 of the exit code mean the disk could not be read, bit 2 that a SMART
+        // command failed or its data has a bad checksum. Higher bits report failing attributes,
+        // logged errors and the like, the output is complete then.
+        if (smartctl.run() && (smartctl.exitCode() & 0x07) == 0) {
             QByteArray output = smartctl.rawOutput();
 
             m_SmartOutput = QJsonDocument::fromJson(output);
         }
+        else if (m_SkipStandby && smartctl.exitCode() == 2 && isStandbyOutput(smartctl.rawOutput()))
+            m_InStandby = true;
         else
             qDebug() << "smartctl initialization failed for " << devicePath() << ": " << strerror(errno);
     }
@@ -9,6 +9,7 @@
 
 #include <QJsonDocument>
 #include <QString>
+#include <QVector>
 
 class SmartDiskInformation;
 
@@ -22,11 +23,14 @@ class SmartParser
 {
 public:
     explicit SmartParser(const QString &device_path);
+    SmartParser(const QString &device_path, const QJsonDocument &smartOutput);
     ~SmartParser();
 
 public:
     bool init();
 
+    static void initAll(const QVector<SmartParser*> &parsers);
+
 public:
     const QString &devicePath() const
     {
@@ -38,6 +42,16 @@ public:
         return m_DiskInformation; /**< @return a reference to parsed disk information */
     }
 
+    void setSkipStandby(bool skip)
+    {
+        m_SkipStandby = skip; /**< @param skip do not wake up disks in standby or sleep mode */
+    }
+
+    bool isInStandby() const
+    {
+        return m_InStandby; /**< @return true if the disk was skipped because it is in standby or sleep mode */
+    }
+
 protected:
     void loadSmartOutput();
 
@@ -47,7 +61,8 @@ private:
     const QString m_DevicePath;
     QJsonDocument m_SmartOutput;
     SmartDiskInformation *m_DiskInformation;
-
+    bool m_SkipStandby = false;
+    bool m_InStandby = false;
 };
 
 #endif // SMARTPARSER_H
@@ -9,6 +9,8 @@
 */
 
 #include "fs/btrfs.h"
+#include "fs/superblock.h"
+#include "fs/toolprobe.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
@@ -59,9 +61,10 @@ void btrfs::init()
     m_GetUUID = cmdSupportCore;
 
     if (m_Create == cmdSupportFileSystem) {
-        ExternalCommand cmd(QStringLiteral("mkfs.btrfs"), QStringList() << QStringLiteral("-O") << QStringLiteral("list-all"));
-        if (cmd.run(-1) && cmd.exitCode() == 0) {
-            QStringList lines = cmd.output().split(QStringLiteral("\n"));
+        int exitCode;
+        QByteArray output;
+        if (ToolProbe::probe(QStringLiteral("mkfs.btrfs"), { QStringLiteral("-O"), QStringLiteral("list-all") }, exitCode, output) && exitCode == 0) {
+            QStringList lines = QString::fromLocal8Bit(output).split(QStringLiteral("\n"));
 
             // First line is introductory text, we don't need it
             lines.removeFirst();
@@ -114,6 +117,10 @@ int btrfs::maxLabelLength() const
 
 qint64 btrfs::readUsedCapacity(const QString& deviceNode) const
 {
+    const qint64 used = FS::Superblock::btrfsUsedCapacity(deviceNode);
+    if (used > -1)
+        return used;
+
     ExternalCommand cmd(QStringLiteral("btrfs"),
                         { QStringLiteral("filesystem"), QStringLiteral("show"), QStringLiteral("--raw"), deviceNode });
 
@@ -0,0 +1,242 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "fs/cryptbenchmark.h"
+
+#include "util/externalcommand.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QSysInfo>
+#include <QThreadPool>
+
+namespace
+{
+// Increase when the format of the cache changes
+constexpr int cacheVersion = 1;
+
+// Ciphers that are considered safe for new volumes, with the key sizes to use
+const struct {
+    const char* algorithm;
+    qint64 keySize;
+} safeCiphers[] = {
+    { "aes-xts", 512 },
+    { "serpent-xts", 512 },
+    { "twofish-xts", 512 },
+    { "xchacha12,aes-adiantum", 256 }, // much faster than AES on CPUs without AES instructions
+};
+
+struct BenchmarkCache
+{
+    QMutex mutex;
+    QVector<FS::CryptBenchmark::Result> results;
+    bool done = false;
+};
+
+BenchmarkCache& benchmarkCache()
+{
+    static BenchmarkCache cache;
+    return cache;
+}
+
+/** @return what the benchmark results depend on: the kernel's crypto drivers and the CPU */
+QJsonObject stamp()
+{
+    QString cpu;
+    QFile cpuinfo(QStringLiteral("/proc/cpuinfo"));
+    if (cpuinfo.open(QIODevice::ReadOnly)) {
+        const QRegularExpressionMatch match = QRegularExpression(QStringLiteral("^model name\\s*:\\s*(.*)$"), QRegularExpression::MultilineOption)
+                                                  .match(QString::fromLocal8Bit(cpuinfo.readAll()));
+        cpu = match.captured(1).trimmed();
+    }
+
+    return QJsonObject {
+        { QStringLiteral("kernel"), QSysInfo::kernelVersion() },
+        { QStringLiteral("architecture"), QSysInfo::currentCpuArchitecture() },
+        { QStringLiteral("cpu"), cpu },
+    };
+}
+
+bool load(BenchmarkCache& cache, const QJsonObject& currentStamp)
+{
+    QFile file(FS::CryptBenchmark::fileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const QJsonObject json = QJsonDocument::fromJson(file.readAll()).object();
+    if (json[QLatin1String("version")].toInt() != cacheVersion || json[QLatin1String("stamp")].toObject() != currentStamp)
+        return false;
+
+    for (const auto &value : json[QLatin1String("results")].toArray()) {
+        const QJsonObject entry = value.toObject();
+        FS::CryptBenchmark::Result result;
+        result.algorithm = entry[QLatin1String("algorithm")].toString();
+        result.keySize = entry[QLatin1String("keySize")].toInt();
+        result.encryption = entry[QLatin1String("encryption")].toDouble();
+        result.decryption = entry[QLatin1String("decryption")].toDouble();
+        cache.results.append(result);
+    }
+
+    return !cache.results.isEmpty();
+}
+
+void save(const BenchmarkCache& cache, const QJsonObject& currentStamp)
+{
+    QJsonArray results;
+    for (const auto &result : cache.results) {
+        results.append(QJsonObject {
+            { QStringLiteral("algorithm"), result.algorithm },
+            { QStringLiteral("keySize"), result.keySize },
+            { QStringLiteral("encryption"), result.encryption },
+            { QStringLiteral("decryption"), result.decryption },
+        });
+    }
+
+    const QJsonObject json {
+        { QStringLiteral("version"), cacheVersion },
+        { QStringLiteral("stamp"), currentStamp },
+        { QStringLiteral("results"), results },
+    };
+
+    if (!QDir().mkpath(QFileInfo(FS::CryptBenchmark::fileName()).absolutePath()))
+        return;
+
+    QSaveFile file(FS::CryptBenchmark::fileName());
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(json).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
+
+/** Runs the benchmark in QThreadPool, see FS::CryptBenchmark::prepare */
+class BenchmarkRunnable : public QRunnable
+{
+public:
+    void run() override {
+        FS::CryptBenchmark::results();
+    }
+};
+
+void run(BenchmarkCache& cache)
+{
+    ExternalCommand cmd(QStringLiteral("cryptsetup"), { QStringLiteral("benchmark") });
+    if (!cmd.run(-1) || cmd.exitCode() != 0)
+        return;
+
+    // e.g. "        aes-xts        512b      2842.7 MiB/s      2861.3 MiB/s", ciphers the kernel lacks print "N/A"
+    QRegularExpression re(QStringLiteral("^\\s*([\\w,-]+)\\s+(\\d+)b\\s+([\\d.]+) MiB/s\\s+([\\d.]+) MiB/s"), QRegularExpression::MultilineOption);
+    QRegularExpressionMatchIterator i = re.globalMatch(cmd.output());
+    while (i.hasNext()) {
+        const QRegularExpressionMatch match = i.next();
+        FS::CryptBenchmark::Result result;
+        result.algorithm = match.captured(1);
+        if (result.algorithm.endsWith(QStringLiteral("-plain64")))
+            result.algorithm.chop(8);
+        result.keySize = match.captured(2).toLongLong();
+        result.encryption = match.captured(3).toDouble();
+        result.decryption = match.captured(4).toDouble();
+        cache.results.append(result);
+    }
+}
+}
+
+namespace FS
+{
+namespace CryptBenchmark
+{
+/** @return the cipher specification for cryptsetup's --cipher option, e.g. "aes-xts-plain64" */
+QString Result::cipher() const
+{
+    return algorithm + QStringLiteral("-plain64");
+}
+
+/** @return results of all ciphers cryptsetup benchmarked, empty if cryptsetup could not be run */
+QVector<Result> results()
+{
+    BenchmarkCache& cache = benchmarkCache();
+
+    // Callers wait for a running benchmark instead of starting another one
+    QMutexLocker locker(&cache.mutex);
+    if (!cache.done) {
+        cache.done = true;
+        const QJsonObject currentStamp = stamp();
+        if (!load(cache, currentStamp)) {
+            run(cache);
+            if (!cache.results.isEmpty())
+                save(cache, currentStamp);
+        }
+    }
+
+    return cache.results;
+}
+
+/** @return results of an earlier benchmark from this process or the cache file.
+    Never runs the benchmark or waits for it, empty if there are no results yet.
+*/
+QVector<Result> availableResults()
+{
+    BenchmarkCache& cache = benchmarkCache();
+
+    // A benchmark is running
+    if (!cache.mutex.tryLock())
+        return QVector<Result>();
+
+    if (!cache.done && load(cache, stamp()))
+        cache.done = true;
+
+    const QVector<Result> results = cache.results;
+    cache.mutex.unlock();
+    return results;
+}
+
+/** Starts the benchmark in the background unless its results are known already.
+    Call this when a LUKS container is going to be created, so that fastestCipher
+    does not have to wait for it later.
+*/
+void prepare()
+{
+    if (availableResults().isEmpty())
+        QThreadPool::globalInstance()->start(new BenchmarkRunnable);
+}
+
+/** @param wait run the benchmark if needed, otherwise only use available results
+    @return the safe cipher with the highest throughput, invalid if the benchmark failed or is not done.
+    The slower of encryption and decryption counts.
+*/
+Result fastestCipher(bool wait)
+{
+    Result fastest;
+    double fastestSpeed = 0;
+    for (const auto &result : wait ? results() : availableResults()) {
+        for (const auto &safeCipher : safeCiphers) {
+            const double speed = qMin(result.encryption, result.decryption);
+            if (result.algorithm == QLatin1String(safeCipher.algorithm) && result.keySize == safeCipher.keySize && speed > fastestSpeed) {
+                fastest = result;
+                fastestSpeed = speed;
+            }
+        }
+    }
+
+    return fastest;
+}
+
+/** @return the name of the cache file */
+QString fileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/kpmcore/cryptbenchmark.json");
+}
+}
+}
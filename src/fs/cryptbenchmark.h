@@ -0,0 +1,48 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_CRYPTBENCHMARK_H
+#define KPMCORE_CRYPTBENCHMARK_H
+
+#include "util/libpartitionmanagerexport.h"
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+namespace FS
+{
+/** Cipher throughput as measured by "cryptsetup benchmark".
+
+    The benchmark takes several seconds, so it runs at most once per
+    process, in the background if started with prepare(). Its results are
+    kept in a cache file and reused as long as the kernel and the CPU stay
+    the same. All functions are thread-safe.
+*/
+namespace CryptBenchmark
+{
+struct LIBKPMCORE_EXPORT Result
+{
+    QString algorithm;      /**< as printed by cryptsetup, e.g. "aes-xts" */
+    qint64 keySize = 0;     /**< in bits */
+    double encryption = 0;  /**< MiB/s */
+    double decryption = 0;  /**< MiB/s */
+
+    QString cipher() const;
+    bool isValid() const {
+        return !algorithm.isEmpty();
+    }
+};
+
+LIBKPMCORE_EXPORT QVector<Result> results();
+LIBKPMCORE_EXPORT QVector<Result> availableResults();
+LIBKPMCORE_EXPORT void prepare();
+LIBKPMCORE_EXPORT Result fastestCipher(bool wait = true);
+LIBKPMCORE_EXPORT QString fileName();
+}
+}
+
+#endif
@@ -8,6 +8,7 @@
 */
 
 #include "fs/exfat.h"
+#include "fs/superblock.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
@@ -40,6 +41,7 @@ void exfat::init()
     m_Check = findExternal(QStringLiteral("exfatfsck"), QStringList(), 1) ? cmdSupportFileSystem : cmdSupportNone;
 
     m_GetLabel = cmdSupportCore;
+    m_GetUsed = cmdSupportCore;
     m_SetLabel = findExternal(QStringLiteral("exfatlabel")) ? cmdSupportFileSystem : cmdSupportNone;
     m_UpdateUUID = cmdSupportNone;
 
@@ -54,7 +56,7 @@ void exfat::init()
 bool exfat::supportToolFound() const
 {
     return
-//          m_GetUsed != cmdSupportNone &&
+        m_GetUsed != cmdSupportNone &&
         m_GetLabel != cmdSupportNone &&
         m_SetLabel != cmdSupportNone &&
         m_Create != cmdSupportNone &&
@@ -83,6 +85,11 @@ int exfat::maxLabelLength() const
     return 15;
 }
 
+qint64 exfat::readUsedCapacity(const QString& deviceNode) const
+{
+    return FS::Superblock::exfatUsedCapacity(deviceNode);
+}
+
 bool exfat::check(Report& report, const QString& deviceNode) const
 {
     ExternalCommand cmd(report, QStringLiteral("exfatfsck"), { deviceNode });
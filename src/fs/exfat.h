@@ -33,7 +33,7 @@ public:
 public:
     void init() override;
 
-//          qint64 readUsedCapacity(const QString& deviceNode) const override;
+    qint64 readUsedCapacity(const QString& deviceNode) const override;
     bool check(Report& report, const QString& deviceNode) const override;
     bool create(Report& report, const QString& deviceNode) override;
 //          bool resize(Report& report, const QString& deviceNode, qint64 length) const override;
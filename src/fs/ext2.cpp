@@ -8,6 +8,7 @@
 */
 
 #include "fs/ext2.h"
+#include "fs/superblock.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
@@ -116,6 +117,10 @@ int ext2::maxLabelLength() const
 
 qint64 ext2::readUsedCapacity(const QString& deviceNode) const
 {
+    const qint64 used = FS::Superblock::ext2UsedCapacity(deviceNode);
+    if (used > -1)
+        return used;
+
     ExternalCommand cmd(QStringLiteral("dumpe2fs"), { QStringLiteral("-h"), deviceNode });
 
     if (cmd.run()) {
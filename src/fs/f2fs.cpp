@@ -7,6 +7,8 @@
 */
 
 #include "fs/f2fs.h"
+#include "fs/superblock.h"
+#include "fs/toolprobe.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
@@ -47,8 +49,9 @@ void f2fs::init()
     m_Check = findExternal(QStringLiteral("fsck.f2fs")) ? cmdSupportFileSystem : cmdSupportNone;
 
     if (m_Create == cmdSupportFileSystem) {
-        ExternalCommand cmd(QStringLiteral("mkfs.f2fs"), {});
-        oldVersion = cmd.run(-1) && !cmd.output().contains(QStringLiteral("-f"));
+        int exitCode;
+        QByteArray output;
+        oldVersion = ToolProbe::probe(QStringLiteral("mkfs.f2fs"), {}, exitCode, output) && !QString::fromLocal8Bit(output).contains(QStringLiteral("-f"));
     }
 
     m_GetLabel = cmdSupportCore;
@@ -56,7 +59,7 @@ void f2fs::init()
 //     m_UpdateUUID = findExternal(QStringLiteral("nilfs-tune")) ? cmdSupportFileSystem : cmdSupportNone;
 
     m_Grow = (m_Check != cmdSupportNone && findExternal(QStringLiteral("resize.f2fs"))) ? cmdSupportFileSystem : cmdSupportNone;
-//     m_GetUsed = findExternal(QStringLiteral("nilfs-tune")) ? cmdSupportFileSystem : cmdSupportNone;
+    m_GetUsed = cmdSupportCore;
 //     m_Shrink = (m_Grow != cmdSupportNone && m_GetUsed != cmdSupportNone) ? cmdSupportFileSystem : cmdSupportNone;
 
     m_Copy = (m_Check != cmdSupportNone) ? cmdSupportCore : cmdSupportNone;
@@ -70,7 +73,7 @@ void f2fs::init()
 bool f2fs::supportToolFound() const
 {
     return
-//         m_GetUsed != cmdSupportNone &&
+        m_GetUsed != cmdSupportNone &&
         m_GetLabel != cmdSupportNone &&
 //         m_SetLabel != cmdSupportNone &&
         m_Create != cmdSupportNone &&
@@ -104,6 +107,11 @@ int f2fs::maxLabelLength() const
     return 80;
 }
 
+qint64 f2fs::readUsedCapacity(const QString& deviceNode) const
+{
+    return FS::Superblock::f2fsUsedCapacity(deviceNode);
+}
+
 bool f2fs::check(Report& report, const QString& deviceNode) const
 {
     ExternalCommand cmd(report, QStringLiteral("fsck.f2fs"), { deviceNode });
@@ -32,11 +32,10 @@ public:
 public:
     void init() override;
 
-//          qint64 readUsedCapacity(const QString& deviceNode) const override;
     bool check(Report& report, const QString& deviceNode) const override;
     bool create(Report& report, const QString& deviceNode) override;
     bool createWithLabel(Report& report, const QString& deviceNode, const QString& label) override;
-//     qint64 readUsedCapacity(const QString& deviceNode) const override;
+    qint64 readUsedCapacity(const QString& deviceNode) const override;
     bool resize(Report& report, const QString& deviceNode, qint64 length) const override;
 //     bool writeLabel(Report& report, const QString& deviceNode, const QString& newLabel) override;
 //     bool updateUUID(Report& report, const QString& deviceNode) const override;
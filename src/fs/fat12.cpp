@@ -10,6 +10,7 @@
 */
 
 #include "fs/fat12.h"
+#include "fs/superblock.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
@@ -110,6 +111,10 @@ QValidator* fat12::labelValidator(QObject *parent) const
 
 qint64 fat12::readUsedCapacity(const QString& deviceNode) const
 {
+    const qint64 used = FS::Superblock::fatUsedCapacity(deviceNode);
+    if (used > -1)
+        return used;
+
     ExternalCommand cmd(QStringLiteral("fsck.fat"), { QStringLiteral("-n"), QStringLiteral("-v"), deviceNode });
 
     // Exit code 1 is returned when FAT dirty bit is set
@@ -14,8 +14,10 @@
 
 #include "fs/filesystem.h"
 #include "core/fstab.h"
+#include "core/mounttable.h"
 
 #include "fs/lvm2_pv.h"
+#include "fs/toolprobe.h"
 
 #include "backend/corebackend.h"
 #include "backend/corebackendmanager.h"
@@ -28,9 +30,10 @@
 
 #include <QColor>
 #include <QFile>
-#include <QFileInfo>
-#include <QStandardPaths>
-#include <QStorageInfo>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <atomic>
 
 const std::vector<QColor> FileSystem::defaultColorCode =
 {
@@ -82,6 +85,72 @@ struct FileSystemPrivate {
     QString m_UUID;
     QStringList m_AvailableFeatures;
     QVariantMap m_Features;
+
+    // Properties that are read on first access, e.g. by the GUI or a background prefetch
+    QMutex m_ReaderMutex { QMutex::Recursive };
+    std::atomic<bool> m_HasReaders { false };
+    std::function<qint64()> m_SectorsUsedReader;
+    std::function<QString()> m_LabelReader;
+    std::function<QString()> m_UUIDReader;
+
+    template <typename T>
+    void resolve(std::function<T()>& reader, T& value)
+    {
+        if (!m_HasReaders)
+            return;
+
+        QMutexLocker locker(&m_ReaderMutex);
+        if (reader) {
+            // Reset the reader before calling it in case it accesses the property itself
+            const std::function<T()> read = std::move(reader);
+            reader = nullptr;
+            value = read();
+        }
+        updateHasReaders();
+    }
+
+    template <typename T>
+    void set(std::function<T()>& reader, T& value, const T& newValue)
+    {
+        QMutexLocker locker(&m_ReaderMutex);
+        reader = nullptr;
+        value = newValue;
+        updateHasReaders();
+    }
+
+    // Calls a copy of the reader, so that the FileSystem itself is left unchanged
+    template <typename T>
+    bool read(const std::function<T()>& reader, T& value)
+    {
+        std::function<T()> read;
+        {
+            QMutexLocker locker(&m_ReaderMutex);
+            read = reader;
+        }
+        if (!read)
+            return false;
+
+        value = read();
+        return true;
+    }
+
+    // Stores a value from read() unless the property was set or read in the meantime
+    template <typename T>
+    void apply(std::function<T()>& reader, T& value, bool hasValue, const T& newValue)
+    {
+        QMutexLocker locker(&m_ReaderMutex);
+        if (!hasValue || !reader)
+            return;
+
+        reader = nullptr;
+        value = newValue;
+        updateHasReaders();
+    }
+
+    void updateHasReaders()
+    {
+        m_HasReaders = m_SectorsUsedReader || m_LabelReader || m_UUIDReader;
+    }
 };
 
 /** Creates a new FileSystem object
@@ -150,16 +219,7 @@ QString FileSystem::detectMountPoint(FileSystem* fs, const QString& partitionPat
     if (partitionPath.isEmpty()) // Happens when during initial scan LUKS is closed
         return QString();
 
-    QStringList mountPoints;
-    QFileInfo partitionPathFileInfo(partitionPath);
-    QString partitionCanonicalPath = partitionPathFileInfo.canonicalFilePath();
-    const QList<QStorageInfo> mountedVolumes = QStorageInfo::mountedVolumes();
-    for (const QStorageInfo &storage : mountedVolumes) {
-        if (partitionCanonicalPath == QFileInfo(QFile::decodeName(storage.device())).canonicalFilePath() ) {
-            mountPoints.append(storage.rootPath());
-        }
-    }
-
+    QStringList mountPoints = MountTable::current()->mountPoints(partitionPath);
     mountPoints.append(possibleMountPoints(partitionPath));
 
     return mountPoints.isEmpty() ? QString() : mountPoints.first();
@@ -172,7 +232,7 @@ bool FileSystem::detectMountStatus(FileSystem* fs, const QString& partitionPath)
     if (fs->type() == FileSystem::Type::Lvm2_PV) {
         mounted = !FS::lvm2_pv::getVGName(partitionPath).isEmpty();
     } else {
-        mounted = isMounted(partitionPath);
+        mounted = MountTable::current()->isMounted(partitionPath);
     }
     return mounted;
 }
@@ -587,17 +647,12 @@ qint64 FileSystem::lastSector() const
 
 bool FileSystem::findExternal(const QString& cmdName, const QStringList& args, int expectedCode)
 {
-    QString cmdFullPath = QStandardPaths::findExecutable(cmdName);
-    if (cmdFullPath.isEmpty())
-        cmdFullPath = QStandardPaths::findExecutable(cmdName, { QStringLiteral("/sbin/"), QStringLiteral("/usr/sbin/"), QStringLiteral("/usr/local/sbin/") });
-    if (cmdFullPath.isEmpty())
+    int exitCode;
+    QByteArray output;
+    if (!FS::ToolProbe::probe(cmdName, args, exitCode, output))
         return false;
 
-    ExternalCommand cmd(cmdFullPath, args);
-    if (!cmd.run())
-        return false;
-
-    return cmd.exitCode() == 0 || cmd.exitCode() == expectedCode;
+    return exitCode == 0 || exitCode == expectedCode;
 }
 
 void FileSystem::addAvailableFeature(const QString& name)
@@ -639,6 +694,7 @@ void FileSystem::setLastSector(qint64 s)
 
 const QString& FileSystem::label() const
 {
+    d->resolve(d->m_LabelReader, d->m_Label);
     return d->m_Label;
 }
 
@@ -659,11 +715,13 @@ qint64 FileSystem::sectorSize() const
 
 qint64 FileSystem::sectorsUsed() const
 {
+    d->resolve(d->m_SectorsUsedReader, d->m_SectorsUsed);
     return d->m_SectorsUsed;
 }
 
 const QString& FileSystem::uuid() const
 {
+    d->resolve(d->m_UUIDReader, d->m_UUID);
     return d->m_UUID;
 }
 
@@ -674,15 +732,80 @@ void FileSystem::setSectorSize(qint64 s)
 
 void FileSystem::setSectorsUsed(qint64 s)
 {
-    d->m_SectorsUsed = s;
+    d->set(d->m_SectorsUsedReader, d->m_SectorsUsed, s);
 }
 
 void FileSystem::setLabel(const QString& s)
 {
-    d->m_Label = s;
+    d->set(d->m_LabelReader, d->m_Label, s);
 }
 
 void FileSystem::setUUID(const QString& s)
 {
-    d->m_UUID = s;
+    d->set(d->m_UUIDReader, d->m_UUID, s);
+}
+
+void FileSystem::setSectorsUsedReader(const std::function<qint64()>& reader)
+{
+    QMutexLocker locker(&d->m_ReaderMutex);
+    d->m_SectorsUsedReader = reader;
+    d->updateHasReaders();
+}
+
+void FileSystem::setLabelReader(const std::function<QString()>& reader)
+{
+    QMutexLocker locker(&d->m_ReaderMutex);
+    d->m_LabelReader = reader;
+    d->updateHasReaders();
+}
+
+void FileSystem::setUUIDReader(const std::function<QString()>& reader)
+{
+    QMutexLocker locker(&d->m_ReaderMutex);
+    d->m_UUIDReader = reader;
+    d->updateHasReaders();
+}
+
+bool FileSystem::isResolved() const
+{
+    return !d->m_HasReaders;
+}
+
+/** Reads all properties that were deferred with one of the set*Reader() methods.
+
+    Safe to call from a background thread while other threads access the FileSystem.
+*/
+void FileSystem::resolve() const
+{
+    d->resolve(d->m_SectorsUsedReader, d->m_SectorsUsed);
+    d->resolve(d->m_LabelReader, d->m_Label);
+    d->resolve(d->m_UUIDReader, d->m_UUID);
+}
+
+/** Reads all properties that were deferred with one of the set*Reader() methods without storing them.
+
+    Unlike resolve() this does not modify the FileSystem, so it can run in a background
+    thread while the FileSystem is only kept alive. Store the result with applyDetails()
+    in the thread that owns the FileSystem.
+*/
+FileSystem::Details FileSystem::readDetails() const
+{
+    Details details;
+    if (!d->m_HasReaders)
+        return details;
+
+    details.hasSectorsUsed = d->read(d->m_SectorsUsedReader, details.sectorsUsed);
+    details.hasLabel = d->read(d->m_LabelReader, details.label);
+    details.hasUUID = d->read(d->m_UUIDReader, details.uuid);
+    return details;
+}
+
+/** Stores properties read by readDetails() that are still deferred.
+    @param details the properties to store
+*/
+void FileSystem::applyDetails(const Details& details)
+{
+    d->apply(d->m_SectorsUsedReader, d->m_SectorsUsed, details.hasSectorsUsed, details.sectorsUsed);
+    d->apply(d->m_LabelReader, d->m_Label, details.hasLabel, details.label);
+    d->apply(d->m_UUIDReader, d->m_UUID, details.hasUUID, details.uuid);
 }
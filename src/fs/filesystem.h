@@ -26,6 +26,7 @@
 #include <QtGlobal>
 #include <QUrl>
 
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -299,6 +300,33 @@ public:
     /**< @param s the new UUID */
     void setUUID(const QString& s);
 
+    /**< @param reader reads the sectors in use when sectorsUsed() is first called */
+    void setSectorsUsedReader(const std::function<qint64()>& reader);
+
+    /**< @param reader reads the label when label() is first called */
+    void setLabelReader(const std::function<QString()>& reader);
+
+    /**< @param reader reads the UUID when uuid() is first called */
+    void setUUIDReader(const std::function<QString()>& reader);
+
+    /**< @return true if no properties are left to be read on first access */
+    bool isResolved() const;
+
+    void resolve() const;
+
+    /** Properties that were deferred with one of the set*Reader() methods, see readDetails() */
+    struct Details {
+        bool hasSectorsUsed = false;
+        qint64 sectorsUsed = -1;
+        bool hasLabel = false;
+        QString label;
+        bool hasUUID = false;
+        QString uuid;
+    };
+
+    Details readDetails() const;
+    void applyDetails(const Details& details);
+
 protected:
     static bool findExternal(const QString& cmdName, const QStringList& args = QStringList(), int exptectedCode = 1);
     void addAvailableFeature(const QString& name);
@@ -48,11 +48,80 @@
 #include "fs/xfs.h"
 #include "fs/zfs.h"
 
+#include "fs/toolprobe.h"
+
 #include "backend/corebackendmanager.h"
 #include "backend/corebackend.h"
 
+#include "util/externalcommand.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+
 FileSystemFactory::FileSystems FileSystemFactory::m_FileSystems;
 
+namespace
+{
+/** FileSystems whose support is probed together by running their tools. */
+struct ProbeGroup
+{
+    QList<FileSystem*> fileSystems;
+    QMutex mutex;
+    std::atomic<bool> probed { false };
+};
+
+/** FileSystem classes of these types share static support flags, probe them one after another in this order. */
+const QList<QList<FileSystem::Type>> sharedSupport = {
+    { FileSystem::Type::Ext2, FileSystem::Type::Ext3, FileSystem::Type::Ext4 },
+    { FileSystem::Type::Fat12, FileSystem::Type::Fat16, FileSystem::Type::Fat32 },
+    { FileSystem::Type::Luks, FileSystem::Type::Luks2 },
+};
+
+QMap<FileSystem::Type, std::shared_ptr<ProbeGroup>> probeGroups;
+
+class ProbeRunnable : public QRunnable
+{
+public:
+    explicit ProbeRunnable(std::function<void()> probe) : m_Probe(std::move(probe)) {}
+    void run() override { m_Probe(); }
+
+private:
+    std::function<void()> m_Probe;
+};
+
+/** @return true if the tools were probed by this call */
+bool probe(ProbeGroup& group)
+{
+    if (group.probed)
+        return false;
+
+    QMutexLocker locker(&group.mutex);
+    if (group.probed)
+        return false;
+
+    for (const auto &fs : qAsConst(group.fileSystems))
+        fs->init();
+
+    group.probed = true;
+    return true;
+}
+
+void probe(FileSystem::Type t)
+{
+    const auto group = probeGroups.value(t);
+    if (group && probe(*group))
+        FS::ToolProbe::save();
+}
+}
+
 /** Initializes the instance. */
 void FileSystemFactory::init()
 {
@@ -92,13 +161,27 @@ void FileSystemFactory::init()
     fileSystems.insert(FileSystem::Type::Xfs, new FS::xfs(-1, -1, -1, QString()));
     fileSystems.insert(FileSystem::Type::Zfs, new FS::zfs(-1, -1, -1, QString()));
 
-    for (const auto &fs : qAsConst(fileSystems))
-        fs->init();
-
     qDeleteAll(m_FileSystems);
     m_FileSystems.clear();
     m_FileSystems = fileSystems;
 
+    // Support of each type is only probed when a FileSystem of that type is first created
+    probeGroups.clear();
+    for (const auto &types : sharedSupport) {
+        auto group = std::make_shared<ProbeGroup>();
+        for (const auto &t : types) {
+            group->fileSystems.append(fileSystems.value(t));
+            probeGroups.insert(t, group);
+        }
+    }
+    for (auto it = fileSystems.cbegin(); it != fileSystems.cend(); ++it) {
+        if (!probeGroups.contains(it.key())) {
+            auto group = std::make_shared<ProbeGroup>();
+            group->fileSystems.append(it.value());
+            probeGroups.insert(it.key(), group);
+        }
+    }
+
     CoreBackendManager::self()->backend()->initFSSupport();
 }
 
@@ -112,6 +195,8 @@ void FileSystemFactory::init()
 */
 FileSystem* FileSystemFactory::create(FileSystem::Type t, qint64 firstsector, qint64 lastsector, qint64 sectorSize, qint64 sectorsused, const QString& label, const QVariantMap& features, const QString& uuid)
 {
+    probe(t);
+
     FileSystem* fs = nullptr;
 
     switch (t) {
@@ -168,9 +253,34 @@ FileSystem* FileSystemFactory::create(const FileSystem& other)
     return create(other.type(), other.firstSector(), other.lastSector(), other.sectorSize(), other.sectorsUsed(), other.label(), other.features(), other.uuid());
 }
 
-/** @return the map of FileSystems */
+/** @return the map of FileSystems, with the support of all of them probed
+    Should be called from the main thread, the helper is started there if a tool has to be run.
+*/
 const FileSystemFactory::FileSystems& FileSystemFactory::map()
 {
+    QList<std::shared_ptr<ProbeGroup>> groups;
+    for (const auto &group : qAsConst(probeGroups))
+        if (!group->probed && !groups.contains(group))
+            groups.append(group);
+
+    if (groups.isEmpty())
+        return m_FileSystems;
+
+    // Creating a command starts the helper if it is not running yet. Do that here, on the
+    // calling thread, instead of letting one of the probing threads start it.
+    {
+        ExternalCommand helper;
+    }
+
+    // Each probe mostly waits for tools to run, so probe the remaining types in parallel
+    QThreadPool pool;
+    pool.setMaxThreadCount(std::max(QThread::idealThreadCount(), 4));
+    for (const auto &group : qAsConst(groups))
+        pool.start(new ProbeRunnable([group] { probe(*group); }));
+
+    pool.waitForDone();
+    FS::ToolProbe::save();
+
     return m_FileSystems;
 }
 
@@ -14,24 +14,37 @@
 #include "fs/luks.h"
 #include "fs/lvm2_pv.h"
 
+#include "fs/cryptbenchmark.h"
 #include "fs/filesystemfactory.h"
+#include "fs/luksheader.h"
+
+#include "core/device.h"
+#include "core/lvmreport.h"
+#include "core/partition.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
+#include "util/devicemapper.h"
+#include "util/globallog.h"
 #include "util/helpers.h"
 #include "util/report.h"
+#include "util/sysfsblockdevice.h"
 
 #include <cmath>
+#include <functional>
 
 #include <QDebug>
 #include <QDialog>
-#include <QJsonArray>
-#include <QJsonObject>
-#include <QJsonDocument>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QRegularExpression>
 #include <QPointer>
 #include <QStorageInfo>
+#include <QRunnable>
 #include <QString>
+#include <QThread>
+#include <QThreadPool>
 #include <QUuid>
 #include <QWidget>
 
@@ -53,6 +66,48 @@ FileSystem::CommandSupportType luks::m_SetLabel = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType luks::m_UpdateUUID = FileSystem::cmdSupportNone;
 FileSystem::CommandSupportType luks::m_GetUUID = FileSystem::cmdSupportNone;
 
+// dm-crypt table option, LUKS2 header flag and cryptsetup open option of each performance flag
+static const struct {
+    luks::PerformanceFlag flag;
+    const char* tableOption;
+    const char* headerFlag;
+    const char* openOption;
+} performanceFlagNames[] = {
+    { luks::PerformanceFlag::NoReadWorkqueue, "no_read_workqueue", "no-read-workqueue", "--perf-no_read_workqueue" },
+    { luks::PerformanceFlag::NoWriteWorkqueue, "no_write_workqueue", "no-write-workqueue", "--perf-no_write_workqueue" },
+    { luks::PerformanceFlag::AllowDiscards, "allow_discards", "allow-discards", "--allow-discards" },
+    { luks::PerformanceFlag::SameCpuCrypt, "same_cpu_crypt", "same-cpu-crypt", "--perf-same_cpu_crypt" },
+};
+
+namespace
+{
+/** Runs cryptsetup open in QThreadPool. */
+class CryptOpenRunnable : public QRunnable
+{
+public:
+    explicit CryptOpenRunnable(std::function<void()> open) : m_Open(std::move(open)) {}
+
+    void run() override {
+        m_Open();
+    }
+
+private:
+    std::function<void()> m_Open;
+};
+
+/** @return MemAvailable from /proc/meminfo in KiB, 0 if unknown */
+qint64 availableMemory()
+{
+    QFile meminfo(QStringLiteral("/proc/meminfo"));
+    if (!meminfo.open(QIODevice::ReadOnly))
+        return 0;
+
+    const QRegularExpressionMatch match = QRegularExpression(QStringLiteral("^MemAvailable:\\s*(\\d+) kB"), QRegularExpression::MultilineOption)
+                                              .match(QString::fromLatin1(meminfo.readAll()));
+    return match.captured(1).toLongLong();
+}
+}
+
 luks::luks(qint64 firstsector,
            qint64 lastsector,
            qint64 sectorsused,
@@ -97,6 +152,9 @@ void luks::scan(const QString& deviceNode)
 {
     getMapperName(deviceNode);
     getLuksInfo(deviceNode);
+
+    // Performance flags and key location are only read when first queried, see readMappingStatus()
+    m_MappingStatusRead = false;
 }
 
 bool luks::supportToolFound() const
@@ -112,15 +170,76 @@ FileSystem::SupportTool luks::supportToolName() const
                        QUrl(QStringLiteral("https://code.google.com/p/cryptsetup/")));
 }
 
+/** @return cryptsetup luksFormat arguments for the format options */
+QStringList luks::formatArguments() const
+{
+    const bool isLuks2 = FileSystem::type() == FileSystem::Type::Luks2;
+    QStringList args;
+
+    if (!m_FormatOptions.cipher.isEmpty())
+        args << QStringLiteral("--cipher") << m_FormatOptions.cipher;
+    // Valid key sizes depend on the cipher, e.g. Adiantum only takes 256 bits
+    if (m_FormatOptions.keySize > 0)
+        args << QStringLiteral("--key-size") << QString::number(m_FormatOptions.keySize);
+    if (isLuks2 && m_FormatOptions.sectorSize > 0)
+        args << QStringLiteral("--sector-size") << QString::number(m_FormatOptions.sectorSize);
+    if (!m_FormatOptions.pbkdf.isEmpty())
+        args << QStringLiteral("--pbkdf") << m_FormatOptions.pbkdf;
+    if (isLuks2 && m_FormatOptions.pbkdfMemory > 0 && m_FormatOptions.pbkdf != QStringLiteral("pbkdf2"))
+        args << QStringLiteral("--pbkdf-memory") << QString::number(m_FormatOptions.pbkdfMemory);
+    if (m_FormatOptions.iterTime > 0)
+        args << QStringLiteral("--iter-time") << QString::number(m_FormatOptions.iterTime);
+
+    return args;
+}
+
+/** Fills in the format options that were not set with the best choice for the device.
+
+    Picks the fastest safe cipher if CryptBenchmark already has results; the
+    benchmark is never run here, see CryptBenchmark::prepare. For LUKS2 on
+    devices with 4096 byte physical sectors, 4096 byte encryption sectors are
+    used if the partition is aligned to them, 512 byte sectors otherwise.
+
+    @param device the Device the new LUKS container will be on
+    @param partition the Partition the new LUKS container will be on
+*/
+void luks::recommendFormatOptions(const Device& device, const Partition& partition)
+{
+    const bool isLuks2 = FileSystem::type() == FileSystem::Type::Luks2;
+
+    if (m_FormatOptions.cipher.isEmpty()) {
+        const CryptBenchmark::Result fastest = CryptBenchmark::fastestCipher(false);
+        // A key size the caller asked for might not fit the fastest cipher
+        if (fastest.isValid() && (m_FormatOptions.keySize == 0 || m_FormatOptions.keySize == fastest.keySize)) {
+            m_FormatOptions.cipher = fastest.cipher();
+            m_FormatOptions.keySize = fastest.keySize;
+        }
+    }
+
+    // Larger encryption sectors halve the work per 4 KiB write, but must not be
+    // larger than what the device writes atomically
+    if (isLuks2 && m_FormatOptions.sectorSize == 0 && (device.type() == Device::Type::Disk_Device || device.type() == Device::Type::SoftwareRAID_Device)) {
+        const SysfsBlockDevice sysfs(device.deviceNode());
+        if (qMax(device.logicalSize(), sysfs.physicalSectorSize()) >= 4096) {
+            // The data area has to start and end on an encryption sector boundary
+            const qint64 firstByte = partition.firstSector() * device.logicalSize();
+            const qint64 length = partition.length() * device.logicalSize();
+            m_FormatOptions.sectorSize = (firstByte % 4096 == 0 && length % 4096 == 0) ? 4096 : 512;
+        }
+    }
+
+    if (isLuks2 && m_FormatOptions.pbkdf.isEmpty())
+        m_FormatOptions.pbkdf = QStringLiteral("argon2id");
+}
+
 bool luks::create(Report& report, const QString& deviceNode)
 {
     Q_ASSERT(m_innerFs);
     Q_ASSERT(!m_passphrase.isEmpty());
 
     ExternalCommand createCmd(report, QStringLiteral("cryptsetup"),
-                              { QStringLiteral("-s"),
-                                QStringLiteral("512"),
-                                QStringLiteral("--batch-mode"),
+                              formatArguments() +
+                              QStringList { QStringLiteral("--batch-mode"),
                                 QStringLiteral("--force-password"),
                                 QStringLiteral("--type"), QStringLiteral("luks1"),
                                 QStringLiteral("luksFormat"),
@@ -227,7 +346,134 @@ void luks::setCryptOpen(bool cryptOpen)
     m_isCryptOpen = cryptOpen;
 }
 
-bool luks::cryptOpen(QWidget* parent, const QString& deviceNode)
+/** Opens the LUKS volume after asking for its passphrase.
+    @param parent parent widget of the passphrase dialog
+    @param deviceNode the LUKS volume
+    @param flags dm-crypt performance flags to open the volume with
+    @param persistent also store the flags in the LUKS2 header, so they are used whenever the volume is opened
+    @return true on success
+*/
+bool luks::cryptOpen(QWidget* parent, const QString& deviceNode, PerformanceFlags flags, bool persistent)
+{
+    if (!prepareCryptOpen(deviceNode))
+        return false;
+
+    KPasswordDialog dlg( parent );
+    dlg.setPrompt(i18n("Enter passphrase for %1:", deviceNode));
+    if( !dlg.exec() )
+        return false;
+
+    QString passphrase = dlg.password();
+    ExternalCommand openCmd(QStringLiteral("cryptsetup"), openArguments(deviceNode, flags, persistent));
+
+    if (!( openCmd.write(passphrase.toLocal8Bit() + '\n') &&
+                    openCmd.start(-1) && openCmd.exitCode() == 0) )
+        return false;
+
+    return finishCryptOpen(deviceNode, passphrase);
+}
+
+/** Opens several LUKS volumes that share a passphrase, asking for it only once.
+
+    The volumes are unlocked concurrently. Argon2 is memory-hard, so the number of
+    volumes unlocked at the same time is bounded by the available memory as well
+    as by the number of CPUs.
+
+    Partitions that are not LUKS volumes or are already open are skipped, the
+    others are still opened. Skipped partitions and volumes that could not be
+    opened are reported in the log.
+
+    @param parent parent widget of the passphrase dialog
+    @param partitions partitions with a LUKS file system
+    @param flags dm-crypt performance flags to open the volumes with
+    @return true if all volumes that were not skipped were opened
+*/
+bool luks::cryptOpenAll(QWidget* parent, const QVector<Partition*>& partitions, PerformanceFlags flags)
+{
+    struct Volume {
+        luks* fs;
+        QString deviceNode;
+        QStringList args;
+        bool success = false;
+    };
+
+    QVector<Volume> volumes;
+    qint64 pbkdfMemory = 0;
+    int pbkdfThreads = 1;
+    for (const auto &p : partitions) {
+        luks* luksFs = dynamic_cast<luks*>(&p->fileSystem());
+        if (luksFs == nullptr) {
+            Log(Log::Level::warning) << xi18nc("@info:status", "Skipping <filename>%1</filename>, it is not a LUKS volume.", p->deviceNode());
+            continue;
+        }
+        if (!luksFs->prepareCryptOpen(p->deviceNode())) {
+            Log(Log::Level::warning) << xi18nc("@info:status", "Skipping <filename>%1</filename>, it is already unlocked.", p->deviceNode());
+            continue;
+        }
+
+        const LuksHeader header = LuksHeader::read(p->deviceNode());
+        pbkdfMemory = qMax(pbkdfMemory, header.pbkdfMemory);
+        pbkdfThreads = qMax(pbkdfThreads, header.pbkdfThreads);
+        volumes.append({ luksFs, p->deviceNode(), luksFs->openArguments(p->deviceNode(), flags, false) });
+    }
+
+    if (volumes.isEmpty())
+        return true;
+
+    KPasswordDialog dlg( parent );
+    dlg.setPrompt(i18np("Enter passphrase for %2:", "Enter passphrase for %1 devices:", volumes.size(), volumes.first().deviceNode));
+    if( !dlg.exec() )
+        return false;
+
+    const QString passphrase = dlg.password();
+    const QByteArray input = passphrase.toLocal8Bit() + '\n';
+
+    int maxThreads = qMax(1, QThread::idealThreadCount() / pbkdfThreads);
+    const qint64 memory = availableMemory();
+    if (pbkdfMemory > 0 && memory > 0)
+        maxThreads = qBound<qint64>(1, memory / pbkdfMemory, maxThreads);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMin(maxThreads, volumes.size()));
+
+    QMutex mutex;
+    QVector<Volume*> unlocked;
+    for (auto &volume : volumes) {
+        pool.start(new CryptOpenRunnable([&volume, &input, &mutex, &unlocked] {
+            ExternalCommand openCmd(QStringLiteral("cryptsetup"), volume.args);
+            volume.success = openCmd.write(input) && openCmd.start(-1) && openCmd.exitCode() == 0;
+            QMutexLocker locker(&mutex);
+            unlocked.append(&volume);
+        }));
+    }
+
+    // Inner file systems and LVM physical volumes are not thread-safe, so
+    // they are updated here as soon as each volume has been unlocked
+    bool rval = true;
+    bool done = false;
+    while (!done) {
+        done = pool.waitForDone(100);
+
+        QVector<Volume*> finished;
+        {
+            QMutexLocker locker(&mutex);
+            finished.swap(unlocked);
+        }
+
+        for (const auto &volume : qAsConst(finished)) {
+            if (volume->success && volume->fs->finishCryptOpen(volume->deviceNode, passphrase))
+                continue;
+
+            Log(Log::Level::error) << xi18nc("@info:status", "Could not unlock <filename>%1</filename>.", volume->deviceNode);
+            rval = false;
+        }
+    }
+
+    return rval;
+}
+
+/** @return false if the volume is already open */
+bool luks::prepareCryptOpen(const QString& deviceNode)
 {
     if (m_isCryptOpen)
     {
@@ -248,22 +494,27 @@ bool luks::cryptOpen(QWidget* parent, const QString& deviceNode)
         }
     }
 
-    KPasswordDialog dlg( parent );
-    dlg.setPrompt(i18n("Enter passphrase for %1:", deviceNode));
-    if( !dlg.exec() )
-        return false;
+    return true;
+}
 
-    QString passphrase = dlg.password();
-    ExternalCommand openCmd(QStringLiteral("cryptsetup"),
-                              { QStringLiteral("open"),
-                                QStringLiteral("--tries"), QStringLiteral("1"),
-                                deviceNode,
-                                suggestedMapperName(deviceNode) });
+/** @return arguments of cryptsetup open, the passphrase is read from standard input */
+QStringList luks::openArguments(const QString& deviceNode, PerformanceFlags flags, bool persistent) const
+{
+    QStringList args = { QStringLiteral("open"), QStringLiteral("--tries"), QStringLiteral("1") };
+    for (const auto &name : performanceFlagNames)
+        if (flags.testFlag(name.flag))
+            args << QLatin1String(name.openOption);
 
-    if (!( openCmd.write(passphrase.toLocal8Bit() + '\n') &&
-                    openCmd.start(-1) && openCmd.exitCode() == 0) )
-        return false;
+    // Only LUKS2 can store activation flags in its header
+    if (persistent && FileSystem::type() == FileSystem::Type::Luks2)
+        args << QStringLiteral("--persistent");
 
+    return args + QStringList { deviceNode, suggestedMapperName(deviceNode) };
+}
+
+/** Loads the inner file system of a volume that cryptsetup has just opened and updates the LVM physical volumes. */
+bool luks::finishCryptOpen(const QString& deviceNode, const QString& passphrase)
+{
     if (m_innerFs) {
         delete m_innerFs;
         m_innerFs = nullptr;
@@ -274,6 +525,9 @@ bool luks::cryptOpen(QWidget* parent, const QString& deviceNode)
     if (mapperName().isEmpty())
         return false;
 
+    // The opened volume might be an LVM physical volume
+    LvmReport::invalidate();
+
     loadInnerFileSystem(mapperName());
     m_isCryptOpen = (m_innerFs != nullptr);
 
@@ -309,6 +563,10 @@ bool luks::cryptClose(const QString& deviceNode)
     if (!(cmd.run(-1) && cmd.exitCode() == 0))
         return false;
 
+    // LVM physical volumes inside the volume are gone now
+    LvmReport::invalidate();
+    m_MappingStatusRead = false;
+
     delete m_innerFs;
     m_innerFs = nullptr;
 
@@ -334,8 +592,11 @@ void luks::loadInnerFileSystem(const QString& mapperNode)
                                                     *this);
     setLabel(m_innerFs->readLabel(mapperNode));
     setUUID(m_innerFs->readUUID(mapperNode));
-    if (m_innerFs->supportGetUsed() == FileSystem::cmdSupportFileSystem)
-        setSectorsUsed(static_cast<qint64>(std::ceil((m_innerFs->readUsedCapacity(mapperNode) + payloadOffset()) / static_cast<double>(sectorSize()) )));
+    if (m_innerFs->supportGetUsed() != FileSystem::cmdSupportNone) {
+        const qint64 used = m_innerFs->readUsedCapacity(mapperNode);
+        if (used > -1)
+            setSectorsUsed(static_cast<qint64>(std::ceil((used + payloadOffset()) / static_cast<double>(sectorSize()) )));
+    }
     m_innerFs->scan(mapperNode);
 }
 
@@ -529,21 +790,14 @@ QString luks::readOuterUUID(const QString &deviceNode) const
     if ( deviceNode.isEmpty() )
         return QString();
 
-    ExternalCommand cmd(QStringLiteral("cryptsetup"),
-                        { QStringLiteral("luksUUID"), deviceNode });
-    if (cmd.run()) {
-        if ( cmd.exitCode() )
-        {
-            qWarning() << "Cannot get luksUUID for device" << deviceNode
-                       << "\tcryptsetup exit code" << cmd.exitCode()
-                       << "\toutput:" << cmd.output().trimmed();
-            return QString();
-        }
-        QString outerUuid = cmd.output().trimmed();
-        const_cast< QString& >( m_outerUuid ) = outerUuid;
-        return outerUuid;
+    const LuksHeader header = LuksHeader::read(deviceNode);
+    if (!header.isValid()) {
+        qWarning() << "Cannot read LUKS header of device" << deviceNode;
+        return QString();
     }
-    return QStringLiteral("---");
+
+    const_cast< QString& >( m_outerUuid ) = header.uuid;
+    return header.uuid;
 }
 
 bool luks::updateUUID(Report& report, const QString& deviceNode) const
@@ -561,69 +815,81 @@ bool luks::updateUUID(Report& report, const QString& deviceNode) const
 
 void luks::getMapperName(const QString& deviceNode)
 {
-    ExternalCommand cmd(QStringLiteral("lsblk"),
-                        { QStringLiteral("--list"),
-                          QStringLiteral("--noheadings"),
-                          QStringLiteral("--paths"),
-                          QStringLiteral("--json"),
-                          QStringLiteral("--output"),
-                          QStringLiteral("type,name"),
-                          deviceNode });
-    m_MapperName = QString();
-
-    if (cmd.run(-1) && cmd.exitCode() == 0) {
-        const QJsonDocument jsonDocument = QJsonDocument::fromJson(cmd.rawOutput());
-        QJsonObject jsonObject = jsonDocument.object();
-        const QJsonArray jsonArray = jsonObject[QLatin1String("blockdevices")].toArray();
-        for (const auto &deviceLine : jsonArray) {
-            QJsonObject deviceObject = deviceLine.toObject();
-            if (deviceObject[QLatin1String("type")].toString() == QLatin1String("crypt")) {
-                m_MapperName = deviceObject[QLatin1String("name")].toString();
-                break;
-            }
-        }
-    }
+    const DeviceMapper deviceMapper;
+    const DeviceMapper::Mapping* mapping = deviceMapper.cryptMapping(deviceNode);
+    m_MapperName = mapping ? mapping->deviceNode() : QString();
 }
 
-void luks::getLuksInfo(const QString& deviceNode)
+luks::PerformanceFlags luks::performanceFlags() const
 {
-    ExternalCommand cmd(QStringLiteral("cryptsetup"), { QStringLiteral("luksDump"), deviceNode });
-    if (cmd.run(-1) && cmd.exitCode() == 0) {
-        QRegularExpression re(QStringLiteral("Cipher name:\\s+(\\w+)"));
-        QRegularExpressionMatch rem = re.match(cmd.output());
-        if (rem.hasMatch())
-            m_CipherName = rem.captured(1);
-        else
-            m_CipherName = QLatin1String("---");
+    readMappingStatus();
+    return m_PerformanceFlags;
+}
 
-        re.setPattern(QStringLiteral("Cipher mode:\\s+(\\w+)"));
-        rem = re.match(cmd.output());
-        if (rem.hasMatch())
-            m_CipherMode = rem.captured(1);
-        else
-            m_CipherMode = QLatin1String("---");
+/** Reads the performance flags and the key location of the open mapping.
 
-        re.setPattern(QStringLiteral("Hash spec:\\s+(\\w+)"));
-        rem = re.match(cmd.output());
-        if (rem.hasMatch())
-            m_HashName = rem.captured(1);
-        else
-            m_HashName = QLatin1String("---");
+    Both come from one read of the mapping's table, cryptsetup status only runs if the
+    table cannot be read. Nothing is read until one of them is first queried.
+*/
+void luks::readMappingStatus() const
+{
+    if (m_MappingStatusRead)
+        return;
 
-        re.setPattern(QStringLiteral("MK bits:\\s+(\\d+)"));
-        rem = re.match(cmd.output());
-        if (rem.hasMatch())
-            m_KeySize = rem.captured(1).toLongLong();
-        else
-            m_KeySize = -1;
+    m_MappingStatusRead = true;
+    m_PerformanceFlags = PerformanceFlags();
+    m_KeyLocation = KeyLocation::unknown;
+    if (mapperName().isEmpty())
+        return;
+
+    QStringList options;
+    const DeviceMapper deviceMapper;
+    const DeviceMapper::Mapping* mapping = deviceMapper.mapping(mapperName());
+    bool ok = false;
+    const QVector<DeviceMapper::Target> targets = mapping ? DeviceMapper::table(mapping->name, &ok) : QVector<DeviceMapper::Target>();
+    if (ok && !targets.isEmpty() && targets.first().type == QStringLiteral("crypt")) {
+        // <cipher> <key> <iv_offset> <device> <offset> [<#opt_params> <opt_params>]
+        const QStringList parameters = targets.first().parameters.split(QLatin1Char(' '));
+        options = parameters.mid(6);
+
+        // A key in the kernel keyring shows up as ":<size>:<type>:<description>"
+        m_KeyLocation = parameters.value(1).startsWith(QLatin1Char(':')) ? KeyLocation::keyring : KeyLocation::dmcrypt;
+    } else {
+        ExternalCommand statusCmd(QStringLiteral("cryptsetup"), { QStringLiteral("status"), mapperName() });
+        if (statusCmd.run(-1) && statusCmd.exitCode() == 0) {
+            QRegularExpression re(QStringLiteral("flags:\\s+(.*)$"), QRegularExpression::MultilineOption);
+            options = re.match(statusCmd.output()).captured(1).split(QLatin1Char(' '), QString::SkipEmptyParts);
+            if (options.contains(QStringLiteral("discards")))
+                options.append(QStringLiteral("allow_discards"));
+
+            const QString keyLocation = QRegularExpression(QStringLiteral("key location:\\s+(\\S+)")).match(statusCmd.output()).captured(1);
+            if (keyLocation == QStringLiteral("keyring"))
+                m_KeyLocation = KeyLocation::keyring;
+            else if (keyLocation == QStringLiteral("dm-crypt"))
+                m_KeyLocation = KeyLocation::dmcrypt;
+        }
+    }
 
-        re.setPattern(QStringLiteral("Payload offset:\\s+(\\d+)"));
-        rem = re.match(cmd.output());
-        if (rem.hasMatch())
-            m_PayloadOffset = rem.captured(1).toLongLong() * 512; // assuming LUKS sector size is 512;
-        else
-            m_PayloadOffset = -1;
+    for (const auto &name : performanceFlagNames)
+        if (options.contains(QLatin1String(name.tableOption)))
+            m_PerformanceFlags |= name.flag;
+}
 
+void luks::getLuksInfo(const QString& deviceNode)
+{
+    const LuksHeader header = LuksHeader::read(deviceNode);
+    if (header.isValid()) {
+        m_CipherName = header.cipherName.isEmpty() ? QStringLiteral("---") : header.cipherName;
+        m_CipherMode = header.cipherMode.isEmpty() ? QStringLiteral("---") : header.cipherMode;
+        m_HashName = header.hashName.isEmpty() ? QStringLiteral("---") : header.hashName;
+        m_KeySize = header.keySize;
+        m_PayloadOffset = header.payloadOffset;
+        m_outerUuid = header.uuid;
+
+        m_PersistentPerformanceFlags = PerformanceFlags();
+        for (const auto &name : performanceFlagNames)
+            if (header.flags.contains(QLatin1String(name.headerFlag)))
+                m_PersistentPerformanceFlags |= name.flag;
     }
     else {
         m_CipherName = QLatin1String("---");
@@ -676,12 +942,11 @@ void luks::initLUKS()
 
 void luks::setPayloadSize()
 {
-    ExternalCommand dmsetupCmd(QStringLiteral("dmsetup"), { QStringLiteral("table"), mapperName() });
-    dmsetupCmd.run();
-    QRegularExpression re(QStringLiteral("\\d+ (\\d+)"));
-    QRegularExpressionMatch rem = re.match(dmsetupCmd.output());
-    if (rem.hasMatch())
-        m_PayloadSize = rem.captured(1).toLongLong() * sectorSize();
+    // The size of the mapping is the length of its crypt target
+    const DeviceMapper deviceMapper;
+    const DeviceMapper::Mapping* mapping = deviceMapper.mapping(mapperName());
+    if (mapping && mapping->size >= 0)
+        m_PayloadSize = mapping->size;
 }
 
 bool luks::testPassphrase(const QString& deviceNode, const QString& passphrase) const {
@@ -17,8 +17,11 @@
 
 #include "fs/filesystem.h"
 
+#include <QVector>
 #include <QtGlobal>
 
+class Device;
+class Partition;
 class Report;
 
 class QString;
@@ -41,6 +44,25 @@ public:
         keyring
     };
 
+    /** dm-crypt options that trade CPU scheduling and security properties for speed */
+    enum class PerformanceFlag : uint8_t {
+        NoReadWorkqueue = 0x1,  /**< decrypt reads synchronously instead of in a kernel workqueue */
+        NoWriteWorkqueue = 0x2, /**< encrypt writes synchronously instead of in a kernel workqueue */
+        AllowDiscards = 0x4,    /**< pass discards to the device; reveals which blocks are unused */
+        SameCpuCrypt = 0x8,     /**< encrypt on the CPU that submitted the I/O */
+    };
+    Q_DECLARE_FLAGS(PerformanceFlags, PerformanceFlag)
+
+    /** Parameters for cryptsetup luksFormat. Empty or 0 values leave the choice to cryptsetup. */
+    struct FormatOptions {
+        QString cipher;          /**< e.g. "aes-xts-plain64" */
+        qint64 keySize = 0;      /**< in bits */
+        qint64 sectorSize = 0;   /**< encryption sector size in bytes, LUKS2 only */
+        QString pbkdf;           /**< e.g. "argon2id" or "pbkdf2" */
+        qint64 pbkdfMemory = 0;  /**< in KiB, not used by pbkdf2 */
+        qint64 iterTime = 0;     /**< time to spend on unlocking the key in milliseconds */
+    };
+
 public:
     void init() override;
     void scan(const QString& deviceNode) override;
@@ -141,6 +163,21 @@ public:
     void setPassphrase(const QString&);
     QString passphrase() const;
 
+    void setFormatOptions(const FormatOptions& options) {
+        m_FormatOptions = options;
+    }
+    const FormatOptions& formatOptions() const {
+        return m_FormatOptions;
+    }
+    void recommendFormatOptions(const Device& device, const Partition& partition);
+
+    /** Sets the cipher that is shown for the volume, e.g. while a reencryption is pending */
+    void setCipher(const QString& name, const QString& mode, qint64 keySize) {
+        m_CipherName = name;
+        m_CipherMode = mode;
+        m_KeySize = keySize;
+    }
+
     bool canMount(const QString&, const QString&) const override;
     bool canUnmount(const QString&) const override;
     bool isMounted() const;
@@ -151,7 +188,8 @@ public:
     bool isCryptOpen() const;
     void setCryptOpen(bool cryptOpen);
 
-    bool cryptOpen(QWidget* parent, const QString& deviceNode);
+    bool cryptOpen(QWidget* parent, const QString& deviceNode, PerformanceFlags flags = PerformanceFlags(), bool persistent = false);
+    static bool cryptOpenAll(QWidget* parent, const QVector<Partition*>& partitions, PerformanceFlags flags = PerformanceFlags());
     bool cryptClose(const QString& deviceNode);
 
     void loadInnerFileSystem(const QString& mapperNode);
@@ -171,6 +209,8 @@ public:
     QString outerUuid() const;
 
     QString mapperName() const { return m_MapperName; }
+    PerformanceFlags performanceFlags() const; /**< @return flags of the open mapping, read when first queried */
+    PerformanceFlags persistentPerformanceFlags() const { return m_PersistentPerformanceFlags; } /**< @return flags stored in the LUKS2 header */
     QString cipherName() const { return m_CipherName; }
     QString cipherMode() const { return m_CipherMode; }
     QString hashName() const { return m_HashName; }
@@ -185,6 +225,11 @@ public:
 protected:
     virtual QString readOuterUUID(const QString& deviceNode) const;
     void setPayloadSize();
+    void readMappingStatus() const;
+    QStringList formatArguments() const;
+    bool prepareCryptOpen(const QString& deviceNode);
+    QStringList openArguments(const QString& deviceNode, PerformanceFlags flags, bool persistent) const;
+    bool finishCryptOpen(const QString& deviceNode, const QString& passphrase);
 
 public:
     static CommandSupportType m_GetUsed;
@@ -217,8 +262,14 @@ protected:
     qint64 m_PayloadSize;
     QString m_outerUuid;
 
-    luks::KeyLocation m_KeyLocation = KeyLocation::unknown;
+    mutable luks::KeyLocation m_KeyLocation = KeyLocation::unknown;
+    FormatOptions m_FormatOptions;
+    mutable PerformanceFlags m_PerformanceFlags;
+    mutable bool m_MappingStatusRead = false;
+    PerformanceFlags m_PersistentPerformanceFlags;
 };
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(luks::PerformanceFlags)
 }
 
 #endif
@@ -11,6 +11,9 @@
 #include "util/externalcommand.h"
 #include "util/report.h"
 
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QRegularExpression>
 
 #include <KLocalizedString>
@@ -40,9 +43,8 @@ bool luks2::create(Report& report, const QString& deviceNode)
     Q_ASSERT(!m_passphrase.isEmpty());
 
     ExternalCommand createCmd(report, QStringLiteral("cryptsetup"),
-                              { QStringLiteral("-s"),
-                                QStringLiteral("512"),
-                                QStringLiteral("--batch-mode"),
+                              formatArguments() +
+                              QStringList { QStringLiteral("--batch-mode"),
                                 QStringLiteral("--force-password"),
                                 QStringLiteral("--type"), QStringLiteral("luks2"),
                                 QStringLiteral("luksFormat"),
@@ -80,6 +82,9 @@ bool luks2::resize(Report& report, const QString& deviceNode, qint64 newLength)
     if (mapperName().isEmpty())
         return false;
 
+    // cryptsetup resize needs the passphrase for keys in the kernel keyring
+    readMappingStatus();
+
     const qint64 sizeDiff = newLength - length() * sectorSize();
     const qint64 newPayloadSize = m_PayloadSize + sizeDiff;
     if ( sizeDiff > 0 ) // grow
@@ -117,21 +122,128 @@ bool luks2::resize(Report& report, const QString& deviceNode, qint64 newLength)
     return false;
 }
 
-luks::KeyLocation luks2::keyLocation()
+/** @return arguments for cryptsetup that reencrypt the volume with the format options.
+    The volume stays usable while it is being reencrypted if it is open.
+    @param deviceNode the LUKS2 volume
+    @param resume continue an interrupted reencryption instead of starting a new one
+    @param resilience how the area that is being reencrypted is protected, can also be changed when resuming
+    @param hotzoneSize maximum amount of data reencrypted in one step in bytes, 0 for cryptsetup's default
+*/
+QStringList luks2::reencryptArguments(const QString& deviceNode, bool resume, Resilience resilience, qint64 hotzoneSize) const
+{
+    QStringList args = { QStringLiteral("reencrypt"), QStringLiteral("--batch-mode") };
+    if (resume)
+        args << QStringLiteral("--resume-only");
+    else
+        args << formatArguments();
+
+    if (resilience == Resilience::Journal)
+        args << QStringLiteral("--resilience") << QStringLiteral("journal");
+    else if (resilience == Resilience::None)
+        args << QStringLiteral("--resilience") << QStringLiteral("none");
+    else
+        args << QStringLiteral("--resilience") << QStringLiteral("checksum");
+
+    if (hotzoneSize > 0)
+        args << QStringLiteral("--hotzone-size") << QString::number(hotzoneSize);
+    if (m_isCryptOpen && !mapperName().isEmpty())
+        args << QStringLiteral("--active-name") << mapperName();
+
+    return args << deviceNode;
+}
+
+/** Reads the progress of a reencryption from the LUKS2 metadata.
+
+    While a volume is being reencrypted, its data is split into segments that
+    are encrypted with the new key and segments that are still encrypted with
+    the old one. The "backup-final" segment describes the new encryption and
+    shares its digest with the already reencrypted segments.
+
+    The metadata can only be dumped by cryptsetup 2.4 and later. With older
+    versions a running reencryption is still found, but done stays 0.
+
+    @param deviceNode the LUKS2 volume
+    @param deviceSize size of the volume in bytes
+    @param done set to the number of bytes that have been reencrypted
+    @return true if a reencryption is running or was interrupted
+*/
+bool luks2::reencryptionProgress(const QString& deviceNode, qint64 deviceSize, qint64& done) const
 {
-    m_KeyLocation = KeyLocation::unknown;
-    ExternalCommand statusCmd(QStringLiteral("cryptsetup"), { QStringLiteral("status"), mapperName() });
-    if (statusCmd.run(-1) && statusCmd.exitCode() == 0) {
-        QRegularExpression re(QStringLiteral("key location:\\s+(\\w+)"));
-        QRegularExpressionMatch rem = re.match(statusCmd.output());
-        if (rem.hasMatch()) {
-            if (rem.captured(1) == QStringLiteral("keyring"))
-                m_KeyLocation = KeyLocation::keyring;
-            else if (rem.captured(1) == QStringLiteral("dm-crypt"))
-                m_KeyLocation = KeyLocation::dmcrypt;
+    done = 0;
+
+    if (!canDumpJsonMetadata()) {
+        // Lists "online-reencrypt" among the requirements
+        ExternalCommand dumpCmd(QStringLiteral("cryptsetup"), { QStringLiteral("luksDump"), deviceNode });
+        return dumpCmd.run(-1) && dumpCmd.exitCode() == 0 && dumpCmd.output().contains(QStringLiteral("online-reencrypt"));
+    }
+
+    ExternalCommand dumpCmd(QStringLiteral("cryptsetup"), { QStringLiteral("luksDump"), QStringLiteral("--dump-json-metadata"), deviceNode }, QProcess::SeparateChannels);
+    if (!dumpCmd.run(-1) || dumpCmd.exitCode() != 0)
+        return false;
+
+    const QJsonObject metadata = QJsonDocument::fromJson(dumpCmd.rawOutput()).object();
+    bool reencrypting = false;
+    for (const auto &requirement : metadata[QLatin1String("config")].toObject()[QLatin1String("requirements")].toObject()[QLatin1String("mandatory")].toArray())
+        reencrypting = reencrypting || requirement.toString().startsWith(QStringLiteral("online-reencrypt"));
+    if (!reencrypting)
+        return false;
+
+    const QJsonObject segments = metadata[QLatin1String("segments")].toObject();
+    auto hasFlag = [&segments] (const QString& id, const QString& prefix) {
+        for (const auto &flag : segments[id].toObject()[QLatin1String("flags")].toArray())
+            if (flag.toString().startsWith(prefix))
+                return true;
+        return false;
+    };
+
+    QString finalSegment;
+    for (auto it = segments.begin(); it != segments.end(); ++it)
+        if (hasFlag(it.key(), QStringLiteral("backup-final")))
+            finalSegment = it.key();
+
+    const QJsonObject digests = metadata[QLatin1String("digests")].toObject();
+    for (const auto &digest : digests) {
+        const QJsonArray digestSegments = digest.toObject()[QLatin1String("segments")].toArray();
+        if (!digestSegments.contains(finalSegment))
+            continue;
+
+        for (const auto &id : digestSegments) {
+            if (hasFlag(id.toString(), QStringLiteral("backup-")) || hasFlag(id.toString(), QStringLiteral("in-reencryption")))
+                continue;
+
+            // Sizes and offsets are strings, the last segment's size is "dynamic"
+            const QJsonObject segment = segments[id.toString()].toObject();
+            const QString size = segment[QLatin1String("size")].toString();
+            done += size == QStringLiteral("dynamic") ? deviceSize - segment[QLatin1String("offset")].toString().toLongLong() : size.toLongLong();
         }
     }
 
+    return true;
+}
+
+/** @return true if cryptsetup can dump the LUKS2 metadata as JSON, which needs version 2.4 */
+bool luks2::canDumpJsonMetadata()
+{
+    static const bool rval = [] {
+        ExternalCommand versionCmd(QStringLiteral("cryptsetup"), { QStringLiteral("--version") });
+        if (!versionCmd.run(-1) || versionCmd.exitCode() != 0)
+            return false;
+
+        const QRegularExpressionMatch match = QRegularExpression(QStringLiteral("cryptsetup (\\d+)\\.(\\d+)")).match(versionCmd.output());
+        if (!match.hasMatch())
+            return false;
+
+        const int major = match.captured(1).toInt();
+        const int minor = match.captured(2).toInt();
+        return major > 2 || (major == 2 && minor >= 4);
+    }();
+
+    return rval;
+}
+
+luks::KeyLocation luks2::keyLocation()
+{
+    readMappingStatus();
     return m_KeyLocation;
 }
 
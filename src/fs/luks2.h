@@ -34,6 +34,17 @@ public:
     FileSystem::Type type() const override;
 
     luks::KeyLocation keyLocation();
+
+    /** How cryptsetup reencrypt protects the area it is working on against crashes */
+    enum class Resilience {
+        Checksum, /**< only checksums of the area are written to the metadata, the default */
+        Journal,  /**< the whole area is written to the metadata first, every block is written twice */
+        None      /**< nothing is written, a crash can leave the area unrecoverable */
+    };
+
+    QStringList reencryptArguments(const QString& deviceNode, bool resume, Resilience resilience = Resilience::Checksum, qint64 hotzoneSize = 0) const;
+    bool reencryptionProgress(const QString& deviceNode, qint64 deviceSize, qint64& done) const;
+    static bool canDumpJsonMetadata();
 };
 }
 
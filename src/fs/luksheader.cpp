@@ -0,0 +1,216 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "fs/luksheader.h"
+
+#include "fs/superblock.h"
+
+#include <QCryptographicHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtEndian>
+
+namespace
+{
+// Large enough for the LUKS1 header and both default LUKS2 headers with their JSON areas
+constexpr qint64 readSize = 32 * 1024;
+constexpr qint64 maxLuks2HeaderSize = 4 * 1024 * 1024;
+constexpr int luks2BinaryHeaderSize = 4096;
+
+// Where cryptsetup looks for the secondary LUKS2 header if the primary one cannot be used
+constexpr qint64 luks2SecondaryOffsets[] = { 0x4000, 0x8000, 0x10000, 0x20000, 0x40000, 0x80000, 0x100000, 0x200000, 0x400000 };
+
+const QByteArray luksMagic("LUKS\xba\xbe", 6);
+const QByteArray luks2SecondaryMagic("SKUL\xba\xbe", 6);
+
+QString readString(const QByteArray& buffer, int offset, int size)
+{
+    const QByteArray field = buffer.mid(offset, size);
+    return QString::fromLatin1(field.constData(), qstrnlen(field.constData(), field.size()));
+}
+
+quint16 be16(const QByteArray& buffer, int offset)
+{
+    return qFromBigEndian<quint16>(reinterpret_cast<const uchar*>(buffer.constData()) + offset);
+}
+
+quint32 be32(const QByteArray& buffer, int offset)
+{
+    return qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(buffer.constData()) + offset);
+}
+
+quint64 be64(const QByteArray& buffer, int offset)
+{
+    return qFromBigEndian<quint64>(reinterpret_cast<const uchar*>(buffer.constData()) + offset);
+}
+
+void parseLuks1(const QByteArray& buffer, FS::LuksHeader& header)
+{
+    header.version = 1;
+    header.cipherName = readString(buffer, 8, 32);
+    header.cipherMode = readString(buffer, 40, 32);
+    header.hashName = readString(buffer, 72, 32);
+    header.payloadOffset = static_cast<qint64>(be32(buffer, 104)) * 512;
+    header.keySize = static_cast<qint64>(be32(buffer, 108)) * 8;
+    header.uuid = readString(buffer, 168, 40);
+}
+
+/** @return true if the checksum of the binary header and the JSON area matches */
+bool verifyLuks2(const QByteArray& buffer, qint64 headerSize)
+{
+    QCryptographicHash::Algorithm algorithm;
+    const QString checksumAlgorithm = readString(buffer, 72, 32);
+    if (checksumAlgorithm == QStringLiteral("sha256"))
+        algorithm = QCryptographicHash::Sha256;
+    else if (checksumAlgorithm == QStringLiteral("sha512"))
+        algorithm = QCryptographicHash::Sha512;
+    else if (checksumAlgorithm == QStringLiteral("sha1"))
+        algorithm = QCryptographicHash::Sha1;
+    else
+        return true; // cannot verify, trust the magic
+
+    // The checksum is calculated with the checksum field zeroed
+    QByteArray data = buffer.left(headerSize);
+    data.replace(448, 64, QByteArray(64, '\0'));
+    const QByteArray checksum = QCryptographicHash::hash(data, algorithm);
+    return buffer.mid(448, checksum.size()) == checksum;
+}
+
+/** A binary LUKS2 header with its JSON area */
+struct Luks2Area
+{
+    QByteArray buffer;
+    qint64 headerSize = 0;
+    quint64 seqid = 0;
+};
+
+/** Reads the LUKS2 header at offset, which must carry magic and point back to offset.
+    @param buffer bytes at offset that were already read, if any
+    @return true if the header is complete and its checksum matches
+*/
+bool readLuks2(const QString& deviceNode, qint64 offset, const QByteArray& magic, QByteArray buffer, Luks2Area& area)
+{
+    if (buffer.size() < luks2BinaryHeaderSize && !FS::Superblock::read(deviceNode, offset, luks2BinaryHeaderSize, buffer))
+        return false;
+
+    if (!buffer.startsWith(magic) || be16(buffer, 6) != 2 || static_cast<qint64>(be64(buffer, 256)) != offset)
+        return false;
+
+    const qint64 headerSize = static_cast<qint64>(be64(buffer, 8));
+    if (headerSize <= luks2BinaryHeaderSize || headerSize > maxLuks2HeaderSize)
+        return false;
+
+    // Only non-default metadata sizes need another read
+    if (headerSize > buffer.size() && !FS::Superblock::read(deviceNode, offset, headerSize, buffer))
+        return false;
+
+    if (!verifyLuks2(buffer, headerSize))
+        return false;
+
+    area.buffer = buffer;
+    area.headerSize = headerSize;
+    area.seqid = be64(buffer, 16);
+    return true;
+}
+
+void parseLuks2(const QByteArray& buffer, qint64 headerSize, FS::LuksHeader& header)
+{
+    const QByteArray json = buffer.mid(luks2BinaryHeaderSize, headerSize - luks2BinaryHeaderSize);
+    const QJsonObject metadata = QJsonDocument::fromJson(json.left(qstrnlen(json.constData(), json.size()))).object();
+    if (metadata.isEmpty())
+        return;
+
+    header.version = 2;
+    header.label = readString(buffer, 24, 48);
+    header.uuid = readString(buffer, 168, 40);
+
+    // The first data segment, e.g. { "type": "crypt", "offset": "16777216", "encryption": "aes-xts-plain64", "sector_size": 512 }
+    const QJsonObject segments = metadata[QLatin1String("segments")].toObject();
+    const QString segmentId = segments.contains(QStringLiteral("0")) ? QStringLiteral("0") : segments.keys().value(0);
+    const QJsonObject segment = segments[segmentId].toObject();
+    const QString encryption = segment[QLatin1String("encryption")].toString();
+    header.cipherName = encryption.section(QLatin1Char('-'), 0, 0);
+    header.cipherMode = encryption.section(QLatin1Char('-'), 1);
+    header.payloadOffset = segment[QLatin1String("offset")].toString().toLongLong();
+    header.sectorSize = segment[QLatin1String("sector_size")].toInt(512);
+
+    for (const auto &flag : metadata[QLatin1String("config")].toObject()[QLatin1String("flags")].toArray())
+        header.flags.append(flag.toString());
+
+    // Unlocking may have to try every keyslot, so the most expensive one counts
+    for (const auto &value : metadata[QLatin1String("keyslots")].toObject()) {
+        const QJsonObject kdf = value.toObject()[QLatin1String("kdf")].toObject();
+        header.pbkdfMemory = qMax<qint64>(header.pbkdfMemory, kdf[QLatin1String("memory")].toInt());
+        header.pbkdfThreads = qMax(header.pbkdfThreads, kdf[QLatin1String("cpus")].toInt(1));
+    }
+
+    // Hash and key size come from the digest and a keyslot of the segment
+    const QJsonObject digests = metadata[QLatin1String("digests")].toObject();
+    for (const auto &value : digests) {
+        const QJsonObject digest = value.toObject();
+        if (!digest[QLatin1String("segments")].toArray().contains(segmentId))
+            continue;
+
+        header.hashName = digest[QLatin1String("hash")].toString();
+        const QString keyslot = digest[QLatin1String("keyslots")].toArray().first().toString();
+        const int keySize = metadata[QLatin1String("keyslots")].toObject()[keyslot].toObject()[QLatin1String("key_size")].toInt(-1);
+        header.keySize = keySize > 0 ? keySize * 8 : -1;
+        break;
+    }
+}
+}
+
+namespace FS
+{
+/** Reads the LUKS header at the start of a device.
+
+    LUKS2 keeps a second copy of its header right after the first one. Both are
+    read and, like cryptsetup does, the valid one with the higher sequence number
+    is used, so that a torn or damaged primary header does not hide the volume.
+
+    @param deviceNode the device to read from
+    @return the header, invalid if there is no LUKS header or it could not be read
+*/
+LuksHeader LuksHeader::read(const QString& deviceNode)
+{
+    LuksHeader header;
+    QByteArray buffer;
+    if (!Superblock::read(deviceNode, 0, readSize, buffer))
+        return header;
+
+    if (buffer.startsWith(luksMagic) && be16(buffer, 6) == 1) {
+        parseLuks1(buffer, header);
+        return header;
+    }
+
+    Luks2Area primary;
+    const bool primaryValid = readLuks2(deviceNode, 0, luksMagic, buffer, primary);
+
+    // The secondary header follows the primary one. Its offset is only known from an
+    // intact primary header, otherwise try every offset cryptsetup allows.
+    Luks2Area secondary;
+    bool secondaryValid = false;
+    if (primaryValid)
+        secondaryValid = readLuks2(deviceNode, primary.headerSize, luks2SecondaryMagic,
+                                   primary.headerSize + luks2BinaryHeaderSize <= buffer.size() ? buffer.mid(primary.headerSize) : QByteArray(), secondary);
+    else {
+        for (const auto offset : luks2SecondaryOffsets) {
+            secondaryValid = readLuks2(deviceNode, offset, luks2SecondaryMagic,
+                                       offset + luks2BinaryHeaderSize <= buffer.size() ? buffer.mid(offset) : QByteArray(), secondary);
+            if (secondaryValid)
+                break;
+        }
+    }
+
+    if (secondaryValid && (!primaryValid || secondary.seqid > primary.seqid))
+        parseLuks2(secondary.buffer, secondary.headerSize, header);
+    else if (primaryValid)
+        parseLuks2(primary.buffer, primary.headerSize, header);
+
+    return header;
+}
+}
@@ -0,0 +1,48 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_LUKSHEADER_H
+#define KPMCORE_LUKSHEADER_H
+
+#include "util/libpartitionmanagerexport.h"
+
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+namespace FS
+{
+/** Unencrypted parts of a LUKS1 or LUKS2 header.
+
+    The LUKS1 header and the binary LUKS2 header have a fixed layout, and
+    LUKS2 keeps the rest of its metadata in the JSON area that follows. Both
+    are read in-process, so scanning a volume does not need to run
+    cryptsetup luksDump and parse its output.
+*/
+struct LIBKPMCORE_EXPORT LuksHeader
+{
+    int version = 0;            /**< 1 or 2, 0 if the device has no valid LUKS header */
+    QString uuid;
+    QString label;              /**< LUKS2 only */
+    QString cipherName;         /**< e.g. "aes" */
+    QString cipherMode;         /**< e.g. "xts-plain64" */
+    QString hashName;           /**< hash of the volume key digest, e.g. "sha256" */
+    qint64 keySize = -1;        /**< volume key size in bits */
+    qint64 payloadOffset = -1;  /**< first byte of the encrypted data */
+    qint64 sectorSize = 512;    /**< encryption sector size in bytes */
+    QStringList flags;          /**< LUKS2 persistent activation flags, e.g. "allow-discards" */
+    qint64 pbkdfMemory = 0;     /**< largest Argon2 memory cost of a LUKS2 keyslot in KiB, 0 for PBKDF2 */
+    int pbkdfThreads = 1;       /**< largest Argon2 parallelism of a LUKS2 keyslot */
+
+    bool isValid() const {
+        return version != 0;
+    }
+
+    static LuksHeader read(const QString& deviceNode);
+};
+}
+
+#endif
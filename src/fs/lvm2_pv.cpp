@@ -12,6 +12,7 @@
 
 #include "fs/lvm2_pv.h"
 #include "core/device.h"
+#include "core/lvmreport.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
@@ -98,9 +99,9 @@ qint64 lvm2_pv::maxCapacity() const
 
 qint64 lvm2_pv::readUsedCapacity(const QString& deviceNode) const
 {
-    QString pvUsed = getpvField(QStringLiteral("pv_used"), deviceNode);
-    QString metadataOffset = getpvField(QStringLiteral("pe_start"), deviceNode);
-    return pvUsed.isEmpty() ? -1 : pvUsed.toLongLong() + metadataOffset.toLongLong();
+    const auto report = LvmReport::current();
+    const LvmReport::PhysicalVolume* pv = report->physicalVolume(deviceNode);
+    return pv && pv->used >= 0 ? pv->used + pv->extentStart : -1;
 }
 
 bool lvm2_pv::check(Report& report, const QString& deviceNode) const
@@ -112,35 +113,50 @@ bool lvm2_pv::check(Report& report, const QString& deviceNode) const
 bool lvm2_pv::create(Report& report, const QString& deviceNode)
 {
     ExternalCommand cmd(report, QStringLiteral("lvm"), { QStringLiteral("pvcreate"), QStringLiteral("--force"), deviceNode });
-    return cmd.run(-1) && cmd.exitCode() == 0;
+    const bool rval = cmd.run(-1) && cmd.exitCode() == 0;
+    LvmReport::invalidate();
+    return rval;
 }
 
 bool lvm2_pv::remove(Report& report, const QString& deviceNode) const
 {
     ExternalCommand cmd(report, QStringLiteral("lvm"), { QStringLiteral("pvremove"), QStringLiteral("--force"), QStringLiteral("--force"), QStringLiteral("--yes"), deviceNode });
-    return cmd.run(-1) && cmd.exitCode() == 0;
+    const bool rval = cmd.run(-1) && cmd.exitCode() == 0;
+    LvmReport::invalidate();
+    return rval;
 }
 
 bool lvm2_pv::resize(Report& report, const QString& deviceNode, qint64 length) const
 {
     bool rval = true;
 
-    qint64 metadataOffset = getpvField(QStringLiteral("pe_start"), deviceNode).toLongLong();
+    const auto lvmReport = LvmReport::current();
+    const LvmReport::PhysicalVolume* pv = lvmReport->physicalVolume(deviceNode);
+    const qint64 metadataOffset = pv ? pv->extentStart : 0;
 
     qint64 lastPE = getTotalPE(deviceNode) - 1; // starts from 0
     if (lastPE > 0) { // make sure that the PV is already in a VG
         qint64 targetPE = (length - metadataOffset) / peSize() - 1; // starts from 0
         if (targetPE < lastPE) { //shrinking FS
-            qint64 firstMovedPE = qMax(targetPE + 1, getAllocatedPE(deviceNode)); // starts from 1
-            ExternalCommand moveCmd(report,
-                                    QStringLiteral("lvm"), {
-                                    QStringLiteral("pvmove"),
-                                    QStringLiteral("--alloc"),
-                                    QStringLiteral("anywhere"),
-                                    deviceNode + QStringLiteral(":") + QString::number(firstMovedPE) + QStringLiteral("-") + QString::number(lastPE),
-                                    deviceNode + QStringLiteral(":") + QStringLiteral("0-") + QString::number(firstMovedPE - 1)
-                                    });
-            rval = moveCmd.run(-1) && (moveCmd.exitCode() == 0 || moveCmd.exitCode() == 5); // FIXME: exit code 5: NO data to move
+            // Move only the allocated extents that are beyond the new end
+            QStringList ranges;
+            for (const auto &segment : lvmReport->physicalVolumeSegments(deviceNode)) {
+                const qint64 last = segment.pvExtent + segment.extents - 1;
+                if (last > targetPE)
+                    ranges << QString::number(qMax(segment.pvExtent, targetPE + 1)) + QStringLiteral("-") + QString::number(last);
+            }
+
+            if (!ranges.isEmpty()) {
+                ExternalCommand moveCmd(report,
+                                        QStringLiteral("lvm"), {
+                                        QStringLiteral("pvmove"),
+                                        QStringLiteral("--alloc"),
+                                        QStringLiteral("anywhere"),
+                                        (QStringList(deviceNode) + ranges).join(QLatin1Char(':')),
+                                        deviceNode + QStringLiteral(":0-") + QString::number(targetPE)
+                                        });
+                rval = moveCmd.run(-1) && moveCmd.exitCode() == 0;
+            }
         }
     }
 
@@ -150,7 +166,9 @@ bool lvm2_pv::resize(Report& report, const QString& deviceNode, qint64 length) c
                                 QStringLiteral("--setphysicalvolumesize"),
                                 QString::number(length) + QStringLiteral("B"),
                                 deviceNode });
-    return rval && cmd.run(-1) && cmd.exitCode() == 0;
+    rval = rval && cmd.run(-1) && cmd.exitCode() == 0;
+    LvmReport::invalidate();
+    return rval;
 }
 
 bool lvm2_pv::resizeOnline(Report& report, const QString& deviceNode, const QString& mountPoint, qint64 length) const
@@ -162,12 +180,16 @@ bool lvm2_pv::resizeOnline(Report& report, const QString& deviceNode, const QStr
 bool lvm2_pv::updateUUID(Report& report, const QString& deviceNode) const
 {
     ExternalCommand cmd(report, QStringLiteral("lvm"), { QStringLiteral("pvchange"), QStringLiteral("--uuid"), deviceNode });
-    return cmd.run(-1) && cmd.exitCode() == 0;
+    const bool rval = cmd.run(-1) && cmd.exitCode() == 0;
+    LvmReport::invalidate();
+    return rval;
 }
 
 QString lvm2_pv::readUUID(const QString& deviceNode) const
 {
-    return getpvField(QStringLiteral("pv_uuid"), deviceNode);
+    const auto report = LvmReport::current();
+    const LvmReport::PhysicalVolume* pv = report->physicalVolume(deviceNode);
+    return pv ? pv->uuid : QString();
 }
 
 bool lvm2_pv::mount(Report& report, const QString& deviceNode, const QString& mountPoint)
@@ -200,52 +222,30 @@ bool lvm2_pv::canUnmount(const QString& deviceNode) const
 
 qint64 lvm2_pv::getTotalPE(const QString& deviceNode)
 {
-    QString pvPeCount = getpvField(QStringLiteral("pv_pe_count"), deviceNode);
-    return pvPeCount.isEmpty() ? -1 : pvPeCount.toLongLong();
+    const auto report = LvmReport::current();
+    const LvmReport::PhysicalVolume* pv = report->physicalVolume(deviceNode);
+    return pv ? pv->extentCount : -1;
 }
 
 qint64 lvm2_pv::getAllocatedPE(const QString& deviceNode)
 {
-    QString pvPeAllocCount = getpvField(QStringLiteral("pv_pe_alloc_count"), deviceNode);
-    return pvPeAllocCount.isEmpty() ? -1 : pvPeAllocCount.toLongLong();
+    const auto report = LvmReport::current();
+    const LvmReport::PhysicalVolume* pv = report->physicalVolume(deviceNode);
+    return pv ? pv->allocatedExtents : -1;
 }
 
 void lvm2_pv::getPESize(const QString& deviceNode)
 {
-    QString vgExtentSize = getpvField(QStringLiteral("vg_extent_size"), deviceNode);
-    m_PESize = vgExtentSize.isEmpty() ? -1 : vgExtentSize.toLongLong();
-}
-
-/** Get pvs command output with field name
- *
- *  @param fieldName LVM field name
- *  @param deviceNode path to PV
- *  @return raw output of pvs command, usually with many spaces
- */
-QString  lvm2_pv::getpvField(const QString& fieldName, const QString& deviceNode)
-{
-    QStringList args = { QStringLiteral("pvs"),
-                    QStringLiteral("--foreign"),
-                    QStringLiteral("--readonly"),
-                    QStringLiteral("--noheadings"),
-                    QStringLiteral("--units"),
-                    QStringLiteral("B"),
-                    QStringLiteral("--nosuffix"),
-                    QStringLiteral("--options"),
-                    fieldName };
-    if (!deviceNode.isEmpty()) {
-        args << deviceNode;
-    }
-    ExternalCommand cmd(QStringLiteral("lvm"), args, QProcess::ProcessChannelMode::SeparateChannels);
-    if (cmd.run(-1) && cmd.exitCode() == 0) {
-        return cmd.output().trimmed();
-    }
-    return QString();
+    const auto report = LvmReport::current();
+    const LvmReport::PhysicalVolume* pv = report->physicalVolume(deviceNode);
+    m_PESize = pv ? pv->extentSize : -1;
 }
 
 QString lvm2_pv::getVGName(const QString& deviceNode)
 {
-    return getpvField(QStringLiteral("vg_name"), deviceNode);
+    const auto report = LvmReport::current();
+    const LvmReport::PhysicalVolume* pv = report->physicalVolume(deviceNode);
+    return pv ? pv->vgName : QString();
 }
 
 QList<LvmPV> lvm2_pv::getPVinNode(const PartitionNode* parent)
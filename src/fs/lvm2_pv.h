@@ -154,8 +154,6 @@ public:
     SupportTool supportToolName() const override;
     bool supportToolFound() const override;
 
-    static QString getpvField(const QString& fieldName, const QString& deviceNode = QString());
-
     static qint64 getTotalPE(const QString& deviceNode);
     static qint64 getAllocatedPE(const QString& deviceNode);
     static QString getVGName(const QString& deviceNode);
@@ -0,0 +1,431 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "fs/superblock.h"
+
+#include "core/copysource.h"
+#include "core/copytargetbytearray.h"
+
+#include "util/externalcommand.h"
+
+#include <QFile>
+#include <QtEndian>
+
+#include <algorithm>
+
+namespace
+{
+/** Range of bytes on a device or file, only used to read it through the helper. */
+class CopySourceRange : public CopySource
+{
+public:
+    CopySourceRange(const QString& path, qint64 firstByte, qint64 length) :
+        m_Path(path),
+        m_FirstByte(firstByte),
+        m_Length(length)
+    {
+    }
+
+    bool open() override {
+        return true;
+    }
+    QString path() const override {
+        return m_Path;
+    }
+    qint64 length() const override {
+        return m_Length;
+    }
+    bool overlaps(const CopyTarget&) const override {
+        return false;
+    }
+    qint64 firstByte() const override {
+        return m_FirstByte;
+    }
+    qint64 lastByte() const override {
+        return m_FirstByte + m_Length - 1;
+    }
+
+private:
+    const QString m_Path;
+    const qint64 m_FirstByte;
+    const qint64 m_Length;
+};
+
+inline const uchar* bytes(const QByteArray& buffer, int offset)
+{
+    return reinterpret_cast<const uchar*>(buffer.constData()) + offset;
+}
+
+inline quint16 le16(const QByteArray& buffer, int offset)
+{
+    return qFromLittleEndian<quint16>(bytes(buffer, offset));
+}
+
+inline quint32 le32(const QByteArray& buffer, int offset)
+{
+    return qFromLittleEndian<quint32>(bytes(buffer, offset));
+}
+
+inline quint64 le64(const QByteArray& buffer, int offset)
+{
+    return qFromLittleEndian<quint64>(bytes(buffer, offset));
+}
+
+inline quint32 be32(const QByteArray& buffer, int offset)
+{
+    return qFromBigEndian<quint32>(bytes(buffer, offset));
+}
+
+inline quint64 be64(const QByteArray& buffer, int offset)
+{
+    return qFromBigEndian<quint64>(bytes(buffer, offset));
+}
+
+inline int popCount(quint8 byte)
+{
+    int count = 0;
+    for (; byte; byte &= byte - 1)
+        ++count;
+    return count;
+}
+
+/** Largest read done at once, copyblocks only returns data that is shorter than its block size */
+constexpr qint64 readChunkSize = 8 * 1024 * 1024;
+
+constexpr quint32 f2fsMagic = 0xF2F52010;
+
+/** CRC-32 as f2fs computes it: no final inversion and the magic number as seed */
+quint32 f2fsChecksum(const QByteArray& buffer, int length)
+{
+    quint32 crc = f2fsMagic;
+    for (int i = 0; i < length; ++i) {
+        crc ^= static_cast<quint8>(buffer[i]);
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+    }
+    return crc;
+}
+}
+
+namespace FS
+{
+namespace Superblock
+{
+/** Reads raw bytes from a device.
+
+    The device is opened directly if we have permission to do so, otherwise
+    it is read through the helper.
+
+    @param deviceNode the device node to read from
+    @param offset first byte to read
+    @param size number of bytes to read
+    @param buffer buffer to store the bytes in
+    @return true if all bytes were read
+*/
+bool read(const QString& deviceNode, qint64 offset, qint64 size, QByteArray& buffer)
+{
+    QFile device(deviceNode);
+    if (device.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        if (!device.seek(offset))
+            return false;
+
+        buffer = device.read(size);
+        return buffer.size() == size;
+    }
+
+    buffer.clear();
+    for (qint64 done = 0; done < size; done += readChunkSize) {
+        QByteArray chunk;
+        CopySourceRange source(deviceNode, offset + done, std::min(readChunkSize, size - done));
+        CopyTargetByteArray target(chunk);
+
+        ExternalCommand copyCmd;
+        if (!copyCmd.copyBlocks(source, target) || chunk.size() != source.length())
+            return false;
+
+        buffer.append(chunk);
+    }
+
+    return true;
+}
+
+qint64 ext2UsedCapacity(const QString& deviceNode)
+{
+    QByteArray sb;
+    if (!read(deviceNode, 1024, 1024, sb) || le16(sb, 0x38) != 0xEF53)
+        return -1;
+
+    quint64 blockCount = le32(sb, 0x04);
+    quint64 freeBlocks = le32(sb, 0x0C);
+    if (le32(sb, 0x60) & 0x80) { // EXT4_FEATURE_INCOMPAT_64BIT
+        blockCount |= static_cast<quint64>(le32(sb, 0x150)) << 32;
+        freeBlocks |= static_cast<quint64>(le32(sb, 0x158)) << 32;
+    }
+
+    const quint32 logBlockSize = le32(sb, 0x18);
+    if (logBlockSize > 6 || freeBlocks > blockCount)
+        return -1;
+
+    return (blockCount - freeBlocks) * (1024LL << logBlockSize);
+}
+
+qint64 xfsUsedCapacity(const QString& deviceNode)
+{
+    QByteArray sb;
+    if (!read(deviceNode, 0, 512, sb) || be32(sb, 0) != 0x58465342) // "XFSB"
+        return -1;
+
+    const quint64 blockSize = be32(sb, 4);
+    const quint64 dBlocks = be64(sb, 8);
+    const quint64 fdBlocks = be64(sb, 144);
+    if (fdBlocks > dBlocks)
+        return -1;
+
+    return (dBlocks - fdBlocks) * blockSize;
+}
+
+qint64 btrfsUsedCapacity(const QString& deviceNode)
+{
+    QByteArray sb;
+    if (!read(deviceNode, 0x10000, 4096, sb) || sb.mid(0x40, 8) != QByteArrayLiteral("_BHRfS_M"))
+        return -1;
+
+    // bytes_used of this device's dev_item, same as "btrfs filesystem show" reports for a path
+    return le64(sb, 0xC9 + 16);
+}
+
+qint64 fatUsedCapacity(const QString& deviceNode)
+{
+    QByteArray bs;
+    if (!read(deviceNode, 0, 512, bs) || le16(bs, 510) != 0xAA55)
+        return -1;
+
+    const quint32 bytesPerSector = le16(bs, 11);
+    const quint32 sectorsPerCluster = static_cast<quint8>(bs[13]);
+    const quint32 reservedSectors = le16(bs, 14);
+    const quint32 fats = static_cast<quint8>(bs[16]);
+    const quint32 rootEntries = le16(bs, 17);
+    const quint32 totalSectors = le16(bs, 19) ? le16(bs, 19) : le32(bs, 32);
+    const quint32 fatSize = le16(bs, 22) ? le16(bs, 22) : le32(bs, 36);
+
+    if (bytesPerSector < 512 || bytesPerSector > 4096 || sectorsPerCluster == 0 || fats == 0 || fatSize == 0)
+        return -1;
+
+    const quint64 rootDirSectors = (rootEntries * 32 + bytesPerSector - 1) / bytesPerSector;
+    const quint64 metadataSectors = reservedSectors + static_cast<quint64>(fats) * fatSize + rootDirSectors;
+    if (metadataSectors >= totalSectors)
+        return -1;
+
+    const quint64 clusters = (totalSectors - metadataSectors) / sectorsPerCluster;
+    const int fatBits = clusters < 4085 ? 12 : clusters < 65525 ? 16 : 32;
+
+    // Free clusters are only known from the allocation table (FAT32 FSInfo might be stale)
+    const qint64 fatBytes = std::min(static_cast<qint64>(fatSize) * bytesPerSector, static_cast<qint64>((clusters + 2) * fatBits + 7) / 8);
+    const quint64 entries = std::min(clusters + 2, static_cast<quint64>(fatBytes) * 8 / fatBits);
+
+    // FAT32 tables can be hundreds of megabytes, so they are counted chunk by chunk.
+    // FAT12 entries cross byte boundaries, but a FAT12 table always fits into one chunk.
+    const qint64 chunkSize = fatBits == 12 ? fatBytes : readChunkSize;
+    quint64 usedClusters = 0;
+    for (qint64 chunkStart = 0; chunkStart < fatBytes; chunkStart += chunkSize) {
+        QByteArray fat;
+        if (!read(deviceNode, static_cast<qint64>(reservedSectors) * bytesPerSector + chunkStart, std::min(chunkSize, fatBytes - chunkStart), fat))
+            return -1;
+
+        const quint64 first = std::max<quint64>(2, chunkStart * 8 / fatBits);
+        const quint64 last = std::min(entries, static_cast<quint64>(chunkStart + fat.size()) * 8 / fatBits);
+        fat.append(2, '\0'); // FAT12 entries are read as 16-bit words
+
+        for (quint64 i = first; i < last; ++i) {
+            quint32 entry;
+            if (fatBits == 12)
+                entry = (i & 1) ? le16(fat, i + i / 2) >> 4 : le16(fat, i + i / 2) & 0xFFF;
+            else if (fatBits == 16)
+                entry = le16(fat, i * 2 - chunkStart);
+            else
+                entry = le32(fat, i * 4 - chunkStart) & 0x0FFFFFFF;
+
+            if (entry != 0)
+                ++usedClusters;
+        }
+    }
+
+    return usedClusters * sectorsPerCluster * bytesPerSector;
+}
+
+qint64 exfatUsedCapacity(const QString& deviceNode)
+{
+    QByteArray bs;
+    if (!read(deviceNode, 0, 512, bs) || bs.mid(3, 8) != QByteArrayLiteral("EXFAT   "))
+        return -1;
+
+    const quint32 fatOffset = le32(bs, 80);
+    const quint32 fatLength = le32(bs, 84);
+    const quint32 clusterHeapOffset = le32(bs, 88);
+    const quint32 clusterCount = le32(bs, 92);
+    const quint32 rootCluster = le32(bs, 96);
+    const quint16 volumeFlags = le16(bs, 106);
+    const int bytesPerSectorShift = static_cast<quint8>(bs[108]);
+    const int sectorsPerClusterShift = static_cast<quint8>(bs[109]);
+    const int numberOfFats = static_cast<quint8>(bs[110]);
+
+    if (bytesPerSectorShift < 9 || bytesPerSectorShift > 12 || bytesPerSectorShift + sectorsPerClusterShift > 25 ||
+            numberOfFats < 1 || numberOfFats > 2 || rootCluster < 2)
+        return -1;
+
+    // TexFAT volumes have a second FAT and allocation bitmap, the active ones are selected in the volume flags
+    const int activeFat = numberOfFats == 2 ? (volumeFlags & 1) : 0;
+
+    const qint64 clusterSize = 1LL << (bytesPerSectorShift + sectorsPerClusterShift);
+    auto clusterOffset = [&] (quint32 cluster) {
+        return (static_cast<qint64>(clusterHeapOffset) << bytesPerSectorShift) + (cluster - 2) * clusterSize;
+    };
+    auto isValidCluster = [&] (quint32 cluster) {
+        return cluster >= 2 && cluster - 2 < clusterCount;
+    };
+
+    // Follows a cluster chain through the FAT, returns 0 at the end of the chain or on errors.
+    // The FAT is read in chunks, so walking a chain does not need a read for every cluster.
+    const qint64 fatStart = (static_cast<qint64>(fatOffset) + static_cast<qint64>(activeFat) * fatLength) << bytesPerSectorShift;
+    const qint64 fatBytes = (static_cast<qint64>(clusterCount) + 2) * 4;
+    QByteArray fatChunk;
+    qint64 fatChunkStart = -1;
+    auto nextCluster = [&] (quint32 cluster) -> quint32 {
+        const qint64 entry = cluster * 4LL;
+        if (fatChunkStart < 0 || entry < fatChunkStart || entry >= fatChunkStart + fatChunk.size()) {
+            fatChunkStart = entry - entry % readChunkSize;
+            if (!read(deviceNode, fatStart + fatChunkStart, std::min(readChunkSize, fatBytes - fatChunkStart), fatChunk)) {
+                fatChunkStart = -1;
+                return 0;
+            }
+        }
+
+        const quint32 next = le32(fatChunk, entry - fatChunkStart);
+        return isValidCluster(next) ? next : 0;
+    };
+
+    // The allocation bitmap is described by an entry of type 0x81 in the root directory
+    quint32 bitmapCluster = 0;
+    qint64 bitmapLength = 0;
+    bool endOfDirectory = false;
+    quint32 cluster = rootCluster;
+    for (quint32 clusters = 0; isValidCluster(cluster) && clusters < clusterCount && bitmapCluster == 0 && !endOfDirectory; ++clusters) {
+        QByteArray rootDir;
+        if (!read(deviceNode, clusterOffset(cluster), clusterSize, rootDir))
+            return -1;
+
+        for (int entry = 0; entry + 32 <= rootDir.size(); entry += 32) {
+            const quint8 type = static_cast<quint8>(rootDir[entry]);
+            if (type == 0x00) {
+                endOfDirectory = true;
+                break;
+            }
+            if (type == 0x81 && (static_cast<quint8>(rootDir[entry + 1]) & 1) == activeFat) {
+                bitmapCluster = le32(rootDir, entry + 20);
+                bitmapLength = static_cast<qint64>(le64(rootDir, entry + 24));
+                break;
+            }
+        }
+
+        cluster = nextCluster(cluster);
+    }
+
+    if (!isValidCluster(bitmapCluster) || bitmapLength < (static_cast<qint64>(clusterCount) + 7) / 8)
+        return -1;
+
+    // The bitmap might be fragmented, each contiguous run of its clusters is read at once
+    QByteArray bitmap;
+    const qint64 bitmapSize = (static_cast<qint64>(clusterCount) + 7) / 8;
+    for (cluster = bitmapCluster; bitmap.size() < bitmapSize;) {
+        if (!isValidCluster(cluster))
+            return -1;
+
+        const quint32 first = cluster;
+        const qint64 remaining = bitmapSize - bitmap.size();
+        qint64 runSize = clusterSize;
+        for (cluster = nextCluster(cluster); runSize < remaining && cluster == first + runSize / clusterSize; cluster = nextCluster(cluster))
+            runSize += clusterSize;
+
+        QByteArray chunk;
+        if (!read(deviceNode, clusterOffset(first), std::min(runSize, remaining), chunk))
+            return -1;
+
+        bitmap.append(chunk);
+    }
+
+    quint64 usedClusters = 0;
+    for (const char byte : qAsConst(bitmap))
+        usedClusters += popCount(static_cast<quint8>(byte));
+
+    // ignore padding bits after the last cluster
+    if (clusterCount % 8)
+        usedClusters -= popCount(static_cast<quint8>(bitmap[bitmap.size() - 1]) >> (clusterCount % 8));
+
+    return usedClusters * clusterSize;
+}
+
+qint64 f2fsUsedCapacity(const QString& deviceNode)
+{
+    QByteArray sb;
+    if (!read(deviceNode, 1024, 1024, sb) || le32(sb, 0) != f2fsMagic)
+        return -1;
+
+    const quint32 logBlockSize = le32(sb, 16);
+    const quint32 logBlocksPerSegment = le32(sb, 20);
+    if (logBlockSize < 9 || logBlockSize > 16 || logBlocksPerSegment > 16)
+        return -1;
+
+    const quint64 blockSize = 1ULL << logBlockSize;
+    const quint64 blockCount = le64(sb, 36);
+    const quint64 cpBlockAddress = le32(sb, 76);
+    const quint64 mainBlockAddress = le32(sb, 92);
+
+    // A checkpoint block is valid if its checksum matches, see validate_checkpoint in the kernel
+    auto readCheckpointBlock = [&] (quint64 address, QByteArray& block) {
+        if (!read(deviceNode, address * blockSize, blockSize, block))
+            return false;
+
+        const quint32 checksumOffset = le32(block, 164);
+        if (checksumOffset < 192 || checksumOffset > blockSize - 4)
+            return false;
+
+        return f2fsChecksum(block, checksumOffset) == le32(block, checksumOffset);
+    };
+
+    // Usage is kept in the checkpoint, there are two copies and the valid one with newer version is current.
+    // A copy is only valid if the last block of its pack was written with the same version.
+    quint64 checkpointVersion = 0;
+    qint64 validBlocks = -1;
+    for (const quint64 address : { cpBlockAddress, cpBlockAddress + (1ULL << logBlocksPerSegment) }) {
+        QByteArray cp;
+        if (!readCheckpointBlock(address, cp))
+            continue;
+
+        const quint64 version = le64(cp, 0);
+        const quint64 userBlocks = le64(cp, 8);
+        const quint64 valid = le64(cp, 16);
+        const quint32 packBlocks = le32(cp, 136);
+        if (userBlocks > blockCount || valid > userBlocks || packBlocks == 0 || packBlocks > (1U << logBlocksPerSegment))
+            continue;
+
+        QByteArray footer;
+        if (!readCheckpointBlock(address + packBlocks - 1, footer) || le64(footer, 0) != version)
+            continue;
+
+        if (validBlocks < 0 || version > checkpointVersion) {
+            checkpointVersion = version;
+            validBlocks = valid;
+        }
+    }
+
+    if (validBlocks < 0)
+        return -1;
+
+    // metadata area before the main area is always in use
+    return (mainBlockAddress + validBlocks) * blockSize;
+}
+}
+}
@@ -0,0 +1,41 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_SUPERBLOCK_H
+#define KPMCORE_SUPERBLOCK_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+namespace FS
+{
+/** In-process readers of file system usage.
+
+    Used capacity of unmounted file systems is read straight from the on-disk
+    superblock (and allocation tables where the superblock has no free count)
+    instead of parsing the output of file system tools. All functions return
+    -1 if the device cannot be read or does not contain the expected file
+    system, callers then fall back to the external tool.
+
+    Only the exFAT and F2FS readers handle every layout the kernel accepts
+    (fragmented directories and bitmaps, TexFAT, torn checkpoints), so only
+    these file systems report used capacity without a tool.
+*/
+namespace Superblock
+{
+bool read(const QString& deviceNode, qint64 offset, qint64 size, QByteArray& buffer);
+
+qint64 ext2UsedCapacity(const QString& deviceNode);
+qint64 xfsUsedCapacity(const QString& deviceNode);
+qint64 btrfsUsedCapacity(const QString& deviceNode);
+qint64 fatUsedCapacity(const QString& deviceNode);
+qint64 exfatUsedCapacity(const QString& deviceNode);
+qint64 f2fsUsedCapacity(const QString& deviceNode);
+}
+}
+
+#endif
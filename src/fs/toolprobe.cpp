@@ -0,0 +1,158 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "fs/toolprobe.h"
+
+#include "util/externalcommand.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace
+{
+// Increase when the format of the cache changes
+constexpr int cacheVersion = 2;
+
+struct ProbeCache
+{
+    QMutex mutex;
+    QJsonObject probes;
+    bool loaded = false;
+    bool changed = false;
+};
+
+ProbeCache& probeCache()
+{
+    static ProbeCache cache;
+    return cache;
+}
+
+// Must be called with the cache locked
+void load(ProbeCache& cache)
+{
+    cache.loaded = true;
+
+    QFile file(FS::ToolProbe::fileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    const QJsonObject json = QJsonDocument::fromJson(file.readAll()).object();
+    if (json[QLatin1String("version")].toInt() == cacheVersion)
+        cache.probes = json[QLatin1String("probes")].toObject();
+}
+
+/** @return the executable (symbolic links resolved), its modification time and size */
+QJsonObject stamp(const QString& path)
+{
+    const QFileInfo tool(QFileInfo(path).canonicalFilePath());
+    return QJsonObject {
+        { QStringLiteral("target"), tool.filePath() },
+        { QStringLiteral("mtime"), tool.lastModified().toMSecsSinceEpoch() },
+        { QStringLiteral("size"), tool.size() },
+    };
+}
+}
+
+namespace FS
+{
+namespace ToolProbe
+{
+/** Runs a tool or returns the result of an earlier run of the same, unchanged tool.
+    @param cmdName name of the tool
+    @param args arguments to run the tool with
+    @param exitCode the tool's exit code
+    @param output the tool's output
+    @return false if the tool was not found or could not be run
+*/
+bool probe(const QString& cmdName, const QStringList& args, int& exitCode, QByteArray& output)
+{
+    QString cmdFullPath = QStandardPaths::findExecutable(cmdName);
+    if (cmdFullPath.isEmpty())
+        cmdFullPath = QStandardPaths::findExecutable(cmdName, { QStringLiteral("/sbin/"), QStringLiteral("/usr/sbin/"), QStringLiteral("/usr/local/sbin/") });
+    if (cmdFullPath.isEmpty())
+        return false;
+
+    // A JSON array, so that e.g. the arguments "-a -b" and "-a", "-b" do not share an entry
+    const QString key = QString::fromUtf8(QJsonDocument(QJsonArray::fromStringList(QStringList(cmdFullPath) + args)).toJson(QJsonDocument::Compact));
+    const QJsonObject toolStamp = stamp(cmdFullPath);
+
+    ProbeCache& cache = probeCache();
+    {
+        QMutexLocker locker(&cache.mutex);
+        if (!cache.loaded)
+            load(cache);
+
+        const QJsonObject entry = cache.probes[key].toObject();
+        if (entry[QLatin1String("stamp")].toObject() == toolStamp) {
+            exitCode = entry[QLatin1String("exitCode")].toInt();
+            output = QByteArray::fromBase64(entry[QLatin1String("output")].toString().toLatin1());
+            return true;
+        }
+    }
+
+    // Several probes can run at the same time, so do not hold the lock
+    ExternalCommand cmd(cmdFullPath, args);
+    if (!cmd.run())
+        return false;
+
+    exitCode = cmd.exitCode();
+    output = cmd.rawOutput();
+
+    QMutexLocker locker(&cache.mutex);
+    cache.probes[key] = QJsonObject {
+        { QStringLiteral("stamp"), toolStamp },
+        { QStringLiteral("exitCode"), exitCode },
+        { QStringLiteral("output"), QString::fromLatin1(output.toBase64()) },
+    };
+    cache.changed = true;
+
+    return true;
+}
+
+/** Writes the cache if tools were run since it was loaded.
+    @return false if the cache could not be written
+*/
+bool save()
+{
+    ProbeCache& cache = probeCache();
+    QJsonObject json;
+    {
+        QMutexLocker locker(&cache.mutex);
+        if (!cache.changed)
+            return true;
+
+        json[QLatin1String("version")] = cacheVersion;
+        json[QLatin1String("probes")] = cache.probes;
+        cache.changed = false;
+    }
+
+    if (!QDir().mkpath(QFileInfo(fileName()).absolutePath()))
+        return false;
+
+    QSaveFile file(fileName());
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    file.write(QJsonDocument(json).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+/** @return the name of the cache file */
+QString fileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/kpmcore/toolprobes.json");
+}
+}
+}
@@ -0,0 +1,33 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_TOOLPROBE_H
+#define KPMCORE_TOOLPROBE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+namespace FS
+{
+/** Probing of file system tools.
+
+    File systems find out which operations they support by running their
+    tools, e.g. "e2fsck -V". The exit code and output of each run are kept
+    in a cache file keyed by the tool's path and arguments and are reused
+    as long as the tool's modification time and size do not change, so
+    later starts do not have to run the tools again. All functions are
+    thread-safe.
+*/
+namespace ToolProbe
+{
+bool probe(const QString& cmdName, const QStringList& args, int& exitCode, QByteArray& output);
+bool save();
+QString fileName();
+}
+}
+
+#endif
@@ -8,6 +8,7 @@
 */
 
 #include "fs/udf.h"
+#include "fs/toolprobe.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
@@ -44,8 +45,9 @@ void udf::init()
 
     if (m_Create == cmdSupportFileSystem) {
         // Detect old mkudffs prior to version 1.1 by lack of --label option
-        ExternalCommand cmd(QStringLiteral("mkudffs"), { QStringLiteral("--help") });
-        oldMkudffsVersion = cmd.run(-1) && !cmd.output().contains(QStringLiteral("--label"));
+        int exitCode;
+        QByteArray output;
+        oldMkudffsVersion = ToolProbe::probe(QStringLiteral("mkudffs"), { QStringLiteral("--help") }, exitCode, output) && !QString::fromLocal8Bit(output).contains(QStringLiteral("--label"));
     }
 }
 
@@ -9,6 +9,7 @@
 */
 
 #include "fs/xfs.h"
+#include "fs/superblock.h"
 
 #include "util/externalcommand.h"
 #include "util/capacity.h"
@@ -90,6 +91,10 @@ int xfs::maxLabelLength() const
 
 qint64 xfs::readUsedCapacity(const QString& deviceNode) const
 {
+    const qint64 used = FS::Superblock::xfsUsedCapacity(deviceNode);
+    if (used > -1)
+        return used;
+
     ExternalCommand cmd(QStringLiteral("xfs_db"), { QStringLiteral("-c"), QStringLiteral("sb 0"), QStringLiteral("-c"), QStringLiteral("print"), deviceNode });
 
     if (cmd.run(-1) && cmd.exitCode() == 0) {
@@ -19,6 +19,7 @@
 #include "core/partition.h"
 
 #include "fs/filesystem.h"
+#include "fs/luks.h"
 
 #include "util/report.h"
 
@@ -44,6 +45,10 @@ bool CreateFileSystemJob::run(Report& parent)
     if (partition().fileSystem().type() == FileSystem::Type::Unformatted)
         return true;
 
+    // Choose cipher and encryption sector size for the device unless the caller did
+    if (FS::luks* luksFs = dynamic_cast<FS::luks*>(&partition().fileSystem()))
+        luksFs->recommendFormatOptions(device(), partition());
+
     bool createResult;
     if (partition().fileSystem().supportCreate() == FileSystem::cmdSupportFileSystem) {
         if (partition().fileSystem().supportCreateWithLabel() == FileSystem::cmdSupportFileSystem) {
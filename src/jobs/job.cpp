@@ -17,13 +17,24 @@
 
 #include "util/externalcommand.h"
 #include "util/report.h"
+#include "util/trace.h"
 
+#include <QHash>
 #include <QIcon>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QTime>
 #include <QVariantMap>
 
 #include <KLocalizedString>
 
+namespace
+{
+// Start times of the running jobs that are traced. Kept outside of Job, so its layout does not change.
+QMutex traceStartsMutex;
+QHash<const Job*, qint64> traceStarts;
+}
+
 Job::Job() :
     m_Report(nullptr),
     m_Status(Status::Pending)
@@ -103,6 +114,11 @@ Report* Job::jobStarted(Report& parent)
 {
     Q_EMIT started();
 
+    if (Trace::isEnabled()) {
+        QMutexLocker locker(&traceStartsMutex);
+        traceStarts.insert(this, Trace::now());
+    }
+
     return parent.newChild(xi18nc("@info:progress", "Job: %1", description()));
 }
 
@@ -112,6 +128,16 @@ void Job::jobFinished(Report& report, bool b)
     Q_EMIT progress(numSteps());
     Q_EMIT finished();
 
+    if (Trace::isEnabled()) {
+        QMutexLocker locker(&traceStartsMutex);
+        const qint64 traceStart = traceStarts.value(this, -1);
+        traceStarts.remove(this);
+        locker.unlock();
+
+        if (traceStart >= 0)
+            Trace::addSpan("job", description(), traceStart, Trace::now(), { { QStringLiteral("success"), b } });
+    }
+
     report.setStatus(xi18nc("@info:progress job status (error, warning, ...)", "%1: %2", description(), statusText()));
 }
 
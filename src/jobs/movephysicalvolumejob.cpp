@@ -8,11 +8,23 @@
 #include "jobs/movephysicalvolumejob.h"
 
 #include "core/lvmdevice.h"
+#include "core/lvmreport.h"
 
 #include "util/report.h"
 
+#include <QFileInfo>
+#include <QThread>
+
 #include <KLocalizedString>
 
+#include <algorithm>
+
+// Progress of background moves is polled every pollInterval ms, failed polls are retried with
+// exponential back-off up to maxPollInterval ms
+static constexpr unsigned long pollInterval = 500;
+static constexpr unsigned long maxPollInterval = 8000;
+static constexpr int maxFailedQueries = 10;
+
 /** Creates a new MovePhysicalVolumeJob
  * @param d Device representing LVM Volume Group
 */
@@ -23,9 +35,14 @@ MovePhysicalVolumeJob::MovePhysicalVolumeJob(LvmDevice& d, const QList <const Pa
 {
 }
 
+qint32 MovePhysicalVolumeJob::numSteps() const
+{
+    return 100;
+}
+
 bool MovePhysicalVolumeJob::run(Report& parent)
 {
-    bool rval = false;
+    bool rval = true;
 
     Report* report = jobStarted(parent);
 
@@ -36,10 +53,121 @@ bool MovePhysicalVolumeJob::run(Report& parent)
         }
     }
 
+    struct Move
+    {
+        QString pvPath;
+        QStringList destinations;
+        qint64 extents;
+    };
+
+    // Give each source physical volume its own destinations if they have enough free extents,
+    // so that all of them can be evacuated at the same time. Earlier operations might have
+    // changed LVM without the report being read again.
+    LvmReport::invalidate();
+    const auto lvmReport = LvmReport::current();
+    auto freeExtents = [&lvmReport] (const QString& pvPath) {
+        const LvmReport::PhysicalVolume* pv = lvmReport->physicalVolume(pvPath);
+        return pv ? pv->extentCount - pv->allocatedExtents : 0;
+    };
+
+    QStringList pool = destinations;
+    std::sort(pool.begin(), pool.end(), [&freeExtents] (const QString& a, const QString& b) { return freeExtents(a) > freeExtents(b); });
+
+    QVector<Move> moves;
     for (const auto &p : partList()) {
-        rval = LvmDevice::movePV(*report, p->partitionPath(), destinations);
-        if (rval == false) {
-            break;
+        const LvmReport::PhysicalVolume* pv = lvmReport->physicalVolume(p->partitionPath());
+        moves.append({ p->partitionPath(), QStringList(), pv ? pv->allocatedExtents : -1 });
+    }
+    std::sort(moves.begin(), moves.end(), [] (const Move& a, const Move& b) { return a.extents > b.extents; });
+
+    bool disjoint = true;
+    qint64 totalExtents = 0;
+    for (auto &move : moves) {
+        qint64 available = 0;
+        while (available < move.extents && !pool.isEmpty()) {
+            move.destinations.append(pool.first());
+            available += freeExtents(pool.takeFirst());
+        }
+        disjoint = disjoint && move.extents >= 0 && available >= move.extents;
+        totalExtents += qMax(move.extents, 0LL);
+    }
+
+    // Moves run in the background; their progress is polled from the pvmove volumes LVM creates
+    qint64 movedExtents = 0;
+    auto evacuate = [&] (const QVector<Move>& batch) {
+        // Moves that might still be running are aborted if the batch fails, so that
+        // none of them keeps going in the background after the job has finished
+        QStringList running;
+        auto abortRunning = [&] {
+            for (const auto &pvPath : qAsConst(running)) {
+                if (LvmDevice::abortMovePV(*report, pvPath))
+                    report->line() << xi18nc("@info:progress", "Aborted moving extents off <filename>%1</filename>.", pvPath);
+                else
+                    report->line() << xi18nc("@info:progress", "Could not abort moving extents off <filename>%1</filename>, it might still be running in the background.", pvPath);
+            }
+        };
+
+        for (const auto &move : batch) {
+            if (!LvmDevice::movePV(*report, move.pvPath, disjoint ? move.destinations : destinations, true)) {
+                abortRunning();
+                return false;
+            }
+            running.append(move.pvPath);
+        }
+
+        // lvs can fail while LVM holds its locks, only a successful query without the moves means they are done
+        int failedQueries = 0;
+        while (!running.isEmpty()) {
+            QHash<QString, int> copyPercent;
+            if (!LvmDevice::movePVProgress(copyPercent)) {
+                if (++failedQueries > maxFailedQueries) {
+                    report->line() << xi18nc("@info:progress", "Could not query the progress of moving physical volumes.");
+                    abortRunning();
+                    return false;
+                }
+                QThread::msleep(std::min(pollInterval << failedQueries, maxPollInterval));
+                continue;
+            }
+
+            failedQueries = 0;
+            running.clear();
+            qint64 moved = movedExtents;
+            for (const auto &move : batch) {
+                const auto it = copyPercent.constFind(QFileInfo(move.pvPath).canonicalFilePath());
+                if (it != copyPercent.constEnd())
+                    running.append(move.pvPath);
+                moved += qMax(move.extents, 0LL) * (it != copyPercent.constEnd() ? it.value() : 100) / 100;
+            }
+
+            emitProgress(totalExtents > 0 ? moved * 100 / totalExtents : 0);
+            if (!running.isEmpty())
+                QThread::msleep(pollInterval);
+        }
+
+        for (const auto &move : batch)
+            movedExtents += qMax(move.extents, 0LL);
+        return true;
+    };
+
+    if (disjoint) {
+        rval = evacuate(moves);
+    } else {
+        for (const auto &move : qAsConst(moves)) {
+            rval = evacuate({ move });
+            if (rval == false) {
+                break;
+            }
+        }
+    }
+
+    // A move that fails in the background leaves its extents behind
+    LvmReport::invalidate();
+    const auto result = LvmReport::current();
+    for (const auto &move : qAsConst(moves)) {
+        const LvmReport::PhysicalVolume* pv = result->physicalVolume(move.pvPath);
+        if (pv && pv->allocatedExtents > 0) {
+            report->line() << xi18nc("@info:progress", "Could not move all extents off <filename>%1</filename>.", move.pvPath);
+            rval = false;
         }
     }
 
@@ -0,0 +1,136 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "jobs/reencryptfilesystemjob.h"
+
+#include "core/device.h"
+#include "core/partition.h"
+
+#include "fs/luks2.h"
+
+#include "util/externalcommand.h"
+#include "util/report.h"
+
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <KLocalizedString>
+
+#include <functional>
+
+namespace
+{
+/** Runs cryptsetup in QThreadPool while the job polls the progress. */
+class ReencryptRunnable : public QRunnable
+{
+public:
+    explicit ReencryptRunnable(std::function<void()> reencrypt) : m_Reencrypt(std::move(reencrypt)) {}
+
+    void run() override {
+        m_Reencrypt();
+    }
+
+private:
+    std::function<void()> m_Reencrypt;
+};
+}
+
+/** Creates a new ReencryptFileSystemJob
+    @param d the Device the LUKS2 volume is on
+    @param p the Partition the LUKS2 volume is in
+    @param passphrase passphrase of the volume, empty to use the one it was opened with
+    @param options the new cipher, key size and encryption sector size
+    @param resilience how the area that is being reencrypted is protected against crashes
+    @param hotzoneSize maximum amount of data reencrypted at once in bytes, 0 for cryptsetup's default
+*/
+ReencryptFileSystemJob::ReencryptFileSystemJob(Device& d, Partition& p, const QString& passphrase, const FS::luks::FormatOptions& options, FS::luks2::Resilience resilience, qint64 hotzoneSize) :
+    Job(),
+    m_Device(d),
+    m_Partition(p),
+    m_Passphrase(passphrase),
+    m_FormatOptions(options),
+    m_Resilience(resilience),
+    m_HotzoneSize(hotzoneSize)
+{
+}
+
+qint32 ReencryptFileSystemJob::numSteps() const
+{
+    return 100;
+}
+
+bool ReencryptFileSystemJob::run(Report& parent)
+{
+    bool rval = false;
+
+    Report* report = jobStarted(parent);
+
+    FS::luks2* luksFs = dynamic_cast<FS::luks2*>(&partition().fileSystem());
+    if (luksFs == nullptr) {
+        report->line() << xi18nc("@info:progress", "Only LUKS2 volumes can be reencrypted.");
+        jobFinished(*report, rval);
+        return rval;
+    }
+
+    const QString deviceNode = partition().deviceNode();
+    const QString key = m_Passphrase.isEmpty() ? luksFs->passphrase() : m_Passphrase;
+    if (key.isEmpty()) {
+        report->line() << xi18nc("@info:progress", "No passphrase is known for <filename>%1</filename>, it is needed to reencrypt the volume.", deviceNode);
+        jobFinished(*report, rval);
+        return rval;
+    }
+
+    const QByteArray passphrase = key.toLocal8Bit() + '\n';
+    const qint64 totalBytes = partition().capacity() - qMax(luksFs->payloadOffset(), 0LL);
+    luksFs->setFormatOptions(m_FormatOptions);
+
+    // Older cryptsetup cannot report how much has been reencrypted
+    const bool progressKnown = FS::luks2::canDumpJsonMetadata();
+    if (!progressKnown)
+        report->line() << xi18nc("@info:progress", "The progress of the reencryption cannot be shown, it needs cryptsetup 2.4 or later.");
+
+    qint64 done = 0;
+    const bool resume = luksFs->reencryptionProgress(deviceNode, partition().capacity(), done);
+    if (resume)
+        report->line() << xi18nc("@info:progress", "Resuming interrupted reencryption of <filename>%1</filename>.", deviceNode);
+
+    const QStringList args = luksFs->reencryptArguments(deviceNode, resume, m_Resilience, m_HotzoneSize);
+    bool success = false;
+    QString output;
+
+    QThreadPool pool;
+    pool.start(new ReencryptRunnable([&args, &passphrase, &success, &output] {
+        ExternalCommand reencryptCmd(QStringLiteral("cryptsetup"), args);
+        reencryptCmd.write(passphrase);
+        success = reencryptCmd.run(-1) && reencryptCmd.exitCode() == 0;
+        output = reencryptCmd.output();
+    }));
+
+    while (!pool.waitForDone(500)) {
+        if (!progressKnown)
+            continue;
+
+        luksFs->reencryptionProgress(deviceNode, partition().capacity(), done);
+        emitProgress(totalBytes > 0 ? qMin(done * 100 / totalBytes, 100LL) : 0);
+    }
+
+    if (success) {
+        rval = true;
+        emitProgress(100);
+    } else {
+        report->line() << output;
+        report->line() << xi18nc("@info:progress", "Reencrypting <filename>%1</filename> failed.", deviceNode);
+    }
+
+    jobFinished(*report, rval);
+
+    return rval;
+}
+
+QString ReencryptFileSystemJob::description() const
+{
+    return xi18nc("@info:progress", "Reencrypt the LUKS volume on <filename>%1</filename>", partition().deviceNode());
+}
@@ -0,0 +1,65 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_REENCRYPTFILESYSTEMJOB_H
+#define KPMCORE_REENCRYPTFILESYSTEMJOB_H
+
+#include "jobs/job.h"
+
+#include "fs/luks2.h"
+
+#include <QString>
+
+class Partition;
+class Device;
+class Report;
+
+/** Reencrypt a LUKS2 volume in place.
+
+    Changes the volume key and, depending on the format options, the cipher
+    and encryption sector size with cryptsetup reencrypt. Open volumes stay
+    usable while they are reencrypted. An interrupted reencryption is resumed.
+    The amount of data reencrypted at once is bounded by the hotzone size and
+    the resilience mode decides how often it is written.
+
+    @author Andrius Štikonas <andrius@stikonas.eu>
+*/
+class ReencryptFileSystemJob : public Job
+{
+public:
+    ReencryptFileSystemJob(Device& d, Partition& p, const QString& passphrase, const FS::luks::FormatOptions& options,
+                           FS::luks2::Resilience resilience = FS::luks2::Resilience::Checksum, qint64 hotzoneSize = 0);
+
+public:
+    bool run(Report& parent) override;
+    qint32 numSteps() const override;
+    QString description() const override;
+
+protected:
+    Partition& partition() {
+        return m_Partition;
+    }
+    const Partition& partition() const {
+        return m_Partition;
+    }
+
+    Device& device() {
+        return m_Device;
+    }
+    const Device& device() const {
+        return m_Device;
+    }
+
+private:
+    Device& m_Device;
+    Partition& m_Partition;
+    QString m_Passphrase;
+    FS::luks::FormatOptions m_FormatOptions;
+    FS::luks2::Resilience m_Resilience;
+    qint64 m_HotzoneSize; // bytes, 0 for cryptsetup's default
+};
+
+#endif
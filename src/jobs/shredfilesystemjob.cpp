@@ -16,6 +16,7 @@
 #include "fs/filesystem.h"
 #include "fs/filesystemfactory.h"
 
+#include "util/externalcommand.h"
 #include "util/report.h"
 
 #include <QDebug>
@@ -34,6 +35,31 @@ ShredFileSystemJob::ShredFileSystemJob(Device& d, Partition& p, bool randomShred
 {
 }
 
+/** Resets the zones of the file system on a zoned device, which discards their data without writing to them.
+    @param report the report to write to
+    @param d the zoned Device
+    @param firstByte first byte of the file system, must be the start of a zone
+    @param lastByte last byte of the file system
+    @return true on success
+*/
+static bool resetZones(Report& report, const Device& d, qint64 firstByte, qint64 lastByte)
+{
+    const qint64 zoneSize = d.zoneSize();
+    if (firstByte % zoneSize != 0 || ((lastByte + 1) % zoneSize != 0 && lastByte + 1 != d.capacity())) {
+        report.line() << xi18nc("@info:progress", "The file system is not aligned to the zones of <filename>%1</filename>.", d.deviceNode());
+        return false;
+    }
+
+    // blkzone takes 512 byte sectors regardless of the logical sector size
+    ExternalCommand cmd(report, QStringLiteral("blkzone"), {
+                            QStringLiteral("reset"),
+                            QStringLiteral("--offset"), QString::number(firstByte / 512),
+                            QStringLiteral("--length"), QString::number((lastByte + 1 - firstByte) / 512),
+                            d.deviceNode() });
+
+    return cmd.run(-1) && cmd.exitCode() == 0;
+}
+
 qint32 ShredFileSystemJob::numSteps() const
 {
     return 100;
@@ -52,8 +78,17 @@ bool ShredFileSystemJob::run(Report& parent)
 
     Report* report = jobStarted(parent);
 
+    // Resetting zones is both faster than overwriting them and the only way to
+    // rewrite sequential zones. Host-aware devices can still be overwritten if it fails.
+    if (device().isZoned()) {
+        report->line() << xi18nc("@info:progress", "Resetting the zones of <filename>%1</filename>.", partition().deviceNode());
+        rval = resetZones(*report, device(), partition().fileSystem().firstByte(), partition().fileSystem().lastByte());
+        if (rval)
+            emitProgress(100);
+    }
+
     // Again, a scope for copyTarget and copySource. See MoveFileSystemJob::run()
-    {
+    if (!rval && device().zoneModel() != Device::ZoneModel::HostManaged) {
         CopyTargetDevice copyTarget(device(), partition().fileSystem().firstByte(), partition().fileSystem().lastByte());
         CopySourceShred copySource(partition().capacity(), m_RandomShred);
 
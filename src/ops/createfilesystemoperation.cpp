@@ -14,6 +14,7 @@
 #include "jobs/createfilesystemjob.h"
 #include "jobs/checkfilesystemjob.h"
 
+#include "fs/cryptbenchmark.h"
 #include "fs/filesystem.h"
 #include "fs/filesystemfactory.h"
 
@@ -42,6 +43,10 @@ CreateFileSystemOperation::CreateFileSystemOperation(Device& d, Partition& p, Fi
     addJob(deleteJob());
     addJob(createJob());
     addJob(checkJob());
+
+    // The job picks the fastest cipher, benchmark now instead of while applying
+    if (newType == FileSystem::Type::Luks || newType == FileSystem::Type::Luks2)
+        FS::CryptBenchmark::prepare();
 }
 
 CreateFileSystemOperation::~CreateFileSystemOperation()
@@ -22,6 +22,7 @@
 #include "jobs/setpartflagsjob.h"
 #include "jobs/checkfilesystemjob.h"
 
+#include "fs/cryptbenchmark.h"
 #include "fs/filesystem.h"
 #include "fs/filesystemfactory.h"
 
@@ -77,6 +78,10 @@ NewOperation::NewOperation(Device& d, Partition* p) :
         m_CreateFileSystemJob = new CreateFileSystemJob(targetDevice(), newPartition(), fs.label());
         addJob(createFileSystemJob());
 
+        // The job picks the fastest cipher, benchmark now instead of while applying
+        if (fs.type() == FileSystem::Type::Luks || fs.type() == FileSystem::Type::Luks2)
+            FS::CryptBenchmark::prepare();
+
         if (fs.type() == FileSystem::Type::Lvm2_PV) {
             m_SetPartFlagsJob = new SetPartFlagsJob(targetDevice(), newPartition(), PartitionTable::Flag::Lvm);
             addJob(setPartFlagsJob());
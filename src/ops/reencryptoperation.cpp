@@ -0,0 +1,96 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "ops/reencryptoperation.h"
+
+#include "core/partition.h"
+#include "core/device.h"
+
+#include "fs/luks2.h"
+
+#include "jobs/reencryptfilesystemjob.h"
+
+#include <QString>
+
+#include <KLocalizedString>
+
+/** Creates a new ReencryptOperation.
+    @param d the Device the LUKS2 volume is on
+    @param p the Partition the LUKS2 volume is in
+    @param passphrase passphrase of the volume, empty to use the one it was opened with
+    @param options the new cipher, key size and encryption sector size
+    @param resilience how the area that is being reencrypted is protected against crashes
+    @param hotzoneSize maximum amount of data reencrypted at once in bytes, 0 for cryptsetup's default
+*/
+ReencryptOperation::ReencryptOperation(Device& d, Partition& p, const QString& passphrase, const FS::luks::FormatOptions& options, FS::luks2::Resilience resilience, qint64 hotzoneSize) :
+    Operation(),
+    m_TargetDevice(d),
+    m_Partition(p),
+    m_FormatOptions(options),
+    m_OldKeySize(-1),
+    m_ReencryptJob(new ReencryptFileSystemJob(targetDevice(), partition(), passphrase, options, resilience, hotzoneSize))
+{
+    addJob(reencryptJob());
+}
+
+/** Shows the new cipher and key size, options that were left empty keep the current ones */
+void ReencryptOperation::preview()
+{
+    FS::luks* luksFs = dynamic_cast<FS::luks*>(&partition().fileSystem());
+    if (luksFs == nullptr)
+        return;
+
+    m_OldCipherName = luksFs->cipherName();
+    m_OldCipherMode = luksFs->cipherMode();
+    m_OldKeySize = luksFs->keySize();
+
+    QString cipherName = m_OldCipherName;
+    QString cipherMode = m_OldCipherMode;
+    if (!m_FormatOptions.cipher.isEmpty()) {
+        // e.g. "aes-xts-plain64" is the cipher "aes" in mode "xts-plain64"
+        const int separator = m_FormatOptions.cipher.indexOf(QLatin1Char('-'));
+        cipherName = m_FormatOptions.cipher.left(separator);
+        cipherMode = separator < 0 ? QString() : m_FormatOptions.cipher.mid(separator + 1);
+    }
+
+    luksFs->setCipher(cipherName, cipherMode, m_FormatOptions.keySize > 0 ? m_FormatOptions.keySize : m_OldKeySize);
+}
+
+void ReencryptOperation::undo()
+{
+    FS::luks* luksFs = dynamic_cast<FS::luks*>(&partition().fileSystem());
+    if (luksFs == nullptr)
+        return;
+
+    luksFs->setCipher(m_OldCipherName, m_OldCipherMode, m_OldKeySize);
+}
+
+bool ReencryptOperation::targets(const Device& d) const
+{
+    return d == targetDevice();
+}
+
+bool ReencryptOperation::targets(const Partition& p) const
+{
+    return p == partition();
+}
+
+QString ReencryptOperation::description() const
+{
+    return xi18nc("@info:status", "Reencrypt partition <filename>%1</filename>", partition().deviceNode());
+}
+
+/** Can a Partition be reencrypted?
+    @param p the Partition in question, may be nullptr.
+    @return true if @p p is a LUKS2 volume and cryptsetup is available.
+*/
+bool ReencryptOperation::canReencrypt(const Partition* p)
+{
+    if (p == nullptr || p->state() == Partition::State::New)
+        return false;
+
+    return dynamic_cast<const FS::luks2*>(&p->fileSystem()) != nullptr && FS::luks::m_Create != FileSystem::cmdSupportNone;
+}
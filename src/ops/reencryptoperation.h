@@ -0,0 +1,76 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_REENCRYPTOPERATION_H
+#define KPMCORE_REENCRYPTOPERATION_H
+
+#include "util/libpartitionmanagerexport.h"
+
+#include "fs/luks2.h"
+#include "ops/operation.h"
+
+#include <QString>
+
+class Partition;
+class Device;
+class ReencryptFileSystemJob;
+
+/** Reencrypt a LUKS2 volume with a new key and, optionally, a new cipher.
+    @author Andrius Štikonas <andrius@stikonas.eu>
+*/
+class LIBKPMCORE_EXPORT ReencryptOperation : public Operation
+{
+    friend class OperationStack;
+
+    Q_DISABLE_COPY(ReencryptOperation)
+
+public:
+    ReencryptOperation(Device& targetDevice, Partition& partition, const QString& passphrase, const FS::luks::FormatOptions& options,
+                       FS::luks2::Resilience resilience = FS::luks2::Resilience::Checksum, qint64 hotzoneSize = 0);
+
+public:
+    QString iconName() const override {
+        return QStringLiteral("document-encrypt");
+    }
+    QString description() const override;
+    void preview() override;
+    void undo() override;
+
+    bool targets(const Device& d) const override;
+    bool targets(const Partition& p) const override;
+
+    static bool canReencrypt(const Partition* p);
+
+protected:
+    Device& targetDevice() {
+        return m_TargetDevice;
+    }
+    const Device& targetDevice() const {
+        return m_TargetDevice;
+    }
+
+    Partition& partition() {
+        return m_Partition;
+    }
+    const Partition& partition() const {
+        return m_Partition;
+    }
+
+    ReencryptFileSystemJob* reencryptJob() {
+        return m_ReencryptJob;
+    }
+
+private:
+    Device& m_TargetDevice;
+    Partition& m_Partition;
+    FS::luks::FormatOptions m_FormatOptions;
+    QString m_OldCipherName;
+    QString m_OldCipherMode;
+    qint64 m_OldKeySize;
+    ReencryptFileSystemJob* m_ReencryptJob;
+};
+
+#endif
@@ -32,6 +32,8 @@ private:
     DummyBackend(QObject* parent, const QList<QVariant>& args);
 
 public:
+    using CoreBackend::scanDevice;
+
     void initFSSupport() override;
 
     QList<Device*> scanDevices(bool excludeReadOnly = false) override;
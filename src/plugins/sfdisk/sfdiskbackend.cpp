@@ -19,8 +19,12 @@
 #include "core/copytargetbytearray.h"
 #include "core/diskdevice.h"
 #include "core/lvmdevice.h"
+#include "core/lvmreport.h"
+#include "core/mounttable.h"
 #include "core/partitiontable.h"
 #include "core/partitionalignment.h"
+#include "core/scancache.h"
+#include "core/raid/mdinspector.h"
 #include "core/raid/softwareraid.h"
 
 #include "fs/filesystemfactory.h"
@@ -30,6 +34,8 @@
 #include "util/globallog.h"
 #include "util/externalcommand.h"
 #include "util/helpers.h"
+#include "util/sysfsblockdevice.h"
+#include "util/trace.h"
 
 #include <QDataStream>
 #include <QDebug>
@@ -37,16 +43,58 @@
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QMutex>
 #include <QRegularExpression>
+#include <QRunnable>
+#include <QSemaphore>
 #include <QStorageInfo>
 #include <QString>
 #include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
 
 #include <KLocalizedString>
 #include <KPluginFactory>
 
+#include <algorithm>
+#include <functional>
+#include <memory>
+
 K_PLUGIN_FACTORY_WITH_JSON(SfdiskBackendFactory, "pmsfdiskbackendplugin.json", registerPlugin<SfdiskBackend>();)
 
+namespace
+{
+/** Runs a single device scan in QThreadPool. */
+class ScanDeviceRunnable : public QRunnable
+{
+public:
+    explicit ScanDeviceRunnable(std::function<void()> scan) : m_Scan(std::move(scan)) {}
+
+    void run() override {
+        m_Scan();
+    }
+
+private:
+    std::function<void()> m_Scan;
+};
+
+void movePartitionsToThread(PartitionNode& node, QThread* thread)
+{
+    node.moveToThread(thread);
+    for (const auto &child : node.children())
+        movePartitionsToThread(*child, thread);
+}
+
+/** Hands a Device created in a pool thread and its partitions over to the thread that scans. */
+void moveDeviceToThread(Device& d, QThread* thread)
+{
+    d.moveToThread(thread);
+    if (d.partitionTable())
+        movePartitionsToThread(*d.partitionTable(), thread);
+}
+}
+
 SfdiskBackend::SfdiskBackend(QObject*, const QList<QVariant>&) :
     CoreBackend()
 {
@@ -66,6 +114,19 @@ QList<Device*> SfdiskBackend::scanDevices(const ScanFlags scanFlags)
     const bool includeReadOnly = scanFlags.testFlag(ScanFlag::includeReadOnly);
     const bool includeLoopback = scanFlags.testFlag(ScanFlag::includeLoopback);
 
+    TraceSpan span("scan", QStringLiteral("scanDevices"));
+
+    // All devices share one snapshot of mounted file systems, one of LVM and one of software RAID
+    const MountTable::Scope mountTableScope;
+    LvmReport::invalidate();
+    MdInspector::invalidate();
+
+    std::unique_ptr<ScanCache> scanCache;
+    if (scanFlags.testFlag(ScanFlag::useScanCache)) {
+        scanCache = std::make_unique<ScanCache>();
+        scanCache->load();
+    }
+
     QList<Device*> result;
     QStringList deviceNodes;
 
@@ -101,21 +162,83 @@ QList<Device*> SfdiskBackend::scanDevices(const ScanFlags scanFlags)
             deviceNodes << deviceNode;
         }
 
-        int totalDevices = deviceNodes.length();
+        const int totalDevices = deviceNodes.length();
+        QVector<Device*> devices(totalDevices, nullptr);
+
+        // Devices are independent of each other, so scan them concurrently.
+        // Each result is stored at the device's index, so that the order does not
+        // depend on which scan finishes first.
+        QThreadPool pool;
+        pool.setMaxThreadCount(qBound(1, totalDevices, std::max(QThread::idealThreadCount(), 4)));
+
+        QMutex mutex;
+        QSemaphore finished;
+        QVector<int> finishedDevices;
+        Device** scannedDevices = devices.data();
+        QThread* scanThread = QThread::currentThread();
+
         for (int i = 0; i < totalDevices; ++i) {
-            const QString deviceNode = deviceNodes[i];
+            pool.start(new ScanDeviceRunnable([this, scanFlags, &scanCache, &deviceNodes, scannedDevices, scanThread, &mutex, &finished, &finishedDevices, i] {
+                Device* device = nullptr;
+                if (scanCache) {
+                    TraceSpan restoreSpan("scan", QStringLiteral("restoreDevice"));
+                    restoreSpan.addArgument(QStringLiteral("device"), deviceNodes.at(i));
+                    device = scanCache->restoreDevice(deviceNodes.at(i));
+                    restoreSpan.addArgument(QStringLiteral("restored"), device != nullptr);
+                    if (device && !scanFlags.testFlag(ScanFlag::deferFileSystemDetails))
+                        device->resolveFileSystems();
+                }
+                if (device == nullptr) {
+                    device = scanDevice(deviceNodes.at(i), scanFlags);
+                    if (device && scanCache)
+                        scanCache->storeDevice(*device);
+                }
+                if (device)
+                    moveDeviceToThread(*device, scanThread);
+                scannedDevices[i] = device;
+
+                QMutexLocker locker(&mutex);
+                finishedDevices.append(i);
+                finished.release();
+            }));
+        }
 
-            emitScanProgress(deviceNode, i * 100 / totalDevices);
-            Device* device = scanDevice(deviceNode);
+        for (int scanned = 1; scanned <= totalDevices; ++scanned) {
+            finished.acquire();
+
+            mutex.lock();
+            const QString deviceNode = deviceNodes.at(finishedDevices.at(scanned - 1));
+            mutex.unlock();
+
+            emitScanProgress(deviceNode, scanned * 100 / totalDevices);
+        }
+
+        pool.waitForDone();
+
+        if (scanCache)
+            scanCache->save();
+
+        for (Device* device : qAsConst(devices)) {
             if (device != nullptr) {
                 result.append(device);
             }
         }
-        
     }
 
-    VolumeManagerDevice::scanDevices(result); // scan all types of VolumeManagerDevices
+    // Disks were already resolved by scanDevice() or restoreDevice()
+    const int scannedDisks = result.size();
+    {
+        TraceSpan volumeManagerSpan("scan", QStringLiteral("VolumeManagerDevice::scanDevices"));
+        VolumeManagerDevice::scanDevices(result); // scan all types of VolumeManagerDevices
+    }
+
+    if (!scanFlags.testFlag(ScanFlag::deferFileSystemDetails)) {
+        TraceSpan resolveSpan("scan", QStringLiteral("resolveFileSystems"));
+        for (int i = scannedDisks; i < result.size(); ++i)
+            result[i]->resolveFileSystems();
+    }
 
+    span.addArgument(QStringLiteral("devices"), result.size());
     return result;
 }
 
@@ -180,69 +303,98 @@ fixInvalidJsonFromSFDisk( QByteArray& s )
 */
 Device* SfdiskBackend::scanDevice(const QString& deviceNode)
 {
-    ExternalCommand modelCommand(QStringLiteral("lsblk"),
-                        { QStringLiteral("--nodeps"),
-                          QStringLiteral("--noheadings"),
-                          QStringLiteral("--output"), QStringLiteral("model"),
-                          deviceNode });
-    ExternalCommand sizeCommand(QStringLiteral("blockdev"), { QStringLiteral("--getsize64"), deviceNode });
-    ExternalCommand sizeCommand2(QStringLiteral("blockdev"), { QStringLiteral("--getss"), deviceNode });
-    ExternalCommand jsonCommand(QStringLiteral("sfdisk"), { QStringLiteral("--json"), deviceNode }, QProcess::ProcessChannelMode::SeparateChannels );
+    return scanDevice(deviceNode, ScanFlags());
+}
 
-    if ( sizeCommand.run(-1) && sizeCommand.exitCode() == 0
-         && sizeCommand2.run(-1) && sizeCommand2.exitCode() == 0
-         && jsonCommand.run(-1) )
-    {
-        Device* d = nullptr;
-        qint64 deviceSize = sizeCommand.output().trimmed().toLongLong();
-        int logicalSectorSize = sizeCommand2.output().trimmed().toLongLong();
+/** Create a Device for the given device_node and scan it for partitions.
+    @param deviceNode the device node (e.g. "/dev/sda")
+    @param scanFlags with ScanFlag::deferFileSystemDetails used capacity, labels and UUIDs
+           of file systems are only read when they are first accessed
+    @return the created Device object. callers need to free this.
+*/
+Device* SfdiskBackend::scanDevice(const QString& deviceNode, const ScanFlags scanFlags)
+{
+    TraceSpan span("scan", QStringLiteral("scanDevice"));
+    span.addArgument(QStringLiteral("device"), deviceNode);
 
-        QFile mdstat(QStringLiteral("/proc/mdstat"));
+    const MountTable::Scope mountTableScope;
 
-        if (mdstat.open(QIODevice::ReadOnly)) {
-            QTextStream stream(&mdstat);
+    // Everything but the partition table can be read directly from sysfs
+    // without going through the helper. Fall back to lsblk and blockdev
+    // if the device has no /sys/block entry.
+    const SysfsBlockDevice sysfsDevice(deviceNode);
+    qint64 deviceSize = sysfsDevice.size();
+    int logicalSectorSize = sysfsDevice.logicalSectorSize();
 
-            QString content = stream.readAll();
+    bool sizeFound = deviceSize >= 0 && logicalSectorSize > 0;
+    if (!sizeFound) {
+        ExternalCommand sizeCommand(QStringLiteral("blockdev"), { QStringLiteral("--getsize64"), deviceNode });
+        ExternalCommand sizeCommand2(QStringLiteral("blockdev"), { QStringLiteral("--getss"), deviceNode });
 
-            mdstat.close();
+        if ( sizeCommand.run(-1) && sizeCommand.exitCode() == 0
+             && sizeCommand2.run(-1) && sizeCommand2.exitCode() == 0 )
+        {
+            deviceSize = sizeCommand.output().trimmed().toLongLong();
+            logicalSectorSize = sizeCommand2.output().trimmed().toLongLong();
+            sizeFound = logicalSectorSize > 0;
+        }
+    }
 
-            QRegularExpression re(QStringLiteral("md([\\/\\w]+)\\s+:"));
-            QRegularExpressionMatchIterator i  = re.globalMatch(content);
+    ExternalCommand jsonCommand(QStringLiteral("sfdisk"), { QStringLiteral("--json"), deviceNode }, QProcess::ProcessChannelMode::SeparateChannels );
 
-            while (i.hasNext()) {
-                QRegularExpressionMatch reMatch = i.next();
-                QString name = reMatch.captured(1);
+    if ( sizeFound && jsonCommand.run(-1) )
+    {
+        Device* d = nullptr;
 
-                if ((QStringLiteral("/dev/md") + name) == deviceNode) {
-                    Log(Log::Level::information) << xi18nc("@info:status", "Software RAID Device found: %1", deviceNode);
-                    d = new SoftwareRAID( QStringLiteral("md") + name, SoftwareRAID::Status::Active );
-                    break;
-                }
-            }
+        const auto mdInspector = MdInspector::current();
+        const MdArray* array = mdInspector->array(deviceNode);
+        if (array && array->deviceNode == deviceNode) {
+            Log(Log::Level::information) << xi18nc("@info:status", "Software RAID Device found: %1", deviceNode);
+            d = new SoftwareRAID(array->name, *array, SoftwareRAID::Status::Active);
         }
 
-        if ( d == nullptr && modelCommand.run(-1) && modelCommand.exitCode() == 0 )
+        if ( d == nullptr )
         {
-            QString name = modelCommand.output();
-            name = name.left(name.length() - 1).replace(QLatin1Char('_'), QLatin1Char(' '));
-
-            if (name.trimmed().isEmpty()) {
-                // Get 'lsblk --output kname' in the cases where the model name is not available.
-                // As lsblk doesn't have an option to include a separator in its output, it is
-                // necessary to run it again getting only the kname as output.
-                ExternalCommand kname(QStringLiteral("lsblk"), {QStringLiteral("--nodeps"), QStringLiteral("--noheadings"), QStringLiteral("--output"), QStringLiteral("kname"),
-                                                                deviceNode});
-
-                if (kname.run(-1) && kname.exitCode() == 0)
-                    name = kname.output().trimmed();
+            QString name;
+            QString tran;
+            if (sysfsDevice.isValid()) {
+                name = sysfsDevice.model();
+                name.replace(QLatin1Char('_'), QLatin1Char(' '));
+                if (name.trimmed().isEmpty())
+                    name = sysfsDevice.kernelName();
+                tran = sysfsDevice.transport();
+            }
+            else {
+                ExternalCommand modelCommand(QStringLiteral("lsblk"),
+                                    { QStringLiteral("--nodeps"),
+                                      QStringLiteral("--noheadings"),
+                                      QStringLiteral("--output"), QStringLiteral("model"),
+                                      deviceNode });
+                if (modelCommand.run(-1) && modelCommand.exitCode() == 0) {
+                    name = modelCommand.output();
+                    name = name.left(name.length() - 1).replace(QLatin1Char('_'), QLatin1Char(' '));
+                }
+
+                if (name.trimmed().isEmpty()) {
+                    // Get 'lsblk --output kname' in the cases where the model name is not available.
+                    // As lsblk doesn't have an option to include a separator in its output, it is
+                    // necessary to run it again getting only the kname as output.
+                    ExternalCommand kname(QStringLiteral("lsblk"), {QStringLiteral("--nodeps"), QStringLiteral("--noheadings"), QStringLiteral("--output"), QStringLiteral("kname"),
+                                                                    deviceNode});
+
+                    if (kname.run(-1) && kname.exitCode() == 0)
+                        name = kname.output().trimmed();
+                }
+
+                ExternalCommand transport(QStringLiteral("lsblk"), {QStringLiteral("--nodeps"), QStringLiteral("--noheadings"), QStringLiteral("--output"), QStringLiteral("tran"),
+                                                                    deviceNode});
+                if (transport.run(-1) && transport.exitCode() == 0)
+                    tran = transport.output().trimmed();
             }
 
-            ExternalCommand transport(QStringLiteral("lsblk"), {QStringLiteral("--nodeps"), QStringLiteral("--noheadings"), QStringLiteral("--output"), QStringLiteral("tran"),
-                                                                deviceNode});
             QString icon;
-            if (transport.run(-1) && transport.exitCode() == 0)
-                if (transport.output().trimmed() == QStringLiteral("usb"))
-                    icon = QStringLiteral("drive-removable-media-usb");
+            if (tran == QStringLiteral("usb"))
+                icon = QStringLiteral("drive-removable-media-usb");
 
             Log(Log::Level::information) << xi18nc("@info:status", "Device found: %1", name);
 
@@ -263,6 +415,9 @@ Device* SfdiskBackend::scanDevice(const QString& deviceNode)
             if (!updateDevicePartitionTable(*d, partitionTable))
                 return nullptr;
 
+            if (!scanFlags.testFlag(ScanFlag::deferFileSystemDetails))
+                d->resolveFileSystems();
+
             return d;
         }
     }
@@ -349,11 +504,12 @@ void SfdiskBackend::scanDevicePartitions(Device& d, const QJsonArray& jsonPartit
 
         setupPartitionInfo(d, part, partitionObject, mountPoint);
 
+        // Label and UUID are only read when first needed, see ScanFlag::deferFileSystemDetails
         if (fs->supportGetLabel() != FileSystem::cmdSupportNone)
-            fs->setLabel(fs->readLabel(part->deviceNode()));
+            fs->setLabelReader([fs, partitionNode] { return fs->readLabel(partitionNode); });
 
         if (fs->supportGetUUID() != FileSystem::cmdSupportNone)
-            fs->setUUID(fs->readUUID(part->deviceNode()));
+            fs->setUUIDReader([fs, partitionNode] { return fs->readUUID(partitionNode); });
 
         parent->append(part);
         partitions.append(part);
@@ -442,6 +598,9 @@ bool SfdiskBackend::updateDevicePartitionTable(Device &d, const QJsonObject &jso
 }
 
 /** Reads the sectors used in a FileSystem and stores the result in the Partition's FileSystem object.
+
+    Unmounted file systems are only read when their used sectors are first accessed.
+
     @param p the Partition the FileSystem is on
     @param mountPoint mount point of the partition in question
 */
@@ -452,8 +611,15 @@ void SfdiskBackend::readSectorsUsed(const Device& d, Partition& p, const QString
         if (p.isMounted() && storage.isValid())
             p.fileSystem().setSectorsUsed( (storage.bytesTotal() - storage.bytesFree()) / d.logicalSize());
     }
-    else if (p.fileSystem().supportGetUsed() == FileSystem::cmdSupportFileSystem)
-        p.fileSystem().setSectorsUsed(p.fileSystem().readUsedCapacity(p.deviceNode()) / d.logicalSize());
+    else if (p.fileSystem().supportGetUsed() != FileSystem::cmdSupportNone) {
+        FileSystem* fs = &p.fileSystem();
+        const QString deviceNode = p.deviceNode();
+        const qint64 logicalSize = d.logicalSize();
+        fs->setSectorsUsedReader([fs, deviceNode, logicalSize] {
+            const qint64 used = fs->readUsedCapacity(deviceNode);
+            return used < 0 ? -1 : used / logicalSize;
+        });
+    }
 }
 
 FileSystem::Type SfdiskBackend::detectFileSystem(const QString& partitionPath)
@@ -42,6 +42,7 @@ public:
     std::unique_ptr<CoreBackendDevice> openDeviceExclusive(const Device& d) override;
     bool closeDevice(std::unique_ptr<CoreBackendDevice> coreDevice) override;
     Device* scanDevice(const QString& deviceNode) override;
+    Device* scanDevice(const QString& deviceNode, const ScanFlags scanFlags) override;
     FileSystem::Type detectFileSystem(const QString& partitionPath) override;
     QString readLabel(const QString& deviceNode) const override;
     QString readUUID(const QString& deviceNode) const override;
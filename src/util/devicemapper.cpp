@@ -0,0 +1,219 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "util/devicemapper.h"
+#include "util/sysfsblockdevice.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/dm-ioctl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+struct DeviceMapperPrivate
+{
+    QVector<DeviceMapper::Mapping> m_Mappings;
+};
+
+static QString readFile(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return QString();
+
+    return QString::fromLocal8Bit(file.readAll()).trimmed();
+}
+
+/** @return /dev/mapper node of the mapping */
+QString DeviceMapper::Mapping::deviceNode() const
+{
+    return QStringLiteral("/dev/mapper/") + name;
+}
+
+/** @return the subsystem that created the mapping, taken from the UUID prefix (e.g. "CRYPT" or "LVM") */
+QString DeviceMapper::Mapping::subsystem() const
+{
+    return uuid.section(QLatin1Char('-'), 0, 0);
+}
+
+/** Reads all device-mapper devices from sysfs. */
+DeviceMapper::DeviceMapper() :
+    d(std::make_unique<DeviceMapperPrivate>())
+{
+    const QDir sysBlock(QStringLiteral("/sys/block"));
+    const QStringList kernelNames = sysBlock.entryList({ QStringLiteral("dm-*") }, QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const auto &kernelName : kernelNames) {
+        const QString path = sysBlock.filePath(kernelName);
+
+        Mapping mapping;
+        mapping.kernelName = kernelName;
+        mapping.name = readFile(path + QStringLiteral("/dm/name"));
+        mapping.uuid = readFile(path + QStringLiteral("/dm/uuid"));
+
+        bool ok = false;
+        const qint64 sectors = readFile(path + QStringLiteral("/size")).toLongLong(&ok);
+        if (ok)
+            mapping.size = sectors * 512;
+
+        mapping.slaves = QDir(path + QStringLiteral("/slaves")).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+
+        if (!mapping.name.isEmpty())
+            d->m_Mappings.append(mapping);
+    }
+}
+
+DeviceMapper::~DeviceMapper()
+{
+}
+
+const QVector<DeviceMapper::Mapping>& DeviceMapper::mappings() const
+{
+    return d->m_Mappings;
+}
+
+/** @param deviceNode /dev/mapper/<name>, /dev/dm-<n> or any other link to a mapping
+    @return the mapping or nullptr if the device is not a device-mapper device
+*/
+const DeviceMapper::Mapping* DeviceMapper::mapping(const QString& deviceNode) const
+{
+    const QString kernelName = SysfsBlockDevice::kernelName(deviceNode);
+    const QString name = deviceNode.startsWith(QStringLiteral("/dev/mapper/")) ? deviceNode.mid(12) : QString();
+    for (const auto &mapping : d->m_Mappings)
+        if (mapping.kernelName == kernelName || mapping.name == name)
+            return &mapping;
+
+    return nullptr;
+}
+
+/** @return mappings that use the device, e.g. an open LUKS container or LVs on a physical volume */
+QVector<const DeviceMapper::Mapping*> DeviceMapper::holders(const QString& deviceNode) const
+{
+    QVector<const Mapping*> result;
+    const QString kernelName = SysfsBlockDevice::kernelName(deviceNode);
+    if (kernelName.isEmpty())
+        return result;
+
+    for (const auto &mapping : d->m_Mappings)
+        if (mapping.slaves.contains(kernelName))
+            result.append(&mapping);
+
+    return result;
+}
+
+/** @return the dm-crypt mapping that is open on the device or nullptr if it is not open */
+const DeviceMapper::Mapping* DeviceMapper::cryptMapping(const QString& deviceNode) const
+{
+    for (const auto &mapping : holders(deviceNode))
+        if (mapping->subsystem() == QStringLiteral("CRYPT"))
+            return mapping;
+
+    return nullptr;
+}
+
+/** @param kernelName kernel name as found in /sys/block (e.g. "dm-2" or "sda1")
+    @return /dev/mapper node for device-mapper devices, /dev/<kernel name> otherwise
+*/
+QString DeviceMapper::deviceNode(const QString& kernelName) const
+{
+    for (const auto &mapping : d->m_Mappings)
+        if (mapping.kernelName == kernelName)
+            return mapping.deviceNode();
+
+    return QStringLiteral("/dev/") + QString(kernelName).replace(QLatin1Char('!'), QLatin1Char('/'));
+}
+
+/** Reads the table of a mapping with the DM_TABLE_STATUS ioctl.
+    @param name name of the mapping
+    @param ok set to false if /dev/mapper/control could not be opened (usually no root) or the ioctl failed
+    @return the targets of the mapping's live table
+*/
+QVector<DeviceMapper::Target> DeviceMapper::table(const QString& name, bool* ok)
+{
+    QVector<Target> targets;
+    if (ok)
+        *ok = false;
+
+    const QByteArray dmName = name.toLocal8Bit();
+    if (dmName.isEmpty() || dmName.size() >= DM_NAME_LEN)
+        return targets;
+
+    const int fd = open("/dev/mapper/control", O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+        return targets;
+
+    std::vector<char> buffer(16 * 1024);
+    dm_ioctl* io = nullptr;
+    bool success = false;
+    while (true) {
+        std::fill(buffer.begin(), buffer.end(), 0);
+        io = reinterpret_cast<dm_ioctl*>(buffer.data());
+        io->version[0] = DM_VERSION_MAJOR;
+        io->data_size = buffer.size();
+        io->data_start = sizeof(dm_ioctl);
+        io->flags = DM_STATUS_TABLE_FLAG | DM_SECURE_DATA_FLAG;
+        std::strncpy(io->name, dmName.constData(), DM_NAME_LEN - 1);
+
+        success = ioctl(fd, DM_TABLE_STATUS, io) == 0;
+        if (!success || !(io->flags & DM_BUFFER_FULL_FLAG) || buffer.size() >= 1024 * 1024)
+            break;
+        buffer.resize(buffer.size() * 4);
+    }
+    close(fd);
+
+    if (success && !(io->flags & DM_BUFFER_FULL_FLAG)) {
+        size_t offset = io->data_start;
+        for (quint32 i = 0; i < io->target_count && offset + sizeof(dm_target_spec) <= io->data_size; ++i) {
+            const dm_target_spec* spec = reinterpret_cast<const dm_target_spec*>(buffer.data() + offset);
+            Target target;
+            target.start = spec->sector_start;
+            target.length = spec->length;
+            target.type = QString::fromLatin1(spec->target_type, qstrnlen(spec->target_type, DM_MAX_TYPE_NAME));
+
+            char* parameters = buffer.data() + offset + sizeof(dm_target_spec);
+            const size_t available = buffer.size() > offset + sizeof(dm_target_spec) ? buffer.size() - offset - sizeof(dm_target_spec) : 0;
+            const size_t length = qstrnlen(parameters, available);
+
+            // Keep key descriptors (":<size>:<type>:<description>") but never the volume key itself.
+            // The key is wiped in the ioctl buffer, before any copy of it is made.
+            if (target.type == QStringLiteral("crypt")) {
+                char* end = parameters + length;
+                char* key = std::find(parameters, end, ' ');
+                if (key != end)
+                    ++key;
+                char* keyEnd = std::find(key, end, ' ');
+                if (key != keyEnd && *key != ':') {
+                    std::fill(key, keyEnd, '\0');
+                    target.parameters = QString::fromLatin1(parameters, key - parameters) + QStringLiteral("-")
+                                      + QString::fromLatin1(keyEnd, end - keyEnd);
+                }
+                else
+                    target.parameters = QString::fromLatin1(parameters, length);
+            }
+            else
+                target.parameters = QString::fromLatin1(parameters, length);
+
+            targets.append(target);
+
+            // For DM_TABLE_STATUS next is relative to the first target, not to the current one
+            if (spec->next == 0)
+                break;
+            offset = io->data_start + spec->next;
+        }
+
+        if (ok)
+            *ok = true;
+    }
+
+    // The table may contain volume keys
+    std::fill(buffer.begin(), buffer.end(), 0);
+    return targets;
+}
@@ -0,0 +1,72 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_DEVICEMAPPER_H
+#define KPMCORE_DEVICEMAPPER_H
+
+#include "util/libpartitionmanagerexport.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QtGlobal>
+
+#include <memory>
+
+struct DeviceMapperPrivate;
+
+/** Snapshot of the device-mapper devices (LVM logical volumes, LUKS containers, ...).
+
+    The list of mappings, their names, UUIDs, sizes and the devices they
+    map to are read from /sys/block/dm-*, which does not need root and
+    does not spawn lvm, cryptsetup or lsblk. Tables can be read with the
+    DM_TABLE_STATUS ioctl, which needs access to /dev/mapper/control.
+
+    @author Andrius Štikonas <andrius@stikonas.eu>
+*/
+class LIBKPMCORE_EXPORT DeviceMapper
+{
+    Q_DISABLE_COPY(DeviceMapper)
+
+public:
+    struct Mapping
+    {
+        QString kernelName; /**< e.g. "dm-0" */
+        QString name;       /**< name in /dev/mapper */
+        QString uuid;       /**< e.g. "CRYPT-LUKS2-<uuid>-<name>" or "LVM-<vg uuid><lv uuid>" */
+        qint64 size = -1;   /**< size in bytes */
+        QStringList slaves; /**< kernel names of the devices this mapping uses */
+
+        QString deviceNode() const;
+        QString subsystem() const;
+    };
+
+    struct Target
+    {
+        qint64 start = 0;  /**< first sector (512 bytes) */
+        qint64 length = 0; /**< number of sectors (512 bytes) */
+        QString type;      /**< e.g. "linear", "crypt" */
+        QString parameters; /**< target parameters, volume keys are replaced by "-" */
+    };
+
+    DeviceMapper();
+    ~DeviceMapper();
+
+public:
+    const QVector<Mapping>& mappings() const;
+    const Mapping* mapping(const QString& deviceNode) const;
+    QVector<const Mapping*> holders(const QString& deviceNode) const;
+    const Mapping* cryptMapping(const QString& deviceNode) const;
+
+    QString deviceNode(const QString& kernelName) const;
+
+    static QVector<Target> table(const QString& name, bool* ok = nullptr);
+
+private:
+    std::unique_ptr<DeviceMapperPrivate> d;
+};
+
+#endif
@@ -21,14 +21,18 @@
 #include "core/copytargetdevice.h"
 #include "util/globallog.h"
 #include "util/report.h"
+#include "util/trace.h"
 
 #include "externalcommandhelper_interface.h"
 
 #include <QCryptographicHash>
+#include <QDataStream>
 #include <QDBusConnection>
 #include <QDBusInterface>
 #include <QDBusReply>
 #include <QEventLoop>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QtGlobal>
 #include <QStandardPaths>
 #include <QString>
@@ -54,7 +58,7 @@ struct ExternalCommandPrivate
 };
 
 KAuth::ExecuteJob* ExternalCommand::m_job;
-bool ExternalCommand::helperStarted = false;
+std::atomic<bool> ExternalCommand::helperStarted(false);
 QWidget* ExternalCommand::parent;
 
 
@@ -71,9 +75,13 @@ ExternalCommand::ExternalCommand(const QString& cmd, const QStringList& args, co
     d->m_ExitCode = -1;
     d->m_Output = QByteArray();
 
-    if (!helperStarted)
-        if(!startHelper())
+    if (!helperStarted) {
+        // Commands can be created by several threads at once, e.g. while probing file system tools
+        static QMutex helperMutex;
+        QMutexLocker locker(&helperMutex);
+        if (!helperStarted && !startHelper())
             Log(Log::Level::error) << xi18nc("@info:status", "Could not obtain administrator privileges.");
+    }
 
     d->processChannelMode = processChannelMode;
 }
@@ -135,6 +143,10 @@ bool ExternalCommand::start(int timeout)
 
     bool rval = false;
 
+    TraceSpan span("command", command());
+    span.addArgument(QStringLiteral("args"), args().join(QStringLiteral(" ")));
+    qint64 runtime = 0;
+
     QDBusPendingCall pcall = interface->start(cmd, args(), d->m_Input, d->processChannelMode);
 
     QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(pcall, this);
@@ -151,28 +163,61 @@ bool ExternalCommand::start(int timeout)
             d->m_Output = reply.value()[QStringLiteral("output")].toByteArray();
             setExitCode(reply.value()[QStringLiteral("exitCode")].toInt());
             rval = reply.value()[QStringLiteral("success")].toBool();
+            runtime = reply.value()[QStringLiteral("runtime")].toLongLong();
         }
     };
 
     connect(watcher, &QDBusPendingCallWatcher::finished, exitLoop);
     loop.exec();
 
+    // everything that is not process runtime is spent on D-Bus and in the helper
+    span.addArgument(QStringLiteral("exitCode"), exitCode());
+    span.addArgument(QStringLiteral("processNs"), runtime);
+    span.addArgument(QStringLiteral("dbusNs"), span.elapsed() - runtime);
+
     return rval;
 }
 
+/** Records spans for the blocks the helper timed while copying.
+    @param blockTimes block number, read start, read end and write end of each timed block
+*/
+static void addBlockSpans(const QByteArray& blockTimes)
+{
+    QDataStream stream(blockTimes);
+    while (!stream.atEnd()) {
+        qint64 block, readStart, readEnd, writeEnd;
+        stream >> block >> readStart >> readEnd >> writeEnd;
+        if (stream.status() != QDataStream::Ok)
+            break;
+
+        const QVariantMap args = { { QStringLiteral("block"), block } };
+        Trace::addSpan("copyblocks", QStringLiteral("read"), readStart, readEnd, args);
+        Trace::addSpan("copyblocks", QStringLiteral("write"), readEnd, writeEnd, args);
+    }
+}
+
 bool ExternalCommand::copyBlocks(const CopySource& source, CopyTarget& target)
 {
     bool rval = true;
     const qint64 blockSize = 10 * 1024 * 1024; // number of bytes per block to copy
 
-    // TODO KF6:Use new signal-slot syntax
-    connect(m_job, SIGNAL(percent(KJob*, unsigned long)), this, SLOT(emitProgress(KJob*, unsigned long)));
-    connect(m_job, &KAuth::ExecuteJob::newData, this, &ExternalCommand::emitReport);
+    // Progress of the helper job is shared by all copies, so only report it for copies to a
+    // device. Reads into a byte array are not reported, they may run in several threads at once.
+    CopyTargetByteArray *byteArrayTarget = dynamic_cast<CopyTargetByteArray*>(&target);
+    if (!byteArrayTarget) {
+        // TODO KF6:Use new signal-slot syntax
+        connect(m_job, SIGNAL(percent(KJob*, unsigned long)), this, SLOT(emitProgress(KJob*, unsigned long)));
+        connect(m_job, &KAuth::ExecuteJob::newData, this, &ExternalCommand::emitReport);
+    }
 
     auto interface = helperInterface();
     if (!interface)
         return false;
 
+    TraceSpan span("copyblocks", source.path());
+    span.addArgument(QStringLiteral("target"), target.path());
+    span.addArgument(QStringLiteral("bytes"), source.length());
+
     QDBusPendingCall pcall = interface->copyblocks(source.path(), source.firstByte(), source.length(),
                                                    target.path(), target.firstByte(), blockSize);
 
@@ -187,9 +232,13 @@ bool ExternalCommand::copyBlocks(const CopySource& source, CopyTarget& target)
             QDBusPendingReply<QVariantMap> reply = *watcher;
             rval = reply.value()[QStringLiteral("success")].toBool();
 
-            CopyTargetByteArray *byteArrayTarget = dynamic_cast<CopyTargetByteArray*>(&target);
             if (byteArrayTarget)
                 byteArrayTarget->m_Array = reply.value()[QStringLiteral("targetByteArray")].toByteArray();
+
+            span.addArgument(QStringLiteral("readNs"), reply.value()[QStringLiteral("readTime")]);
+            span.addArgument(QStringLiteral("writeNs"), reply.value()[QStringLiteral("writeTime")]);
+            if (span.isEnabled())
+                addBlockSpans(reply.value()[QStringLiteral("blockTimes")].toByteArray());
         }
         setExitCode(!rval);
     };
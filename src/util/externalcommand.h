@@ -22,6 +22,7 @@
 #include <QThread>
 #include <QVariant>
 
+#include <atomic>
 #include <memory>
 
 namespace KAuth { class ExecuteJob; }
@@ -132,7 +133,7 @@ private:
 
     // KAuth
     static KAuth::ExecuteJob *m_job;
-    static bool helperStarted;
+    static std::atomic<bool> helperStarted; // read without the lock by commands created in other threads
     static QWidget *parent;
 };
 
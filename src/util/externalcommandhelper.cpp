@@ -14,14 +14,32 @@
 
 #include <QtDBus>
 #include <QCoreApplication>
+#include <QDataStream>
 #include <QDebug>
 #include <QElapsedTimer>
 #include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QRunnable>
 #include <QString>
+#include <QThreadPool>
 #include <QVariant>
 
 #include <KLocalizedString>
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+#include <fcntl.h>
+#include <linux/blkzone.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
 /** Initialize ExternalCommandHelper Daemon and prepare DBus interface
  *
  * KAuth helper runs in the background until application exits.
@@ -164,12 +182,150 @@ bool ExternalCommandHelper::createFile(const QString &filePath, const QByteArray
     return true;
 }
 
+// number of blocks for which copyblocks reports when they were read and written
+constexpr qint64 maxTracedBlocks = 256;
+
+namespace
+{
+/** Reads data for copyblocks in a QThreadPool, see ExternalCommandHelper::copyblocks(). */
+class ReadRunnable : public QRunnable
+{
+public:
+    explicit ReadRunnable(std::function<void()> read) : m_Read(std::move(read)) {}
+
+    void run() override {
+        m_Read();
+    }
+
+private:
+    std::function<void()> m_Read;
+};
+}
+
+/** @return monotonic time in nanoseconds, on the same clock as the client's trace */
+static qint64 monotonicTime()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** @return zone size in bytes if the device is a host-managed zoned block device, 0 otherwise */
+static qint64 hostManagedZoneSize(const QString& device)
+{
+    const QString canonicalPath = QFileInfo(device).canonicalFilePath();
+    if (!canonicalPath.startsWith(QStringLiteral("/dev/")))
+        return 0;
+
+    const QString queue = QStringLiteral("/sys/class/block/") + canonicalPath.section(QLatin1Char('/'), -1) + QStringLiteral("/queue/");
+    QFile zoned(queue + QStringLiteral("zoned"));
+    if (!zoned.open(QIODevice::ReadOnly) || zoned.readAll().trimmed() != "host-managed")
+        return 0;
+
+    // chunk_sectors is the zone size in 512 byte units
+    QFile chunkSectors(queue + QStringLiteral("chunk_sectors"));
+    if (!chunkSectors.open(QIODevice::ReadOnly))
+        return 0;
+
+    return chunkSectors.readAll().trimmed().toLongLong() * 512;
+}
+
+/** Resets the write pointers of all zones in the given range, discarding their data.
+    @param device the zoned device
+    @param offset start of the first zone in bytes
+    @param length length of the range in bytes, rounded up to whole zones by the caller
+    @return true on success
+*/
+static bool resetZones(const QString& device, const qint64 offset, const qint64 length)
+{
+    const int fd = open(device.toLocal8Bit().constData(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        qCritical() << xi18n("Could not open device <filename>%1</filename> for writing.", device);
+        return false;
+    }
+
+    // The last zone may be smaller than the others
+    quint64 capacity = 0;
+    bool rval = ioctl(fd, BLKGETSIZE64, &capacity) == 0;
+    if (rval) {
+        blk_zone_range range;
+        range.sector = offset / 512;
+        range.nr_sectors = (qMin<quint64>(offset + length, capacity) - offset) / 512;
+        rval = ioctl(fd, BLKRESETZONE, &range) == 0;
+    }
+
+    if (!rval)
+        qCritical() << xi18n("Could not reset zones of device <filename>%1</filename>: %2", device, QString::fromLocal8Bit(strerror(errno)));
+
+    close(fd);
+    return rval;
+}
+
+/** Writes the data from buffer to a zoned device with direct I/O.
+    Writes to sequential zones must reach the device in order, which the page cache does not guarantee.
+    @param targetDevice device to write to
+    @param buffer the data that we write, a multiple of the logical sector size
+    @param offset offset where to begin writing, the write pointer of the zone
+    @return true on success
+*/
+static bool writeDirect(const QString& targetDevice, const QByteArray& buffer, const qint64 offset)
+{
+    const int fd = open(targetDevice.toLocal8Bit().constData(), O_WRONLY | O_DIRECT | O_CLOEXEC);
+    if (fd < 0) {
+        qCritical() << xi18n("Could not open device <filename>%1</filename> for writing.", targetDevice);
+        return false;
+    }
+
+    void* alignedBuffer = nullptr;
+    if (posix_memalign(&alignedBuffer, 4096, buffer.size()) != 0) {
+        close(fd);
+        return false;
+    }
+    std::memcpy(alignedBuffer, buffer.constData(), buffer.size());
+
+    qint64 written = 0;
+    while (written < buffer.size()) {
+        const ssize_t n = pwrite(fd, static_cast<char*>(alignedBuffer) + written, buffer.size() - written, offset + written);
+        if (n <= 0)
+            break;
+        written += n;
+    }
+
+    std::free(alignedBuffer);
+    close(fd);
+
+    if (written != buffer.size()) {
+        qCritical() << xi18n("Could not write to device <filename>%1</filename>.", targetDevice);
+        return false;
+    }
+
+    return true;
+}
+
 // If targetDevice is empty then return QByteArray with data that was read from disk.
 QVariantMap ExternalCommandHelper::copyblocks(const QString& sourceDevice, const qint64 sourceFirstByte, const qint64 sourceLength, const QString& targetDevice, const qint64 targetFirstByte, const qint64 blockSize)
 {
     QVariantMap reply;
     reply[QStringLiteral("success")] = true;
 
+    // Reads into a byte array (e.g. superblocks while devices are scanned in several client
+    // threads) report no progress, so read them in one go on a thread of their own and keep
+    // serving other requests in the meantime.
+    if (targetDevice.isEmpty()) {
+        setDelayedReply(true);
+        const QDBusMessage request = message();
+        QThreadPool::globalInstance()->start(new ReadRunnable([this, request, reply, sourceDevice, sourceFirstByte, sourceLength] () mutable {
+            QByteArray buffer;
+            const qint64 readStart = monotonicTime();
+            const bool rval = readData(sourceDevice, buffer, sourceFirstByte, sourceLength);
+            reply[QStringLiteral("success")] = rval;
+            reply[QStringLiteral("readTime")] = monotonicTime() - readStart;
+            if (rval)
+                reply[QStringLiteral("targetByteArray")] = buffer;
+            QDBusConnection::systemBus().send(request.createReply(reply));
+        }));
+
+        return QVariantMap();
+    }
+
     const qint64 blocksToCopy = sourceLength / blockSize;
     qint64 readOffset = sourceFirstByte;
     qint64 writeOffset = targetFirstByte;
@@ -181,6 +337,33 @@ QVariantMap ExternalCommandHelper::copyblocks(const QString& sourceDevice, const
         copyDirection = -1;
     }
 
+    // Sequential zones of host-managed devices can only be written at their write pointer,
+    // so reset the zones we copy to and always copy front to back
+    const qint64 zoneSize = targetDevice.isEmpty() ? 0 : hostManagedZoneSize(targetDevice);
+    if (zoneSize > 0) {
+        const bool sameDevice = QFileInfo(sourceDevice).canonicalFilePath() == QFileInfo(targetDevice).canonicalFilePath();
+        if (sameDevice && sourceFirstByte < targetFirstByte + sourceLength && targetFirstByte < sourceFirstByte + sourceLength) {
+            qCritical() << xi18n("Cannot copy between overlapping ranges of zoned device <filename>%1</filename>.", targetDevice);
+            reply[QStringLiteral("success")] = false;
+            return reply;
+        }
+
+        if (targetFirstByte % zoneSize != 0) {
+            qCritical() << xi18n("Cannot write to zoned device <filename>%1</filename> at %2, it is not the start of a zone.", targetDevice, targetFirstByte);
+            reply[QStringLiteral("success")] = false;
+            return reply;
+        }
+
+        if (!resetZones(targetDevice, targetFirstByte, (sourceLength + zoneSize - 1) / zoneSize * zoneSize)) {
+            reply[QStringLiteral("success")] = false;
+            return reply;
+        }
+
+        readOffset = sourceFirstByte;
+        writeOffset = targetFirstByte;
+        copyDirection = 1;
+    }
+
     const qint64 lastBlock = sourceLength % blockSize;
 
     qint64 bytesWritten = 0;
@@ -202,13 +385,34 @@ QVariantMap ExternalCommandHelper::copyblocks(const QString& sourceDevice, const
 
     bool rval = true;
 
+    // time spent in reads and writes, reported back for tracing, and when
+    // each of a sample of about maxTracedBlocks blocks was read and written
+    qint64 readTime = 0;
+    qint64 writeTime = 0;
+    const qint64 traceStep = std::max((blocksToCopy + maxTracedBlocks - 1) / maxTracedBlocks, qint64(1));
+    QByteArray blockTimes;
+    QDataStream blockTimesStream(&blockTimes, QIODevice::WriteOnly);
+
     while (blocksCopied < blocksToCopy && !targetDevice.isEmpty()) {
-        if (!(rval = readData(sourceDevice, buffer, readOffset + blockSize * blocksCopied * copyDirection, blockSize)))
+        const qint64 readStart = monotonicTime();
+        rval = readData(sourceDevice, buffer, readOffset + blockSize * blocksCopied * copyDirection, blockSize);
+        const qint64 readEnd = monotonicTime();
+        readTime += readEnd - readStart;
+        if (!rval)
             break;
 
-        if (!(rval = writeData(targetDevice, buffer, writeOffset + blockSize * blocksCopied * copyDirection)))
+        if (zoneSize > 0)
+            rval = writeDirect(targetDevice, buffer, writeOffset + blockSize * blocksCopied);
+        else
+            rval = writeData(targetDevice, buffer, writeOffset + blockSize * blocksCopied * copyDirection);
+        const qint64 writeEnd = monotonicTime();
+        writeTime += writeEnd - readEnd;
+        if (!rval)
             break;
 
+        if (blocksCopied % traceStep == 0)
+            blockTimesStream << blocksCopied << readStart << readEnd << writeEnd;
+
         bytesWritten += buffer.size();
 
         if (++blocksCopied * 100 / blocksToCopy != percent) {
@@ -232,13 +436,21 @@ QVariantMap ExternalCommandHelper::copyblocks(const QString& sourceDevice, const
         const qint64 lastBlockWriteOffset = copyDirection > 0 ? writeOffset + blockSize * blocksCopied : targetFirstByte;
         report[QStringLiteral("report")]= xi18nc("@info:progress", "Copying remainder of block size %1 from %2 to %3.", lastBlock, lastBlockReadOffset, lastBlockWriteOffset);
         HelperSupport::progressStep(report);
+        const qint64 readStart = monotonicTime();
         rval = readData(sourceDevice, buffer, lastBlockReadOffset, lastBlock);
+        const qint64 readEnd = monotonicTime();
+        readTime += readEnd - readStart;
 
         if (rval) {
             if (targetDevice.isEmpty())
                 reply[QStringLiteral("targetByteArray")] = buffer;
-            else
-                rval = writeData(targetDevice, buffer, lastBlockWriteOffset);
+            else {
+                rval = zoneSize > 0 ? writeDirect(targetDevice, buffer, lastBlockWriteOffset) : writeData(targetDevice, buffer, lastBlockWriteOffset);
+                const qint64 writeEnd = monotonicTime();
+                writeTime += writeEnd - readEnd;
+                if (rval)
+                    blockTimesStream << blocksCopied << readStart << readEnd << writeEnd;
+            }
         }
 
         if (rval) {
@@ -251,13 +463,18 @@ QVariantMap ExternalCommandHelper::copyblocks(const QString& sourceDevice, const
     HelperSupport::progressStep(report);
 
     reply[QStringLiteral("success")] = rval;
+    reply[QStringLiteral("readTime")] = readTime;
+    reply[QStringLiteral("writeTime")] = writeTime;
+    reply[QStringLiteral("blockTimes")] = blockTimes;
     return reply;
 }
 
 bool ExternalCommandHelper::writeData(const QByteArray& buffer, const QString& targetDevice, const qint64 targetFirstByte)
 {
-    // Do not allow using this helper for writing to arbitrary location
-    if ( targetDevice.left(5) != QStringLiteral("/dev/") )
+    // Do not allow using this helper for writing to arbitrary location, only to devices
+    // and to the resync speed limits of software RAID arrays
+    static const QRegularExpression speedLimit(QStringLiteral("^/sys/block/md\\d+/md/sync_speed_(min|max)$"));
+    if ( targetDevice.left(5) != QStringLiteral("/dev/") && !speedLimit.match(targetDevice).hasMatch() )
         return false;
 
     return writeData(targetDevice, buffer, targetFirstByte);
@@ -294,17 +511,35 @@ QVariantMap ExternalCommandHelper::start(const QString& command, const QStringLi
 
 //  connect(&cmd, &QProcess::readyReadStandardOutput, this, &ExternalCommandHelper::onReadOutput);
 
-    m_cmd.setEnvironment( { QStringLiteral("LVM_SUPPRESS_FD_WARNINGS=1") } );
-    m_cmd.setProcessChannelMode(static_cast<QProcess::ProcessChannelMode>(processChannelMode));
-    m_cmd.start(command, arguments);
-    m_cmd.write(input);
-    m_cmd.closeWriteChannel();
-    m_cmd.waitForFinished(-1);
-    QByteArray output = m_cmd.readAllStandardOutput();
-    reply[QStringLiteral("output")] = output;
-    reply[QStringLiteral("exitCode")] = m_cmd.exitCode();
+    // Reply asynchronously, so that commands requested by several client
+    // threads (e.g. while scanning devices in parallel) can run at the same time.
+    auto cmd = new QProcess(this);
+    cmd->setEnvironment( { QStringLiteral("LVM_SUPPRESS_FD_WARNINGS=1") } );
+    cmd->setProcessChannelMode(static_cast<QProcess::ProcessChannelMode>(processChannelMode));
+
+    setDelayedReply(true);
+    const QDBusMessage request = message();
+    QElapsedTimer runtime; // process runtime in nanoseconds, reported back for tracing
+    runtime.start();
+    auto sendReply = [cmd, reply, request, runtime] () mutable {
+        reply[QStringLiteral("output")] = cmd->readAllStandardOutput();
+        reply[QStringLiteral("exitCode")] = cmd->exitCode();
+        reply[QStringLiteral("runtime")] = runtime.nsecsElapsed();
+        QDBusConnection::systemBus().send(request.createReply(reply));
+        cmd->deleteLater();
+    };
+
+    connect(cmd, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this, sendReply);
+    connect(cmd, &QProcess::errorOccurred, this, [sendReply] (QProcess::ProcessError error) mutable {
+        if (error == QProcess::FailedToStart)
+            sendReply();
+    });
+
+    cmd->start(command, arguments);
+    cmd->write(input);
+    cmd->closeWriteChannel();
 
-    return reply;
+    return QVariantMap();
 }
 
 void ExternalCommandHelper::exit()
@@ -15,13 +15,14 @@
 
 #include <KAuth>
 
+#include <QDBusContext>
 #include <QEventLoop>
 #include <QString>
 #include <QProcess>
 
 using namespace KAuth;
 
-class ExternalCommandHelper : public QObject
+class ExternalCommandHelper : public QObject, protected QDBusContext
 {
     Q_OBJECT
     Q_CLASSINFO("D-Bus Interface", "org.kde.kpmcore.externalcommand")
@@ -47,7 +48,6 @@ private:
     void onReadOutput();
 
     std::unique_ptr<QEventLoop> m_loop;
-    QProcess m_cmd;
 //  QByteArray output;
 };
 
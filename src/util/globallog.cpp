@@ -8,16 +8,22 @@
 
 #include "util/globallog.h"
 
+// Messages are composed piece by piece, so keep a separate buffer for each
+// thread (devices might be scanned from several threads at once).
+static thread_local QString msg;
+
 GlobalLog* GlobalLog::instance()
 {
-    static GlobalLog* p = nullptr;
-
-    if (p == nullptr)
-        p = new GlobalLog();
+    static GlobalLog* p = new GlobalLog();
 
     return p;
 }
 
+void GlobalLog::append(const QString& s)
+{
+    msg += s;
+}
+
 void GlobalLog::flush(Log::Level lev)
 {
     Q_EMIT newMessage(lev, msg);
@@ -48,7 +48,7 @@ class LIBKPMCORE_EXPORT GlobalLog : public QObject
     friend Log operator<<(Log l, qint64 i);
 
 private:
-    GlobalLog() : msg() {}
+    GlobalLog() {}
 
 Q_SIGNALS:
     void newMessage(Log::Level, const QString&);
@@ -57,13 +57,8 @@ public:
     static GlobalLog* instance();
 
 private:
-    void append(const QString& s) {
-        msg += s;
-    }
+    void append(const QString& s);
     void flush(Log::Level level);
-
-private:
-    QString msg;
 };
 
 inline Log operator<<(Log l, const QString& s)
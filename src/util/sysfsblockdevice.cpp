@@ -0,0 +1,175 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "util/sysfsblockdevice.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QLatin1String>
+
+struct SysfsBlockDevicePrivate
+{
+    QString m_DeviceNode;
+    QString m_KernelName;
+    QString m_Path;
+    bool m_Valid;
+    qint64 m_Size;
+    qint64 m_LogicalSectorSize;
+    qint64 m_PhysicalSectorSize;
+    QString m_Model;
+    QString m_Transport;
+};
+
+/** Guess transport from the resolved /sys/devices path of the block device.
+    Uses the same names as lsblk's TRAN column.
+*/
+static QString transportFromPath(const QString& devicePath)
+{
+    if (devicePath.contains(QLatin1String("/usb")))
+        return QStringLiteral("usb");
+    if (devicePath.contains(QLatin1String("/nvme")))
+        return QStringLiteral("nvme");
+    if (devicePath.contains(QLatin1String("/mmc_host/")))
+        return QStringLiteral("mmc");
+    if (devicePath.contains(QLatin1String("/virtio")))
+        return QStringLiteral("virtio");
+    if (devicePath.contains(QLatin1String("/ata")))
+        return QStringLiteral("sata");
+    if (devicePath.contains(QLatin1String("/rport-")))
+        return QStringLiteral("fc");
+    if (devicePath.contains(QLatin1String("/session")))
+        return QStringLiteral("iscsi");
+
+    return QString();
+}
+
+/** Creates a new SysfsBlockDevice and reads its attributes.
+    @param deviceNode the device node (e.g. "/dev/sda")
+*/
+SysfsBlockDevice::SysfsBlockDevice(const QString& deviceNode) :
+    d(std::make_unique<SysfsBlockDevicePrivate>())
+{
+    d->m_DeviceNode = deviceNode;
+    d->m_KernelName = kernelName(deviceNode);
+    d->m_Path = QStringLiteral("/sys/block/") + d->m_KernelName;
+    d->m_Valid = !d->m_KernelName.isEmpty() && QFileInfo::exists(d->m_Path + QStringLiteral("/size"));
+    d->m_Size = -1;
+    d->m_LogicalSectorSize = -1;
+    d->m_PhysicalSectorSize = -1;
+
+    if (!d->m_Valid)
+        return;
+
+    // /sys/block/<dev>/size is always in 512 byte units regardless of the sector size
+    const qint64 sectors = readAttributeNumber(QStringLiteral("size"));
+    if (sectors >= 0)
+        d->m_Size = sectors * 512;
+
+    d->m_LogicalSectorSize = readAttributeNumber(QStringLiteral("queue/logical_block_size"));
+    d->m_PhysicalSectorSize = readAttributeNumber(QStringLiteral("queue/physical_block_size"));
+
+    d->m_Model = readAttribute(QStringLiteral("device/model"));
+    if (d->m_Model.isEmpty()) // MMC and SD cards
+        d->m_Model = readAttribute(QStringLiteral("device/name"));
+
+    d->m_Transport = transportFromPath(QFileInfo(d->m_Path).canonicalFilePath());
+}
+
+SysfsBlockDevice::~SysfsBlockDevice()
+{
+}
+
+bool SysfsBlockDevice::isValid() const
+{
+    return d->m_Valid;
+}
+
+const QString& SysfsBlockDevice::deviceNode() const
+{
+    return d->m_DeviceNode;
+}
+
+const QString& SysfsBlockDevice::kernelName() const
+{
+    return d->m_KernelName;
+}
+
+const QString& SysfsBlockDevice::path() const
+{
+    return d->m_Path;
+}
+
+qint64 SysfsBlockDevice::size() const
+{
+    return d->m_Size;
+}
+
+qint64 SysfsBlockDevice::logicalSectorSize() const
+{
+    return d->m_LogicalSectorSize;
+}
+
+qint64 SysfsBlockDevice::physicalSectorSize() const
+{
+    return d->m_PhysicalSectorSize;
+}
+
+const QString& SysfsBlockDevice::model() const
+{
+    return d->m_Model;
+}
+
+const QString& SysfsBlockDevice::transport() const
+{
+    return d->m_Transport;
+}
+
+/** Reads a single attribute of this device.
+    @param attribute path of the attribute relative to the device directory (e.g. "queue/rotational")
+    @return trimmed contents of the attribute or empty string if it cannot be read
+*/
+QString SysfsBlockDevice::readAttribute(const QString& attribute) const
+{
+    if (!d->m_Valid)
+        return QString();
+
+    QFile f(d->m_Path + QLatin1Char('/') + attribute);
+    if (!f.open(QIODevice::ReadOnly))
+        return QString();
+
+    return QString::fromLocal8Bit(f.readAll()).trimmed();
+}
+
+/** Reads a numeric attribute of this device.
+    @param attribute path of the attribute relative to the device directory
+    @param defaultValue value returned if the attribute cannot be read or parsed
+    @return the value of the attribute
+*/
+qint64 SysfsBlockDevice::readAttributeNumber(const QString& attribute, qint64 defaultValue) const
+{
+    bool ok = false;
+    const qint64 value = readAttribute(attribute).toLongLong(&ok);
+    return ok ? value : defaultValue;
+}
+
+/** Finds the kernel name of a device node.
+
+    Symlinks such as /dev/mapper/foo or /dev/disk/by-id/... are resolved first.
+    @param deviceNode the device node (e.g. "/dev/sda")
+    @return kernel name (e.g. "sda") as used in /sys/block
+*/
+QString SysfsBlockDevice::kernelName(const QString& deviceNode)
+{
+    QString node = QFileInfo(deviceNode).canonicalFilePath();
+    if (node.isEmpty())
+        node = deviceNode;
+
+    if (!node.startsWith(QStringLiteral("/dev/")))
+        return QString();
+
+    // e.g. /dev/cciss/c0d0 is /sys/block/cciss!c0d0
+    return node.mid(5).replace(QLatin1Char('/'), QLatin1Char('!'));
+}
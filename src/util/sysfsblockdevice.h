@@ -0,0 +1,73 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_SYSFSBLOCKDEVICE_H
+#define KPMCORE_SYSFSBLOCKDEVICE_H
+
+#include "util/libpartitionmanagerexport.h"
+
+#include <QString>
+#include <QtGlobal>
+
+#include <memory>
+
+struct SysfsBlockDevicePrivate;
+
+/** Attributes of a block device read from /sys/block.
+
+    Reads the attributes that are needed while scanning a device (size,
+    logical sector size, model and transport) directly from sysfs in one
+    go. Unlike lsblk or blockdev this does not need to go through the
+    root helper.
+
+    @author Andrius Štikonas <andrius@stikonas.eu>
+*/
+class LIBKPMCORE_EXPORT SysfsBlockDevice
+{
+    Q_DISABLE_COPY(SysfsBlockDevice)
+
+public:
+    explicit SysfsBlockDevice(const QString& deviceNode);
+    ~SysfsBlockDevice();
+
+public:
+    /**< @return true if the device has a /sys/block entry */
+    bool isValid() const;
+
+    /**< @return the device node this object was created for */
+    const QString& deviceNode() const;
+
+    /**< @return the kernel name of the device (e.g. "sda" or "dm-0") */
+    const QString& kernelName() const;
+
+    /**< @return the sysfs directory of the device (e.g. "/sys/block/sda") */
+    const QString& path() const;
+
+    /**< @return device size in bytes or -1 if unknown */
+    qint64 size() const;
+
+    /**< @return logical sector size in bytes or -1 if unknown */
+    qint64 logicalSectorSize() const;
+
+    /**< @return physical sector size in bytes or -1 if unknown */
+    qint64 physicalSectorSize() const;
+
+    /**< @return device model as reported by the kernel, might be empty */
+    const QString& model() const;
+
+    /**< @return transport the device is attached by (e.g. "usb", "nvme", "sata"), might be empty */
+    const QString& transport() const;
+
+    QString readAttribute(const QString& attribute) const;
+    qint64 readAttributeNumber(const QString& attribute, qint64 defaultValue = -1) const;
+
+    static QString kernelName(const QString& deviceNode);
+
+private:
+    std::unique_ptr<SysfsBlockDevicePrivate> d;
+};
+
+#endif
@@ -0,0 +1,205 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#include "util/trace.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+
+#include <chrono>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+struct TraceEvent
+{
+    const char* category;
+    QString name;
+    qint64 start;
+    qint64 duration;
+    qint64 threadId;
+    QVariantMap args;
+};
+
+/** Collected events, written to the file named by KPMCORE_TRACE when the application quits. */
+struct TraceLog
+{
+    TraceLog() :
+        fileName(qEnvironmentVariable("KPMCORE_TRACE")),
+        enabled(!fileName.isEmpty()),
+        origin(Trace::now())
+    {
+    }
+
+    const QString fileName;
+    const bool enabled;
+    const qint64 origin;
+    QMutex mutex;
+    QVector<TraceEvent> events;
+    bool flushOnQuit = false;
+};
+
+// do not grow without bound if tracing is left enabled for a long session
+constexpr int maxEvents = 1000000;
+
+TraceLog& traceLog()
+{
+    static TraceLog log;
+    return log;
+}
+
+/** Flushes the log when the application quits, once QCoreApplication exists. Must be called with the mutex locked. */
+void connectFlushOnQuit(TraceLog& log)
+{
+    QCoreApplication* app = QCoreApplication::instance();
+    if (log.flushOnQuit || !app)
+        return;
+
+    QObject::connect(app, &QCoreApplication::aboutToQuit, app, [] { Trace::flush(); });
+    log.flushOnQuit = true;
+}
+
+qint64 threadId()
+{
+    thread_local const qint64 tid = syscall(SYS_gettid);
+    return tid;
+}
+}
+
+namespace Trace
+{
+/** @return true if spans are recorded */
+bool isEnabled()
+{
+    return traceLog().enabled;
+}
+
+/** @return monotonic time in nanoseconds */
+qint64 now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** Records a span that was timed by the caller.
+    @param category category of the span, e.g. "command" or "job"
+    @param name name shown for the span
+    @param start start time as returned by now()
+    @param end end time as returned by now()
+    @param args additional values shown with the span
+*/
+void addSpan(const char* category, const QString& name, qint64 start, qint64 end, const QVariantMap& args)
+{
+    TraceLog& log = traceLog();
+    if (!log.enabled)
+        return;
+
+    QMutexLocker lock(&log.mutex);
+    connectFlushOnQuit(log);
+    if (log.events.size() < maxEvents)
+        log.events.append({ category, name, start, end - start, threadId(), args });
+}
+
+/** Writes all recorded spans to the file named by KPMCORE_TRACE.
+
+    This is done when QCoreApplication::aboutToQuit is emitted. Applications
+    that return from main() without running an event loop call it themselves
+    while QCoreApplication still exists.
+
+    @return true on success or if tracing is disabled
+*/
+bool flush()
+{
+    const TraceLog& log = traceLog();
+    return !log.enabled || write(log.fileName);
+}
+
+/** Writes all recorded spans in Chrome trace event format.
+    @param fileName name of the file to write
+    @return true on success
+*/
+bool write(const QString& fileName)
+{
+    TraceLog& log = traceLog();
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QJsonArray traceEvents;
+    traceEvents.append(QJsonObject {
+        { QStringLiteral("name"), QStringLiteral("process_name") },
+        { QStringLiteral("ph"), QStringLiteral("M") },
+        { QStringLiteral("pid"), pid },
+        { QStringLiteral("args"), QJsonObject { { QStringLiteral("name"), QCoreApplication::applicationName() } } },
+    });
+
+    {
+        QMutexLocker lock(&log.mutex);
+        for (const auto &e : qAsConst(log.events)) {
+            // timestamps are in microseconds, fractions keep the nanoseconds
+            traceEvents.append(QJsonObject {
+                { QStringLiteral("name"), e.name },
+                { QStringLiteral("cat"), QLatin1String(e.category) },
+                { QStringLiteral("ph"), QStringLiteral("X") },
+                { QStringLiteral("ts"), (e.start - log.origin) / 1000.0 },
+                { QStringLiteral("dur"), e.duration / 1000.0 },
+                { QStringLiteral("pid"), pid },
+                { QStringLiteral("tid"), e.threadId },
+                { QStringLiteral("args"), QJsonObject::fromVariantMap(e.args) },
+            });
+        }
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    const QJsonObject trace {
+        { QStringLiteral("traceEvents"), traceEvents },
+        { QStringLiteral("displayTimeUnit"), QStringLiteral("ns") },
+    };
+
+    return file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact)) != -1;
+}
+}
+
+/** Starts a span.
+    @param category category of the span, must be a string literal
+    @param name name shown for the span
+*/
+TraceSpan::TraceSpan(const char* category, const QString& name) :
+    m_Category(category),
+    m_Start(Trace::isEnabled() ? Trace::now() : -1)
+{
+    if (isEnabled())
+        m_Name = name;
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (isEnabled())
+        Trace::addSpan(m_Category, m_Name, m_Start, Trace::now(), m_Args);
+}
+
+/** Adds a value that is shown with the span.
+    @param key name of the value
+    @param value the value
+*/
+void TraceSpan::addArgument(const QString& key, const QVariant& value)
+{
+    if (isEnabled())
+        m_Args[key] = value;
+}
+
+qint64 TraceSpan::elapsed() const
+{
+    return isEnabled() ? Trace::now() - m_Start : 0;
+}
@@ -0,0 +1,60 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+#ifndef KPMCORE_TRACE_H
+#define KPMCORE_TRACE_H
+
+#include "util/libpartitionmanagerexport.h"
+
+#include <QString>
+#include <QVariant>
+#include <QVariantMap>
+#include <QtGlobal>
+
+/** Lightweight tracing of scans, external commands and jobs.
+
+    Tracing is enabled by setting the KPMCORE_TRACE environment variable to
+    a file name. Spans are then collected in memory and written to that file
+    in Chrome trace event format (open it in Perfetto or chrome://tracing)
+    when the application quits, see Trace::flush. When tracing is disabled a
+    span only checks a flag.
+*/
+namespace Trace
+{
+LIBKPMCORE_EXPORT bool isEnabled();
+LIBKPMCORE_EXPORT qint64 now();
+LIBKPMCORE_EXPORT void addSpan(const char* category, const QString& name, qint64 start, qint64 end, const QVariantMap& args = QVariantMap());
+LIBKPMCORE_EXPORT bool write(const QString& fileName);
+LIBKPMCORE_EXPORT bool flush();
+}
+
+/** A traced span of work that lasts until the object goes out of scope.
+    @author Andrius Štikonas <andrius@stikonas.eu>
+*/
+class LIBKPMCORE_EXPORT TraceSpan
+{
+    Q_DISABLE_COPY(TraceSpan)
+
+public:
+    TraceSpan(const char* category, const QString& name);
+    ~TraceSpan();
+
+public:
+    void addArgument(const QString& key, const QVariant& value);
+
+    bool isEnabled() const {
+        return m_Start >= 0;    /**< @return true if this span is recorded */
+    }
+    qint64 elapsed() const; /**< @return nanoseconds since the span started */
+
+private:
+    const char* m_Category;
+    QString m_Name;
+    QVariantMap m_Args;
+    qint64 m_Start;
+};
+
+#endif
@@ -0,0 +1,407 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Times device scanning on loop devices backed by sparse image files.
+//
+// Creates partitioned disks (GPT or MBR), disks with a LUKS partition, LVM
+// physical volumes in one volume group and software RAID members, attaches
+// them as loop devices and times DeviceScanner::scan and its phases. Results
+// are printed (or written with --output) as JSON so that they can be compared
+// across commits. Needs root to set up the loop devices and is skipped otherwise.
+
+#include "helpers.h"
+
+#include "backend/corebackend.h"
+#include "backend/corebackendmanager.h"
+#include "core/device.h"
+#include "core/devicescanner.h"
+#include "core/operationstack.h"
+#include "core/partition.h"
+#include "core/partitiontable.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QReadLocker>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QVector>
+
+#include <algorithm>
+#include <memory>
+
+#include <unistd.h>
+
+static const QString volumeGroupName = QStringLiteral("kpmbenchvg");
+static const QString raidName = QStringLiteral("/dev/md/kpmbench");
+
+// Fixtures are set up by the benchmark itself, not through the privileged helper
+static bool runCommand(const QString& command, const QStringList& args, QString* output = nullptr, const QByteArray& input = QByteArray())
+{
+    QProcess process;
+    process.start(command, args);
+    if (!input.isEmpty())
+        process.write(input);
+    process.closeWriteChannel();
+
+    if (!process.waitForFinished(-1) || process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        qWarning() << "Command failed:" << command << args << process.readAllStandardError();
+        return false;
+    }
+
+    if (output)
+        *output = QString::fromLocal8Bit(process.readAllStandardOutput()).trimmed();
+    return true;
+}
+
+static QString partitionNode(const QString& deviceNode, int number)
+{
+    return deviceNode + QStringLiteral("p") + QString::number(number);
+}
+
+/** Loop devices that are detached again when the benchmark finishes. */
+class Fixtures
+{
+public:
+    ~Fixtures()
+    {
+        if (m_Raid)
+            runCommand(QStringLiteral("mdadm"), { QStringLiteral("--stop"), raidName });
+        for (const auto &member : qAsConst(m_RaidMembers))
+            runCommand(QStringLiteral("mdadm"), { QStringLiteral("--zero-superblock"), member });
+        if (m_VolumeGroup)
+            runCommand(QStringLiteral("lvm"), { QStringLiteral("vgremove"), QStringLiteral("--yes"), QStringLiteral("--force"), volumeGroupName });
+        if (!m_PhysicalVolumes.isEmpty())
+            runCommand(QStringLiteral("lvm"), QStringList { QStringLiteral("pvremove"), QStringLiteral("--yes") } + m_PhysicalVolumes);
+        for (const auto &deviceNode : qAsConst(m_DeviceNodes))
+            runCommand(QStringLiteral("losetup"), { QStringLiteral("--detach"), deviceNode });
+    }
+
+    bool isValid() const {
+        return m_Directory.isValid();
+    }
+
+    /** Creates a sparse image with a partition table and attaches it.
+        @param table "gpt" or "dos"
+        @param partitions number of partitions to create
+        @param partitionSize size of each partition in MiB
+        @return the loop device node or an empty string on error
+    */
+    QString createDisk(const QString& table, int partitions, int partitionSize)
+    {
+        const QString image = m_Directory.filePath(QStringLiteral("disk%1.img").arg(m_DeviceNodes.size()));
+
+        // Each partition gets one more MiB for alignment (and the EBR of logical
+        // partitions), 2 MiB are left for the partition table and the backup GPT
+        QFile file(image);
+        if (!file.open(QIODevice::WriteOnly) || !file.resize((static_cast<qint64>(partitions) * (partitionSize + 1) + 2) * 1024 * 1024)) {
+            qWarning() << "Could not create" << image;
+            return QString();
+        }
+        file.close();
+
+        QString deviceNode;
+        if (!runCommand(QStringLiteral("losetup"), { QStringLiteral("--find"), QStringLiteral("--show"), QStringLiteral("--partscan"), image }, &deviceNode))
+            return QString();
+        m_DeviceNodes.append(deviceNode);
+
+        QByteArray script = "label: " + table.toLatin1() + '\n';
+        if (table == QStringLiteral("gpt") && partitions > 128)
+            script += "table-length: " + QByteArray::number(partitions) + '\n';
+
+        const QByteArray partition = "," + QByteArray::number(partitionSize) + "MiB\n";
+        for (int i = 1; i <= partitions; ++i) {
+            // MBR: the fourth primary partition holds all logical partitions
+            if (table == QStringLiteral("dos") && i == 4 && partitions > 4)
+                script += ",,E\n";
+            script += partition;
+        }
+
+        if (!runCommand(QStringLiteral("sfdisk"), { QStringLiteral("--quiet"), deviceNode }, nullptr, script))
+            return QString();
+
+        return deviceNode;
+    }
+
+    bool createLuks(const QString& deviceNode)
+    {
+        // cheap key derivation, the header is all that is scanned
+        return runCommand(QStringLiteral("cryptsetup"), { QStringLiteral("luksFormat"), QStringLiteral("--batch-mode"),
+                                                          QStringLiteral("--type"), QStringLiteral("luks2"),
+                                                          QStringLiteral("--pbkdf"), QStringLiteral("pbkdf2"),
+                                                          QStringLiteral("--pbkdf-force-iterations"), QStringLiteral("1000"),
+                                                          QStringLiteral("--key-file=-"), partitionNode(deviceNode, 1) },
+                          nullptr, QByteArrayLiteral("kpmbench"));
+    }
+
+    bool createVolumeGroup(const QStringList& deviceNodes)
+    {
+        QStringList physicalVolumes;
+        for (const auto &deviceNode : deviceNodes)
+            physicalVolumes << partitionNode(deviceNode, 1);
+
+        if (!runCommand(QStringLiteral("lvm"), QStringList { QStringLiteral("pvcreate"), QStringLiteral("--yes") } + physicalVolumes))
+            return false;
+        m_PhysicalVolumes = physicalVolumes;
+
+        if (!runCommand(QStringLiteral("lvm"), QStringList { QStringLiteral("vgcreate"), volumeGroupName } + physicalVolumes))
+            return false;
+        m_VolumeGroup = true;
+
+        return runCommand(QStringLiteral("lvm"), { QStringLiteral("lvcreate"), QStringLiteral("--yes"), QStringLiteral("--extents"),
+                                                   QStringLiteral("50%FREE"), QStringLiteral("--name"), QStringLiteral("lv"), volumeGroupName });
+    }
+
+    bool createRaid(const QStringList& deviceNodes)
+    {
+        QStringList members;
+        for (const auto &deviceNode : deviceNodes)
+            members << partitionNode(deviceNode, 1);
+
+        m_RaidMembers = members;
+        if (!runCommand(QStringLiteral("mdadm"), QStringList { QStringLiteral("--create"), raidName, QStringLiteral("--run"), QStringLiteral("--force"),
+                                                               QStringLiteral("--level=1"), QStringLiteral("--metadata=1.2"),
+                                                               QStringLiteral("--raid-devices=%1").arg(members.size()) } + members))
+            return false;
+
+        m_Raid = true;
+        return true;
+    }
+
+    const QStringList& deviceNodes() const {
+        return m_DeviceNodes;
+    }
+
+private:
+    QTemporaryDir m_Directory;
+    QStringList m_DeviceNodes;
+    QStringList m_PhysicalVolumes;
+    QStringList m_RaidMembers;
+    bool m_VolumeGroup = false;
+    bool m_Raid = false;
+};
+
+static int countPartitions(const PartitionNode* node)
+{
+    int count = 0;
+    for (const auto &p : node->children())
+        count += 1 + countPartitions(p);
+
+    return count;
+}
+
+static QJsonObject statistics(QVector<double> runs)
+{
+    std::sort(runs.begin(), runs.end());
+
+    QJsonArray values;
+    double sum = 0;
+    for (const double value : qAsConst(runs)) {
+        values.append(value);
+        sum += value;
+    }
+
+    return QJsonObject {
+        { QStringLiteral("runs"), values },
+        { QStringLiteral("min"), runs.first() },
+        { QStringLiteral("median"), runs.at(runs.size() / 2) },
+        { QStringLiteral("mean"), sum / runs.size() },
+        { QStringLiteral("max"), runs.last() },
+    };
+}
+
+static double milliseconds(const QElapsedTimer& timer)
+{
+    return timer.nsecsElapsed() / 1e6;
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("backend"), QStringLiteral("Backend plugin to load."), QStringLiteral("[backend]"));
+    const QCommandLineOption disksOption(QStringLiteral("disks"), QStringLiteral("Number of partitioned disks."), QStringLiteral("n"), QStringLiteral("4"));
+    const QCommandLineOption partitionsOption(QStringLiteral("partitions"), QStringLiteral("Partitions per disk."), QStringLiteral("n"), QStringLiteral("8"));
+    const QCommandLineOption tableOption(QStringLiteral("table"), QStringLiteral("Partition table type: gpt or dos."), QStringLiteral("type"), QStringLiteral("gpt"));
+    const QCommandLineOption luksOption(QStringLiteral("luks"), QStringLiteral("Number of disks with a LUKS partition."), QStringLiteral("n"), QStringLiteral("1"));
+    const QCommandLineOption lvmOption(QStringLiteral("lvm"), QStringLiteral("Number of LVM physical volumes."), QStringLiteral("n"), QStringLiteral("2"));
+    const QCommandLineOption raidOption(QStringLiteral("raid"), QStringLiteral("Number of RAID members."), QStringLiteral("n"), QStringLiteral("2"));
+    const QCommandLineOption repeatOption(QStringLiteral("repeat"), QStringLiteral("Number of timed runs."), QStringLiteral("n"), QStringLiteral("3"));
+    const QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("Write results to file instead of standard output."), QStringLiteral("file"));
+    parser.addOptions({ disksOption, partitionsOption, tableOption, luksOption, lvmOption, raidOption, repeatOption, outputOption });
+    parser.process(app);
+
+    const int disks = parser.value(disksOption).toInt();
+    const int partitions = std::max(parser.value(partitionsOption).toInt(), 1);
+    const QString table = parser.value(tableOption);
+    const int luks = parser.value(luksOption).toInt();
+    const int lvm = parser.value(lvmOption).toInt();
+    const int raid = parser.value(raidOption).toInt();
+    const int repeat = std::max(parser.value(repeatOption).toInt(), 1);
+
+    if (table != QStringLiteral("gpt") && table != QStringLiteral("dos")) {
+        qWarning() << "Unknown partition table type" << table;
+        return 1;
+    }
+
+    if (geteuid() != 0) {
+        qDebug() << "Setting up loop devices needs root, skipping.";
+        return 0;
+    }
+
+    std::unique_ptr<KPMCoreInitializer> i;
+    if (parser.positionalArguments().isEmpty())
+        i = std::make_unique<KPMCoreInitializer>();
+    else
+        i = std::make_unique<KPMCoreInitializer>(parser.positionalArguments().first());
+    if (!i->isValid())
+        return 1;
+
+    auto backend = CoreBackendManager::self()->backend();
+
+    if (!backend) {
+        qWarning() << "Could not get backend.";
+        return 1;
+    }
+
+    // Set up the fixtures and remember how many partitions each disk should have
+    Fixtures fixtures;
+    if (!fixtures.isValid())
+        return 1;
+
+    QHash<QString, int> expectedPartitions;
+    QElapsedTimer setupTimer;
+    setupTimer.start();
+
+    for (int n = 0; n < disks; ++n) {
+        const QString deviceNode = fixtures.createDisk(table, partitions, 1);
+        if (deviceNode.isEmpty())
+            return 1;
+        expectedPartitions[deviceNode] = table == QStringLiteral("dos") && partitions > 4 ? partitions + 1 : partitions;
+    }
+
+    // LUKS2 headers are 16 MiB, so members get larger partitions
+    auto createMembers = [&] (int count) {
+        QStringList deviceNodes;
+        for (int n = 0; n < count; ++n) {
+            const QString deviceNode = fixtures.createDisk(table, 1, 32);
+            if (deviceNode.isEmpty())
+                return QStringList();
+            expectedPartitions[deviceNode] = 1;
+            deviceNodes << deviceNode;
+        }
+        return deviceNodes;
+    };
+
+    const QStringList luksDisks = createMembers(luks);
+    const QStringList lvmDisks = createMembers(lvm);
+    const QStringList raidDisks = createMembers(raid);
+    if (luksDisks.size() != luks || lvmDisks.size() != lvm || raidDisks.size() != raid)
+        return 1;
+
+    for (const auto &deviceNode : luksDisks)
+        if (!fixtures.createLuks(deviceNode))
+            return 1;
+    if (lvm > 0 && !fixtures.createVolumeGroup(lvmDisks))
+        return 1;
+    if (raid > 0 && !fixtures.createRaid(raidDisks))
+        return 1;
+
+    runCommand(QStringLiteral("udevadm"), { QStringLiteral("settle") });
+    const double setupTime = milliseconds(setupTimer);
+
+    // Full scans as an application does them, plus the phases of a scan on their own
+    OperationStack operationStack;
+    DeviceScanner deviceScanner(nullptr, operationStack);
+
+    QVector<double> scanRuns, layoutRuns, fileSystemRuns, scanDeviceRuns;
+    int devicesFound = 0;
+
+    for (int run = 0; run < repeat; ++run) {
+        QElapsedTimer timer;
+        timer.start();
+        deviceScanner.scan();
+        scanRuns.append(milliseconds(timer));
+
+        timer.start();
+        const QList<Device*> devices = backend->scanDevices(ScanFlag::includeLoopback | ScanFlag::deferFileSystemDetails);
+        layoutRuns.append(milliseconds(timer));
+
+        timer.start();
+        for (const auto &d : devices)
+            d->resolveFileSystems();
+        fileSystemRuns.append(milliseconds(timer));
+        qDeleteAll(devices);
+
+        timer.start();
+        for (const auto &deviceNode : fixtures.deviceNodes())
+            delete backend->scanDevice(deviceNode);
+        scanDeviceRuns.append(milliseconds(timer) / fixtures.deviceNodes().size());
+    }
+
+    // Timings are worthless if the scan missed fixtures
+    int errors = 0;
+    {
+        QReadLocker lockDevices(&operationStack.lock());
+        devicesFound = operationStack.previewDevices().size();
+
+        QHash<QString, int> foundPartitions;
+        for (const auto &d : qAsConst(operationStack.previewDevices()))
+            foundPartitions[d->deviceNode()] = d->partitionTable() ? countPartitions(d->partitionTable()) : 0;
+
+        for (auto it = expectedPartitions.cbegin(); it != expectedPartitions.cend(); ++it) {
+            const int found = foundPartitions.value(it.key(), -1);
+            if (found != it.value()) {
+                qWarning() << it.key() << "has" << found << "partitions, expected" << it.value();
+                ++errors;
+            }
+        }
+    }
+
+    const QJsonObject results {
+        { QStringLiteral("benchmark"), QStringLiteral("devicescanner") },
+        { QStringLiteral("configuration"), QJsonObject {
+            { QStringLiteral("disks"), disks },
+            { QStringLiteral("partitions"), partitions },
+            { QStringLiteral("table"), table },
+            { QStringLiteral("luks"), luks },
+            { QStringLiteral("lvm"), lvm },
+            { QStringLiteral("raid"), raid },
+            { QStringLiteral("repeat"), repeat },
+        } },
+        { QStringLiteral("loopDevices"), fixtures.deviceNodes().size() },
+        { QStringLiteral("devicesFound"), devicesFound },
+        { QStringLiteral("errors"), errors },
+        { QStringLiteral("setupMs"), setupTime },
+        { QStringLiteral("phasesMs"), QJsonObject {
+            { QStringLiteral("scan"), statistics(scanRuns) },
+            { QStringLiteral("layout"), statistics(layoutRuns) },
+            { QStringLiteral("fileSystems"), statistics(fileSystemRuns) },
+            { QStringLiteral("scanDevice"), statistics(scanDeviceRuns) },
+        } },
+    };
+
+    const QByteArray json = QJsonDocument(results).toJson();
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) == -1) {
+            qWarning() << "Could not write" << file.fileName();
+            return 1;
+        }
+    } else
+        QTextStream(stdout) << json;
+
+    return errors == 0 ? 0 : 1;
+}
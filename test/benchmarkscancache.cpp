@@ -0,0 +1,101 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Compares a cold scan with a warm scan that restores devices from the scan cache
+// and checks that both find the same partitions.
+
+#include "helpers.h"
+
+#include "backend/corebackend.h"
+#include "backend/corebackendmanager.h"
+#include "core/device.h"
+#include "core/partition.h"
+#include "core/partitiontable.h"
+#include "core/scancache.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStandardPaths>
+#include <QStringList>
+
+#include <memory>
+
+static void describePartitions(QStringList& description, const PartitionNode* node)
+{
+    for (const auto &p : node->children()) {
+        description << QStringLiteral("%1 %2-%3 %4 %5").arg(p->partitionPath()).arg(p->firstSector()).arg(p->lastSector())
+                                                     .arg(p->fileSystem().name(), p->fileSystem().label());
+        describePartitions(description, p);
+    }
+}
+
+static QStringList describe(const QList<Device*>& devices)
+{
+    QStringList description;
+    for (const auto &d : devices) {
+        description << d->deviceNode();
+        if (d->partitionTable())
+            describePartitions(description, d->partitionTable());
+    }
+
+    return description;
+}
+
+static QStringList scan(CoreBackend* backend, ScanFlags scanFlags, const QString& name)
+{
+    QElapsedTimer timer;
+    timer.start();
+    const QList<Device*> devices = backend->scanDevices(scanFlags);
+    qDebug() << name << "scan of" << devices.length() << "devices took" << timer.elapsed() << "ms";
+
+    const QStringList description = describe(devices);
+    qDeleteAll(devices);
+    return description;
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication app(argc, argv);
+    std::unique_ptr<KPMCoreInitializer> i;
+
+    if (argc != 2) {
+        i = std::make_unique<KPMCoreInitializer>();
+        if (!i->isValid())
+            return 1;
+    } else {
+        i = std::make_unique<KPMCoreInitializer>( argv[1] );
+        if (!i->isValid())
+            return 1;
+    }
+
+    auto backend = CoreBackendManager::self()->backend();
+
+    if (!backend) {
+        qWarning() << "Could not get backend.";
+        return 1;
+    }
+
+    // Do not touch the user's cache
+    QStandardPaths::setTestModeEnabled(true);
+    QFile::remove(ScanCache::defaultFileName());
+
+    const QStringList cold = scan(backend, ScanFlag::includeLoopback, QStringLiteral("Cold"));
+    const QStringList populate = scan(backend, ScanFlag::includeLoopback | ScanFlag::useScanCache, QStringLiteral("Populating cache"));
+    const QStringList warm = scan(backend, ScanFlag::includeLoopback | ScanFlag::useScanCache, QStringLiteral("Warm"));
+
+    QFile::remove(ScanCache::defaultFileName());
+
+    if (cold != populate || cold != warm) {
+        qWarning() << "Devices restored from the cache differ from scanned devices.";
+        qWarning() << "Scanned:" << cold;
+        qWarning() << "Restored:" << warm;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,191 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Parses recorded smartctl output one disk at a time and concurrently, checks
+// that both give the result recorded in <fixture>.expected and that quirks
+// found in the precompiled quirk table match a lookup that compiles every
+// pattern again. With --write-expected the results of the parser as built
+// are written to the .expected files instead, e.g. after adding a fixture.
+
+#include "core/smartattributeparseddata.h"
+#include "core/smartdiskinformation.h"
+#include "core/smartparser.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QStringList>
+
+#include <memory>
+#include <vector>
+
+static constexpr int rounds = 50;
+
+// Quirk lookup as it was done for every attribute before the table was precompiled
+static SmartQuirk uncompiledQuirk(const QString& model, const QString& firmware)
+{
+    for (const auto &item : SmartAttributeParsedData::quirkDatabase()) {
+        if (!item.model.isEmpty() && !QRegularExpression(item.model).match(model).hasMatch())
+            continue;
+        if (!item.firmware.isEmpty() && !QRegularExpression(item.firmware).match(firmware).hasMatch())
+            continue;
+        return item.quirk;
+    }
+
+    return SmartQuirk::None;
+}
+
+static QStringList describe(const SmartParser& parser)
+{
+    const SmartDiskInformation* disk = parser.diskInformation();
+    if (!disk)
+        return { parser.devicePath() + QStringLiteral(" failed") };
+
+    QStringList description;
+    description << QStringLiteral("%1 %2 %3 %4").arg(disk->model(), disk->firmware(), disk->serial()).arg(disk->quirk())
+                << QStringLiteral("status %1 overall %2 temperature %3 bad sectors %4 powered on %5 power cycles %6")
+                       .arg(disk->smartStatus()).arg(static_cast<int>(disk->overall())).arg(disk->temperature())
+                       .arg(disk->badSectors()).arg(disk->poweredOn()).arg(disk->powerCycles());
+
+    for (const auto &a : disk->attributes())
+        description << QStringLiteral("%1 %2 %3 %4 %5 %6 %7").arg(a.id()).arg(a.currentValue()).arg(a.worstValue()).arg(a.threshold())
+                                                              .arg(a.raw()).arg(a.prettyValue()).arg(static_cast<int>(a.prettyUnit()));
+
+    return description;
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication app(argc, argv);
+
+    const bool writeExpected = app.arguments().contains(QStringLiteral("--write-expected"));
+
+    QVector<QJsonDocument> fixtures;
+    QVector<QStringList> expected;
+    QStringList names;
+    const QDir dir(QStringLiteral(SMART_FIXTURES_DIR));
+    for (const auto &name : dir.entryList({ QStringLiteral("*.json") }, QDir::Files, QDir::Name)) {
+        QFile file(dir.filePath(name));
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Could not read" << file.fileName();
+            return 1;
+        }
+        fixtures.append(QJsonDocument::fromJson(file.readAll()));
+        names.append(name);
+
+        if (writeExpected)
+            continue;
+
+        QFile expectedFile(dir.filePath(QFileInfo(name).completeBaseName() + QStringLiteral(".expected")));
+        if (!expectedFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            qWarning() << "Could not read" << expectedFile.fileName();
+            return 1;
+        }
+        expected.append(QString::fromUtf8(expectedFile.readAll()).split(QLatin1Char('\n'), QString::SkipEmptyParts));
+    }
+
+    if (fixtures.isEmpty()) {
+        qWarning() << "No recorded smartctl output in" << dir.path();
+        return 1;
+    }
+
+    int rval = 0;
+
+    // One disk at a time
+    QVector<QStringList> sequential;
+    int attributes = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int round = 0; round < rounds; ++round) {
+        sequential.clear();
+        attributes = 0;
+        for (int i = 0; i < fixtures.size(); ++i) {
+            SmartParser parser(names[i], fixtures[i]);
+            if (!parser.init()) {
+                qWarning() << "Could not parse" << names[i];
+                rval = 1;
+            }
+            sequential.append(describe(parser));
+            attributes += parser.diskInformation() ? parser.diskInformation()->attributes().size() : 0;
+        }
+    }
+    qDebug() << "Parsing" << fixtures.size() << "disks one at a time took" << timer.elapsed() << "ms for" << rounds << "rounds";
+
+    // All disks concurrently
+    QVector<QStringList> concurrent;
+    timer.restart();
+    for (int round = 0; round < rounds; ++round) {
+        std::vector<std::unique_ptr<SmartParser>> parsers;
+        QVector<SmartParser*> pointers;
+        for (int i = 0; i < fixtures.size(); ++i) {
+            parsers.push_back(std::make_unique<SmartParser>(names[i], fixtures[i]));
+            pointers.append(parsers.back().get());
+        }
+
+        SmartParser::initAll(pointers);
+
+        concurrent.clear();
+        for (const auto &parser : pointers)
+            concurrent.append(describe(*parser));
+    }
+    qDebug() << "Parsing" << fixtures.size() << "disks concurrently took" << timer.elapsed() << "ms for" << rounds << "rounds";
+
+    for (int i = 0; i < fixtures.size() && writeExpected; ++i) {
+        QFile expectedFile(dir.filePath(QFileInfo(names[i]).completeBaseName() + QStringLiteral(".expected")));
+        if (!expectedFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text) ||
+                expectedFile.write((sequential[i].join(QLatin1Char('\n')) + QLatin1Char('\n')).toUtf8()) < 0) {
+            qWarning() << "Could not write" << expectedFile.fileName();
+            rval = 1;
+        }
+    }
+
+    for (int i = 0; i < expected.size(); ++i) {
+        if (sequential[i] != expected[i]) {
+            qWarning() << "Parsing" << names[i] << "differs from the expected result.";
+            qWarning() << "Parsed:  " << sequential[i];
+            qWarning() << "Expected:" << expected[i];
+            rval = 1;
+        }
+    }
+
+    if (sequential != concurrent) {
+        qWarning() << "Concurrent parsing differs from sequential parsing.";
+        qWarning() << "Sequential:" << sequential;
+        qWarning() << "Concurrent:" << concurrent;
+        rval = 1;
+    }
+
+    // The parser used to look up the quirks of the disk again for every attribute
+    timer.restart();
+    for (int round = 0; round < rounds; ++round) {
+        for (int i = 0; i < fixtures.size(); ++i) {
+            SmartParser parser(names[i], fixtures[i]);
+            parser.init();
+            const SmartDiskInformation* disk = parser.diskInformation();
+            if (!disk)
+                continue;
+
+            for (int j = 0; j < disk->attributes().size(); ++j) {
+                const SmartQuirk quirk = uncompiledQuirk(disk->model(), disk->firmware());
+                if (quirk != disk->quirk()) {
+                    qWarning() << "Precompiled quirks" << disk->quirk() << "of" << disk->model() << "differ from" << quirk;
+                    rval = 1;
+                }
+            }
+        }
+    }
+    qDebug() << "Parsing with a quirk lookup for each of" << attributes << "attributes took" << timer.elapsed() << "ms for" << rounds << "rounds";
+
+    for (const auto &description : qAsConst(sequential))
+        qDebug().noquote() << description.first();
+
+    return rval;
+}
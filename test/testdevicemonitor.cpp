@@ -0,0 +1,194 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Attaches and detaches loop devices and checks that DeviceScanner picks up
+// the changes without a full rescan, and that pending operations and the
+// Devices they refer to are left alone.
+
+#include "helpers.h"
+
+#include "backend/corebackendmanager.h"
+#include "core/device.h"
+#include "core/devicescanner.h"
+#include "core/operationstack.h"
+#include "core/partitiontable.h"
+
+#include "ops/createpartitiontableoperation.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QEventLoop>
+#include <QProcess>
+#include <QTemporaryFile>
+#include <QTimer>
+
+#include <functional>
+#include <memory>
+
+#include <unistd.h>
+
+// Tells ctest that the test was skipped, see SKIP_RETURN_CODE in CMakeLists.txt
+static constexpr int skipped = 77;
+
+static Device* findDevice(const OperationStack& operationStack, const QString& deviceNode)
+{
+    for (const auto &d : operationStack.previewDevices())
+        if (d->deviceNode() == deviceNode)
+            return d;
+
+    return nullptr;
+}
+
+static bool hasDevice(const OperationStack& operationStack, const QString& deviceNode)
+{
+    return findDevice(operationStack, deviceNode) != nullptr;
+}
+
+// Runs the event loop until condition is true or timeout is reached
+static bool waitFor(const std::function<bool()>& condition, int timeout = 30000)
+{
+    QEventLoop loop;
+    QTimer timer;
+    QObject::connect(&timer, &QTimer::timeout, &loop, [&] {
+        if (condition())
+            loop.exit(0);
+    });
+    timer.start(100);
+    QTimer::singleShot(timeout, &loop, [&] { loop.exit(1); });
+
+    return loop.exec() == 0;
+}
+
+static QString runLosetup(const QStringList& args)
+{
+    QProcess losetup;
+    losetup.start(QStringLiteral("losetup"), args);
+    if (!losetup.waitForFinished() || losetup.exitCode() != 0)
+        return QString();
+
+    return QString::fromLocal8Bit(losetup.readAllStandardOutput()).trimmed();
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication app(argc, argv);
+
+    if (geteuid() != 0) {
+        qWarning() << "Attaching loop devices needs root, skipping.";
+        return skipped;
+    }
+
+    std::unique_ptr<KPMCoreInitializer> i;
+
+    if (argc != 2) {
+        i = std::make_unique<KPMCoreInitializer>();
+        if (!i->isValid())
+            return 1;
+    } else {
+        i = std::make_unique<KPMCoreInitializer>( argv[1] );
+        if (!i->isValid())
+            return 1;
+    }
+
+    OperationStack *operationStack = new OperationStack();
+    DeviceScanner *deviceScanner = new DeviceScanner(nullptr, *operationStack);
+    deviceScanner->scan();
+
+    if (!deviceScanner->startMonitoring()) {
+        qWarning() << "Could not listen to uevents.";
+        return 1;
+    }
+
+    QTemporaryFile image;
+    if (!image.open() || !image.resize(64 * 1024 * 1024)) {
+        qWarning() << "Could not create image file.";
+        return 1;
+    }
+
+    const QString loopDevice = runLosetup({ QStringLiteral("--find"), QStringLiteral("--show"), image.fileName() });
+    if (loopDevice.isEmpty()) {
+        qWarning() << "Could not attach loop device.";
+        return 1;
+    }
+
+    qDebug() << "Attached" << loopDevice;
+    if (!waitFor([&] { return !deviceScanner->isRunning() && hasDevice(*operationStack, loopDevice); })) {
+        qWarning() << "Attached loop device" << loopDevice << "was not found.";
+        runLosetup({ QStringLiteral("--detach"), loopDevice });
+        return 1;
+    }
+
+    // Queue an operation on the first loop device, rescans must neither drop it nor replace the device
+    Device* pendingDevice = findDevice(*operationStack, loopDevice);
+    operationStack->push(new CreatePartitionTableOperation(*pendingDevice, PartitionTable::msdos));
+    const int operations = operationStack->size();
+    const QList<Device*> devices = operationStack->previewDevices();
+
+    QStringList changedDevices;
+    QObject::connect(deviceScanner, &DeviceScanner::devicesChanged, [&] (const QStringList& deviceNodes) {
+        changedDevices << deviceNodes;
+    });
+
+    QTemporaryFile otherImage;
+    if (!otherImage.open() || !otherImage.resize(64 * 1024 * 1024)) {
+        qWarning() << "Could not create image file.";
+        runLosetup({ QStringLiteral("--detach"), loopDevice });
+        return 1;
+    }
+
+    int rval = 0;
+    const QString otherLoopDevice = runLosetup({ QStringLiteral("--find"), QStringLiteral("--show"), otherImage.fileName() });
+    qDebug() << "Attached" << otherLoopDevice;
+    if (otherLoopDevice.isEmpty() || !waitFor([&] { return !deviceScanner->isRunning() && hasDevice(*operationStack, otherLoopDevice); })) {
+        qWarning() << "Attached loop device" << otherLoopDevice << "was not found.";
+        rval = 1;
+    } else {
+        if (operationStack->size() != operations) {
+            qWarning() << "Rescan changed the number of pending operations from" << operations << "to" << operationStack->size();
+            rval = 1;
+        }
+
+        // A full scan would have replaced every Device
+        for (const auto &d : devices) {
+            if (!operationStack->previewDevices().contains(d)) {
+                qWarning() << "Rescan of" << otherLoopDevice << "replaced unrelated devices.";
+                rval = 1;
+                break;
+            }
+        }
+    }
+
+    // Changing a device with pending operations is reported instead of rescanned
+    runLosetup({ QStringLiteral("--set-capacity"), loopDevice });
+    if (!waitFor([&] { return !deviceScanner->isRunning() && changedDevices.contains(loopDevice); })) {
+        qWarning() << "Change of" << loopDevice << "with pending operations was not reported.";
+        rval = 1;
+    } else if (findDevice(*operationStack, loopDevice) != pendingDevice || operationStack->size() != operations) {
+        qWarning() << "Device" << loopDevice << "with pending operations was rescanned.";
+        rval = 1;
+    }
+
+    if (!otherLoopDevice.isEmpty()) {
+        runLosetup({ QStringLiteral("--detach"), otherLoopDevice });
+
+        qDebug() << "Detached" << otherLoopDevice;
+        if (!waitFor([&] { return !deviceScanner->isRunning() && !hasDevice(*operationStack, otherLoopDevice); })) {
+            qWarning() << "Detached loop device" << otherLoopDevice << "is still listed.";
+            rval = 1;
+        }
+    }
+
+    operationStack->clearOperations();
+    runLosetup({ QStringLiteral("--detach"), loopDevice });
+
+    qDebug() << "Detached" << loopDevice;
+    if (!waitFor([&] { return !deviceScanner->isRunning() && !hasDevice(*operationStack, loopDevice); })) {
+        qWarning() << "Detached loop device" << loopDevice << "is still listed.";
+        return 1;
+    }
+
+    return rval;
+}
@@ -0,0 +1,173 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Opens and closes a LUKS container that holds an LVM physical volume and
+// checks that the volume group is seen right after opening and gone after
+// closing, i.e. that the cached LVM report is not used across the change.
+
+#include "helpers.h"
+
+#include "core/lvmreport.h"
+
+#include "fs/luks2.h"
+#include "fs/lvm2_pv.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+
+#include <memory>
+
+#include <unistd.h>
+
+// Tells ctest that the test was skipped, see SKIP_RETURN_CODE in CMakeLists.txt
+static constexpr int skipped = 77;
+
+static const QString passphrase = QStringLiteral("kpmcore");
+static const QString mapperName = QStringLiteral("kpmcore-testluks");
+static const QString vgName = QStringLiteral("kpmcoretestluks");
+
+// Exposes the part of cryptOpen() that runs after cryptsetup, which does not ask for a passphrase
+class TestLuks : public FS::luks2
+{
+public:
+    TestLuks() : FS::luks2(-1, -1, -1, QString()) {}
+
+    using FS::luks::finishCryptOpen;
+};
+
+static bool run(const QString& program, const QStringList& args, const QByteArray& input = QByteArray())
+{
+    QProcess process;
+    process.start(program, args);
+    if (!input.isEmpty()) {
+        process.write(input);
+        process.closeWriteChannel();
+    }
+
+    if (!process.waitForFinished(60000) || process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        qWarning() << program << args << "failed:" << process.readAllStandardError();
+        return false;
+    }
+
+    return true;
+}
+
+static QString runLosetup(const QStringList& args)
+{
+    QProcess losetup;
+    losetup.start(QStringLiteral("losetup"), args);
+    if (!losetup.waitForFinished() || losetup.exitCode() != 0)
+        return QString();
+
+    return QString::fromLocal8Bit(losetup.readAllStandardOutput()).trimmed();
+}
+
+// Creates a LUKS2 container holding a physical volume of a new volume group and leaves it closed
+static bool createContainer(const QString& loopDevice)
+{
+    const QString mapperNode = QStringLiteral("/dev/mapper/") + mapperName;
+
+    if (!run(QStringLiteral("cryptsetup"), { QStringLiteral("luksFormat"), QStringLiteral("--batch-mode"), QStringLiteral("--type"), QStringLiteral("luks2"),
+                                             QStringLiteral("--pbkdf"), QStringLiteral("pbkdf2"), QStringLiteral("--pbkdf-force-iterations"), QStringLiteral("1000"),
+                                             QStringLiteral("--key-file"), QStringLiteral("-"), loopDevice }, passphrase.toLocal8Bit()))
+        return false;
+
+    if (!run(QStringLiteral("cryptsetup"), { QStringLiteral("open"), QStringLiteral("--key-file"), QStringLiteral("-"), loopDevice, mapperName }, passphrase.toLocal8Bit()))
+        return false;
+
+    const bool created = run(QStringLiteral("lvm"), { QStringLiteral("pvcreate"), mapperNode })
+                      && run(QStringLiteral("lvm"), { QStringLiteral("vgcreate"), vgName, mapperNode })
+                      && run(QStringLiteral("lvm"), { QStringLiteral("vgchange"), QStringLiteral("--activate"), QStringLiteral("n"), vgName });
+
+    return run(QStringLiteral("cryptsetup"), { QStringLiteral("close"), mapperName }) && created;
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication app(argc, argv);
+
+    if (geteuid() != 0) {
+        qWarning() << "Setting up LUKS containers needs root, skipping.";
+        return skipped;
+    }
+
+    if (QStandardPaths::findExecutable(QStringLiteral("cryptsetup")).isEmpty() || QStandardPaths::findExecutable(QStringLiteral("lvm")).isEmpty()) {
+        qWarning() << "cryptsetup or lvm is not installed, skipping.";
+        return skipped;
+    }
+
+    std::unique_ptr<KPMCoreInitializer> i;
+
+    if (argc != 2) {
+        i = std::make_unique<KPMCoreInitializer>();
+        if (!i->isValid())
+            return 1;
+    } else {
+        i = std::make_unique<KPMCoreInitializer>( argv[1] );
+        if (!i->isValid())
+            return 1;
+    }
+
+    QTemporaryFile image;
+    if (!image.open() || !image.resize(64 * 1024 * 1024)) {
+        qWarning() << "Could not create image file.";
+        return 1;
+    }
+
+    const QString loopDevice = runLosetup({ QStringLiteral("--find"), QStringLiteral("--show"), image.fileName() });
+    if (loopDevice.isEmpty()) {
+        qWarning() << "Could not attach loop device.";
+        return 1;
+    }
+
+    int rval = 0;
+    if (!createContainer(loopDevice)) {
+        qWarning() << "Could not create a LUKS container with a physical volume on" << loopDevice;
+        rval = 1;
+    } else {
+        // Take a snapshot while the container is closed, as a device scan would
+        LvmReport::invalidate();
+        if (LvmReport::current()->physicalVolume(QStringLiteral("/dev/mapper/") + mapperName) != nullptr) {
+            qWarning() << "Physical volume is listed while its container is closed.";
+            rval = 1;
+        }
+
+        TestLuks luks;
+        if (!run(QStringLiteral("cryptsetup"), { QStringLiteral("open"), QStringLiteral("--key-file"), QStringLiteral("-"), loopDevice, mapperName }, passphrase.toLocal8Bit())
+                || !luks.finishCryptOpen(loopDevice, passphrase)) {
+            qWarning() << "Could not open the LUKS container on" << loopDevice;
+            rval = 1;
+        } else {
+            if (luks.innerFS()->type() != FileSystem::Type::Lvm2_PV) {
+                qWarning() << "Inner file system of" << loopDevice << "is" << luks.innerFS()->name() << "instead of an LVM physical volume.";
+                rval = 1;
+            }
+
+            const QString openedVgName = FS::lvm2_pv::getVGName(luks.mapperName());
+            if (openedVgName != vgName) {
+                qWarning() << "Opened physical volume" << luks.mapperName() << "belongs to" << openedVgName << "instead of" << vgName;
+                rval = 1;
+            }
+
+            const QString mapperNode = luks.mapperName();
+            run(QStringLiteral("lvm"), { QStringLiteral("vgchange"), QStringLiteral("--activate"), QStringLiteral("n"), vgName });
+            if (!luks.cryptClose(loopDevice)) {
+                qWarning() << "Could not close the LUKS container on" << loopDevice;
+                run(QStringLiteral("cryptsetup"), { QStringLiteral("close"), mapperName });
+                rval = 1;
+            } else if (LvmReport::current()->physicalVolume(mapperNode) != nullptr) {
+                qWarning() << "Physical volume" << mapperNode << "is still listed after closing its container.";
+                rval = 1;
+            }
+        }
+    }
+
+    runLosetup({ QStringLiteral("--detach"), loopDevice });
+    return rval;
+}
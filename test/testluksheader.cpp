@@ -0,0 +1,69 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Reads LUKS1 and LUKS2 headers from small images and checks which of the two
+// LUKS2 headers is used when one of them is damaged or out of date.
+
+#include "fs/luksheader.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+
+static bool check(const QString& name, const QString& label, int version = 2)
+{
+    const QString fileName = QStringLiteral(LUKS_FIXTURES_DIR "/") + name + QStringLiteral(".img");
+    const FS::LuksHeader header = FS::LuksHeader::read(fileName);
+
+    if (header.version != version) {
+        qWarning() << name << "has version" << header.version << "expected" << version;
+        return false;
+    }
+
+    if (!header.isValid())
+        return true;
+
+    const bool luks1 = version == 1;
+    const QString uuid = luks1 ? QStringLiteral("6f3f8e8c-4c5b-4c1a-9d8e-2b9f6c0a1e11") : QStringLiteral("0b7e6e3a-5c1d-4f52-9a3e-7d2c1b4a8f60");
+    const qint64 payloadOffset = luks1 ? 4096 * 512 : 16777216;
+    const qint64 sectorSize = luks1 ? 512 : 4096;
+    const QStringList flags = luks1 ? QStringList() : QStringList { QStringLiteral("allow-discards") };
+
+    if (header.uuid != uuid || header.label != label || header.cipherName != QStringLiteral("aes") ||
+            header.cipherMode != QStringLiteral("xts-plain64") || header.hashName != QStringLiteral("sha256") ||
+            header.keySize != 512 || header.payloadOffset != payloadOffset || header.sectorSize != sectorSize ||
+            header.flags != flags) {
+        qWarning() << name << "was read as" << header.uuid << header.label << header.cipherName << header.cipherMode
+                   << header.hashName << header.keySize << header.payloadOffset << header.sectorSize << header.flags;
+        return false;
+    }
+
+    if (!luks1 && (header.pbkdfMemory != 1048576 || header.pbkdfThreads != 4)) {
+        qWarning() << name << "has PBKDF memory" << header.pbkdfMemory << "and threads" << header.pbkdfThreads;
+        return false;
+    }
+
+    return true;
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication app(argc, argv);
+
+    bool rval = true;
+    rval = check(QStringLiteral("luks1"), QString(), 1) && rval;
+    rval = check(QStringLiteral("luks2"), QStringLiteral("kpmcore")) && rval;
+
+    // The first 4 KiB are wiped, only the secondary header is left
+    rval = check(QStringLiteral("luks2-corrupt-primary"), QStringLiteral("kpmcore")) && rval;
+
+    // The label of the primary header was changed after its checksum was written
+    rval = check(QStringLiteral("luks2-bad-checksum"), QStringLiteral("kpmcore")) && rval;
+
+    // Both headers are valid, the secondary one has a higher sequence number
+    rval = check(QStringLiteral("luks2-newer-secondary"), QStringLiteral("new")) && rval;
+
+    return rval ? 0 : 1;
+}
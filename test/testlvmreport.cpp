@@ -0,0 +1,109 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Parses a recorded "lvm fullreport" of a volume group with a thin pool and
+// checks volumes and segments. Needs neither root nor a backend.
+
+#include "core/lvmreport.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+
+static QByteArray fixture(const QString& name)
+{
+    QFile file(QStringLiteral(LVM_FIXTURES_DIR "/") + name);
+    if (!file.open(QIODevice::ReadOnly))
+        qWarning() << "Could not open" << file.fileName();
+
+    return file.readAll();
+}
+
+// Segments are given as "lvPath pvPath:first-last"
+static bool checkSegments(const LvmReport& report, const QString& pvPath, const QStringList& expected)
+{
+    QStringList segments;
+    for (const auto &segment : report.physicalVolumeSegments(pvPath))
+        segments << QStringLiteral("%1 %2:%3-%4").arg(segment.lvPath, segment.pvPath).arg(segment.pvExtent).arg(segment.pvExtent + segment.extents - 1);
+
+    if (segments != expected) {
+        qWarning() << pvPath << "has segments" << segments << "expected" << expected;
+        return false;
+    }
+
+    return true;
+}
+
+static bool checkThinPool()
+{
+    const LvmReport report(fixture(QStringLiteral("fullreport-thin.json")));
+    if (!report.isValid() || report.volumeGroups() != QStringList { QStringLiteral("vg0") }) {
+        qWarning() << "Report has volume groups" << report.volumeGroups();
+        return false;
+    }
+
+    bool rval = true;
+
+    // Only volumes with a device node are listed in the volume group
+    const LvmReport::VolumeGroup* vg = report.volumeGroup(QStringLiteral("vg0"));
+    const QStringList lvPaths = { QStringLiteral("/dev/vg0/root"), QStringLiteral("/dev/vg0/data") };
+    if (vg->extentSize != 4194304 || vg->extentCount != 510 || vg->freeCount != 252 || vg->logicalVolumes != lvPaths) {
+        qWarning() << "vg0 was read as" << vg->extentSize << vg->extentCount << vg->freeCount << vg->logicalVolumes;
+        rval = false;
+    }
+
+    const LvmReport::LogicalVolume* data = report.logicalVolume(QStringLiteral("/dev/vg0/data"));
+    if (!data || !data->hasPath || data->size != 1073741824 || data->vgName != QStringLiteral("vg0")) {
+        qWarning() << "Thin volume /dev/vg0/data is missing or was read wrongly.";
+        rval = false;
+    }
+
+    // The thin pool has no path, but it is kept and its data and metadata extents are attributed to it
+    const LvmReport::LogicalVolume* pool = report.logicalVolume(QStringLiteral("/dev/vg0/pool"));
+    if (!pool || pool->hasPath || pool->name != QStringLiteral("pool") || pool->size != 536870912) {
+        qWarning() << "Thin pool /dev/vg0/pool is missing or was read wrongly.";
+        rval = false;
+    }
+
+    if (report.logicalVolume(QStringLiteral("/dev/vg0/pool_tdata")) || report.logicalVolume(QStringLiteral("/dev/vg0/pool_tmeta"))) {
+        qWarning() << "Sub-volumes of the thin pool are listed as logical volumes.";
+        rval = false;
+    }
+
+    rval = checkSegments(report, QStringLiteral("/dev/sda2"), { QStringLiteral("/dev/vg0/root /dev/sda2:0-127"),
+                                                               QStringLiteral("/dev/vg0/pool /dev/sda2:128-191") }) && rval;
+    rval = checkSegments(report, QStringLiteral("/dev/sdb1"), { QStringLiteral("/dev/vg0/pool /dev/sdb1:0-63"),
+                                                               QStringLiteral("/dev/vg0/pool /dev/sdb1:64-64"),
+                                                               QStringLiteral("/dev/vg0/lvol0_pmspare /dev/sdb1:65-65") }) && rval;
+
+    const LvmReport::PhysicalVolume* pv = report.physicalVolume(QStringLiteral("/dev/sdb1"));
+    if (!pv || pv->vgName != QStringLiteral("vg0") || pv->extentCount != 255 || pv->allocatedExtents != 66 || pv->extentStart != 1048576 || pv->extentSize != 4194304) {
+        qWarning() << "Physical volume /dev/sdb1 is missing or was read wrongly.";
+        rval = false;
+    }
+
+    const LvmReport::PhysicalVolume* orphan = report.physicalVolume(QStringLiteral("/dev/sdc"));
+    if (!orphan || !orphan->vgName.isEmpty() || !checkSegments(report, QStringLiteral("/dev/sdc"), {})) {
+        qWarning() << "Physical volume /dev/sdc without a volume group is missing or was read wrongly.";
+        rval = false;
+    }
+
+    return rval;
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication app(argc, argv);
+
+    bool rval = checkThinPool();
+
+    if (LvmReport(QByteArray("{ \"report\": [")).isValid()) {
+        qWarning() << "Truncated report was accepted.";
+        rval = false;
+    }
+
+    return rval ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Reencrypts a LUKS2 container on a loop device with a smaller key and checks
+// that the data in it is unchanged and that the new key size is used.
+
+#include "helpers.h"
+
+#include "backend/corebackend.h"
+#include "backend/corebackendmanager.h"
+#include "core/device.h"
+#include "core/partition.h"
+#include "fs/luks2.h"
+#include "fs/luksheader.h"
+#include "ops/reencryptoperation.h"
+#include "util/report.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+
+#include <memory>
+
+#include <unistd.h>
+
+// Tells ctest that the test was skipped, see SKIP_RETURN_CODE in CMakeLists.txt
+static constexpr int skipped = 77;
+
+static const QString passphrase = QStringLiteral("kpmcore");
+static const QString mapperName = QStringLiteral("kpmcore-testreencrypt");
+static const QString mapperNode = QStringLiteral("/dev/mapper/kpmcore-testreencrypt");
+
+static bool run(const QString& program, const QStringList& args, const QByteArray& input = QByteArray())
+{
+    QProcess process;
+    process.start(program, args);
+    if (!input.isEmpty()) {
+        process.write(input);
+        process.closeWriteChannel();
+    }
+
+    if (!process.waitForFinished(60000) || process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        qWarning() << program << args << "failed:" << process.readAllStandardError();
+        return false;
+    }
+
+    return true;
+}
+
+static QString runLosetup(const QStringList& args)
+{
+    QProcess losetup;
+    losetup.start(QStringLiteral("losetup"), args);
+    if (!losetup.waitForFinished() || losetup.exitCode() != 0)
+        return QString();
+
+    return QString::fromLocal8Bit(losetup.readAllStandardOutput()).trimmed();
+}
+
+static bool openContainer(const QString& loopDevice)
+{
+    return run(QStringLiteral("cryptsetup"), { QStringLiteral("open"), QStringLiteral("--key-file"), QStringLiteral("-"), loopDevice, mapperName }, passphrase.toLocal8Bit());
+}
+
+static bool closeContainer()
+{
+    return run(QStringLiteral("cryptsetup"), { QStringLiteral("close"), mapperName });
+}
+
+// Creates a LUKS2 container with a 512 bit key, writes the data into it and leaves it closed
+static bool createContainer(const QString& loopDevice, const QByteArray& data)
+{
+    if (!run(QStringLiteral("cryptsetup"), { QStringLiteral("luksFormat"), QStringLiteral("--batch-mode"), QStringLiteral("--type"), QStringLiteral("luks2"),
+                                             QStringLiteral("--cipher"), QStringLiteral("aes-xts-plain64"), QStringLiteral("--key-size"), QStringLiteral("512"),
+                                             QStringLiteral("--pbkdf"), QStringLiteral("pbkdf2"), QStringLiteral("--pbkdf-force-iterations"), QStringLiteral("1000"),
+                                             QStringLiteral("--key-file"), QStringLiteral("-"), loopDevice }, passphrase.toLocal8Bit()))
+        return false;
+
+    if (!openContainer(loopDevice))
+        return false;
+
+    QFile mapper(mapperNode);
+    const bool written = mapper.open(QIODevice::WriteOnly) && mapper.write(data) == data.size() && mapper.flush();
+    mapper.close();
+
+    return closeContainer() && written;
+}
+
+static bool checkData(const QString& loopDevice, const QByteArray& data)
+{
+    if (!openContainer(loopDevice)) {
+        qWarning() << "Could not open the reencrypted container.";
+        return false;
+    }
+
+    QFile mapper(mapperNode);
+    const bool same = mapper.open(QIODevice::ReadOnly) && mapper.read(data.size()) == data;
+    mapper.close();
+    closeContainer();
+
+    if (!same)
+        qWarning() << "Data in the container changed while it was reencrypted.";
+    return same;
+}
+
+static bool reencrypt(Device& device, const QString& loopDevice)
+{
+    const qint64 lastSector = device.totalLogical() - 1;
+    FS::luks2* fs = new FS::luks2(0, lastSector, -1, QString());
+    fs->scan(loopDevice);
+    Partition partition(nullptr, device, PartitionRole(PartitionRole::Primary), fs, 0, lastSector, loopDevice);
+
+    FS::luks::FormatOptions options;
+    options.cipher = QStringLiteral("aes-xts-plain64");
+    options.keySize = 256;
+    options.pbkdf = QStringLiteral("pbkdf2");
+    options.iterTime = 10;
+
+    // Small steps, so that the data is reencrypted in several of them
+    ReencryptOperation op(device, partition, passphrase, options, FS::luks2::Resilience::Journal, 1024 * 1024);
+
+    op.preview();
+    if (fs->keySize() != 256 || fs->cipherName() != QStringLiteral("aes") || fs->cipherMode() != QStringLiteral("xts-plain64")) {
+        qWarning() << "Preview shows" << fs->cipherName() << fs->cipherMode() << fs->keySize();
+        return false;
+    }
+
+    op.undo();
+    if (fs->keySize() != 512) {
+        qWarning() << "Undo left key size" << fs->keySize();
+        return false;
+    }
+
+    Report report(nullptr);
+    if (!op.execute(report)) {
+        qWarning() << "Reencryption failed:" << report.toText();
+        return false;
+    }
+
+    return true;
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication app(argc, argv);
+
+    if (geteuid() != 0) {
+        qWarning() << "Setting up LUKS containers needs root, skipping.";
+        return skipped;
+    }
+
+    if (QStandardPaths::findExecutable(QStringLiteral("cryptsetup")).isEmpty()) {
+        qWarning() << "cryptsetup is not installed, skipping.";
+        return skipped;
+    }
+
+    std::unique_ptr<KPMCoreInitializer> i;
+
+    if (argc != 2) {
+        i = std::make_unique<KPMCoreInitializer>();
+        if (!i->isValid())
+            return 1;
+    } else {
+        i = std::make_unique<KPMCoreInitializer>( argv[1] );
+        if (!i->isValid())
+            return 1;
+    }
+
+    QTemporaryFile image;
+    if (!image.open() || !image.resize(64 * 1024 * 1024)) {
+        qWarning() << "Could not create image file.";
+        return 1;
+    }
+
+    const QString loopDevice = runLosetup({ QStringLiteral("--find"), QStringLiteral("--show"), image.fileName() });
+    if (loopDevice.isEmpty()) {
+        qWarning() << "Could not attach loop device.";
+        return 1;
+    }
+
+    QByteArray data(16 * 1024 * 1024, 0);
+    for (auto &byte : data)
+        byte = static_cast<char>(QRandomGenerator::global()->bounded(256));
+
+    int rval = 0;
+    std::unique_ptr<Device> device(CoreBackendManager::self()->backend()->scanDevice(loopDevice));
+    if (!device) {
+        qWarning() << "Could not scan" << loopDevice;
+        rval = 1;
+    } else if (!createContainer(loopDevice, data)) {
+        qWarning() << "Could not create a LUKS container on" << loopDevice;
+        rval = 1;
+    } else if (!reencrypt(*device, loopDevice) || !checkData(loopDevice, data)) {
+        rval = 1;
+    } else {
+        const FS::LuksHeader header = FS::LuksHeader::read(loopDevice);
+        if (header.keySize != 256) {
+            qWarning() << "Key size is" << header.keySize << "after reencrypting instead of 256.";
+            rval = 1;
+        }
+    }
+
+    runLosetup({ QStringLiteral("--detach"), loopDevice });
+    return rval;
+}
@@ -0,0 +1,148 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Writes a SMART history, cuts its last record short as a crash while
+// appending would, appends again and checks that every record reads back.
+// Also checks which old records are kept when the history is thinned out.
+
+#include "core/smarthistory.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+static SmartHistory::Record makeRecord(qint64 time, quint64 reallocated)
+{
+    SmartHistory::Record record;
+    record.time = time;
+    record.temperature = 300000 + time;
+
+    SmartHistory::Value value;
+    value.id = 5;
+    value.current = 100;
+    value.worst = 99;
+    value.raw = reallocated;
+    record.values.append(value);
+
+    return record;
+}
+
+static bool sameRecord(const SmartHistory::Record& a, const SmartHistory::Record& b)
+{
+    if (a.time != b.time || a.temperature != b.temperature || a.values.size() != b.values.size())
+        return false;
+
+    for (int i = 0; i < a.values.size(); ++i)
+        if (a.values[i].id != b.values[i].id || a.values[i].current != b.values[i].current ||
+                a.values[i].worst != b.values[i].worst || a.values[i].raw != b.values[i].raw)
+            return false;
+
+    return true;
+}
+
+static bool check(const QString& fileName, const QVector<SmartHistory::Record>& expected)
+{
+    SmartHistory history(fileName);
+    if (!history.load()) {
+        qWarning() << "Could not load" << fileName;
+        return false;
+    }
+
+    if (history.records().size() != expected.size()) {
+        qWarning() << "Loaded" << history.records().size() << "records, expected" << expected.size();
+        return false;
+    }
+
+    for (int i = 0; i < expected.size(); ++i) {
+        if (!sameRecord(history.records()[i], expected[i])) {
+            qWarning() << "Record" << i << "differs";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication app(argc, argv);
+
+    QTemporaryDir dir;
+    if (!dir.isValid())
+        return 1;
+
+    const QString fileName = SmartHistory::fileName(dir.path(), QStringLiteral("Test Disk"), QStringLiteral("0001"));
+    QVector<SmartHistory::Record> expected = { makeRecord(1000, 0), makeRecord(2000, 1) };
+
+    {
+        SmartHistory history(fileName);
+        for (const auto &record : qAsConst(expected))
+            if (!history.append(record))
+                return 1;
+    }
+
+    if (!check(fileName, expected))
+        return 1;
+
+    // Lose the last bytes of the second record
+    const qint64 size = QFileInfo(fileName).size();
+    if (!QFile::resize(fileName, size - 3))
+        return 1;
+    expected.removeLast();
+
+    if (!check(fileName, expected))
+        return 1;
+
+    if (QFileInfo(fileName).size() >= size - 3) {
+        qWarning() << "Incomplete record was not removed from" << fileName;
+        return 1;
+    }
+
+    // A new record must start where the last complete one ended
+    {
+        SmartHistory history(fileName);
+        if (!history.load() || !history.append(makeRecord(3000, 2)))
+            return 1;
+    }
+    expected.append(makeRecord(3000, 2));
+
+    // Also when appending without loading first
+    if (!QFile::resize(fileName, QFileInfo(fileName).size() - 1))
+        return 1;
+    expected.removeLast();
+    {
+        SmartHistory history(fileName);
+        if (!history.append(makeRecord(4000, 3)))
+            return 1;
+    }
+    expected.append(makeRecord(4000, 3));
+
+    if (!check(fileName, expected))
+        return 1;
+
+    // Records older than a week are thinned out to the last one of each day, those older than two years dropped
+    constexpr qint64 day = 24 * 60 * 60;
+    const qint64 now = 1000 * day;
+    const QString thinnedFileName = SmartHistory::fileName(dir.path(), QStringLiteral("Test Disk"), QStringLiteral("0002"));
+    const QVector<SmartHistory::Record> records = {
+        makeRecord(now - 800 * day, 0),
+        makeRecord(now - 10 * day + 3600, 1), makeRecord(now - 10 * day + 7200, 2),
+        makeRecord(now - 9 * day + 3600, 3),
+        makeRecord(now - 2 * day + 3600, 4), makeRecord(now - 2 * day + 7200, 5),
+        makeRecord(now, 6)
+    };
+    {
+        SmartHistory history(thinnedFileName);
+        for (const auto &record : records)
+            if (!history.append(record))
+                return 1;
+    }
+    expected = { records[2], records[3], records[4], records[5], records[6] };
+
+    return check(thinnedFileName, expected) ? 0 : 1;
+}
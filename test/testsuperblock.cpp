@@ -0,0 +1,177 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Creates small file system images and checks the used capacity that is read
+// from their superblocks against what the file system's own tools report.
+// File systems whose tools are not installed are skipped. Needs neither root
+// nor a backend.
+
+#include "fs/superblock.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+
+#include <functional>
+
+// Tells ctest that the test was skipped, see SKIP_RETURN_CODE in CMakeLists.txt
+static constexpr int skipped = 77;
+
+enum class Result { Passed, Failed, Skipped };
+
+/** @return standard output of the program or a null string if it could not be run successfully */
+static QString run(const QString& program, const QStringList& args)
+{
+    QProcess process;
+    process.start(program, args);
+    if (!process.waitForFinished(60000) || process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        qWarning() << program << args << "failed:" << process.readAllStandardError();
+        return QString();
+    }
+
+    return QString::fromLocal8Bit(process.readAllStandardOutput());
+}
+
+/** @return the number captured by the pattern or -1 if it does not match */
+static qint64 field(const QString& output, const QString& pattern)
+{
+    const QRegularExpressionMatch match = QRegularExpression(pattern, QRegularExpression::MultilineOption).match(output);
+    return match.hasMatch() ? match.captured(1).toLongLong() : -1;
+}
+
+/** Formats an image of the given size and compares the used capacity with the one its tools report.
+    @param mkfs program and arguments that format the image, its file name is appended
+    @param reference reads the used capacity of the image with the file system's tools, -1 on errors
+*/
+static Result check(const char* name, qint64 size, const QStringList& mkfs, const std::function<qint64(const QString&)>& reference,
+                    const std::function<qint64(const QString&)>& usedCapacity)
+{
+    if (QStandardPaths::findExecutable(mkfs.first()).isEmpty()) {
+        qDebug() << name << "skipped," << mkfs.first() << "is not installed.";
+        return Result::Skipped;
+    }
+
+    QTemporaryFile image;
+    if (!image.open() || !image.resize(size)) {
+        qWarning() << "Could not create image file.";
+        return Result::Failed;
+    }
+    image.close();
+
+    if (run(mkfs.first(), mkfs.mid(1) << image.fileName()).isNull())
+        return Result::Failed;
+
+    const qint64 expected = reference(image.fileName());
+    const qint64 used = usedCapacity(image.fileName());
+    if (expected < 0 || used != expected) {
+        qWarning() << name << "has" << used << "bytes in use, its tools report" << expected;
+        return Result::Failed;
+    }
+
+    return Result::Passed;
+}
+
+static qint64 ext2Reference(const QString& image)
+{
+    const QString output = run(QStringLiteral("dumpe2fs"), { QStringLiteral("-h"), image });
+    const qint64 blocks = field(output, QStringLiteral("^Block count:\\s*(\\d+)"));
+    const qint64 freeBlocks = field(output, QStringLiteral("^Free blocks:\\s*(\\d+)"));
+    const qint64 blockSize = field(output, QStringLiteral("^Block size:\\s*(\\d+)"));
+    return blocks < 0 || freeBlocks < 0 || blockSize < 0 ? -1 : (blocks - freeBlocks) * blockSize;
+}
+
+static qint64 xfsReference(const QString& image)
+{
+    const QString output = run(QStringLiteral("xfs_db"), { QStringLiteral("-r"), QStringLiteral("-c"), QStringLiteral("sb 0"),
+                                                           QStringLiteral("-c"), QStringLiteral("print blocksize dblocks fdblocks"), image });
+    const qint64 blockSize = field(output, QStringLiteral("^blocksize = (\\d+)"));
+    const qint64 blocks = field(output, QStringLiteral("^dblocks = (\\d+)"));
+    const qint64 freeBlocks = field(output, QStringLiteral("^fdblocks = (\\d+)"));
+    return blocks < 0 || freeBlocks < 0 || blockSize < 0 ? -1 : (blocks - freeBlocks) * blockSize;
+}
+
+static qint64 btrfsReference(const QString& image)
+{
+    const QString output = run(QStringLiteral("btrfs"), { QStringLiteral("inspect-internal"), QStringLiteral("dump-super"), image });
+    return field(output, QStringLiteral("^dev_item\\.bytes_used\\s+(\\d+)"));
+}
+
+// fsck.fat prints "<image>: <files> files, <used>/<total> clusters"
+static std::function<qint64(const QString&)> fatReference(qint64 clusterSize)
+{
+    return [clusterSize] (const QString& image) {
+        const qint64 clusters = field(run(QStringLiteral("fsck.fat"), { QStringLiteral("-n"), image }), QStringLiteral("(\\d+)/\\d+ clusters"));
+        return clusters < 0 ? -1 : clusters * clusterSize;
+    };
+}
+
+static qint64 exfatReference(const QString& image)
+{
+    const QString output = run(QStringLiteral("dump.exfat"), { image });
+    const qint64 clusters = field(output, QStringLiteral("^Cluster Count:\\s*(\\d+)"));
+    const qint64 freeClusters = field(output, QStringLiteral("^Free Clusters:\\s*(\\d+)"));
+    const qint64 bytesPerSector = field(output, QStringLiteral("^Bytes per Sector:\\s*(\\d+)"));
+    const qint64 sectorsPerCluster = field(output, QStringLiteral("^Sectors per Cluster:\\s*(\\d+)"));
+    if (clusters < 0 || freeClusters < 0 || bytesPerSector < 0 || sectorsPerCluster < 0)
+        return -1;
+
+    return (clusters - freeClusters) * bytesPerSector * sectorsPerCluster;
+}
+
+// Nothing is read from images that do not contain the file system
+static bool checkEmptyImage()
+{
+    QTemporaryFile image;
+    if (!image.open() || !image.resize(1024 * 1024)) {
+        qWarning() << "Could not create image file.";
+        return false;
+    }
+
+    const QString fileName = image.fileName();
+    const qint64 used[] = { FS::Superblock::ext2UsedCapacity(fileName), FS::Superblock::xfsUsedCapacity(fileName),
+                            FS::Superblock::btrfsUsedCapacity(fileName), FS::Superblock::fatUsedCapacity(fileName),
+                            FS::Superblock::exfatUsedCapacity(fileName), FS::Superblock::f2fsUsedCapacity(fileName) };
+    for (const qint64 capacity : used) {
+        if (capacity != -1) {
+            qWarning() << "Used capacity" << capacity << "was read from an empty image.";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication app(argc, argv);
+
+    const qint64 MiB = 1024 * 1024;
+    const QList<Result> results = {
+        check("ext4", 32 * MiB, { QStringLiteral("mkfs.ext4"), QStringLiteral("-q"), QStringLiteral("-F") },
+              ext2Reference, FS::Superblock::ext2UsedCapacity),
+        check("xfs", 512 * MiB, { QStringLiteral("mkfs.xfs"), QStringLiteral("-q"), QStringLiteral("-f") },
+              xfsReference, FS::Superblock::xfsUsedCapacity),
+        check("btrfs", 256 * MiB, { QStringLiteral("mkfs.btrfs"), QStringLiteral("-q"), QStringLiteral("-f") },
+              btrfsReference, FS::Superblock::btrfsUsedCapacity),
+        check("fat16", 32 * MiB, { QStringLiteral("mkfs.fat"), QStringLiteral("-F"), QStringLiteral("16"), QStringLiteral("-S"), QStringLiteral("512"), QStringLiteral("-s"), QStringLiteral("4") },
+              fatReference(2048), FS::Superblock::fatUsedCapacity),
+        check("fat32", 64 * MiB, { QStringLiteral("mkfs.fat"), QStringLiteral("-F"), QStringLiteral("32"), QStringLiteral("-S"), QStringLiteral("512"), QStringLiteral("-s"), QStringLiteral("1") },
+              fatReference(512), FS::Superblock::fatUsedCapacity),
+        check("exfat", 64 * MiB, { QStringLiteral("mkfs.exfat") },
+              exfatReference, FS::Superblock::exfatUsedCapacity),
+    };
+
+    bool rval = checkEmptyImage();
+    if (results.contains(Result::Failed))
+        rval = false;
+    else if (!results.contains(Result::Passed))
+        return skipped;
+
+    return rval ? 0 : 1;
+}
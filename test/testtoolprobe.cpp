@@ -0,0 +1,129 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Probes a fake tool and checks when the cached result is used and when the
+// tool is run again.
+
+#include "helpers.h"
+
+#include "fs/toolprobe.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+#include <memory>
+
+// The helper only runs whitelisted commands, so the fake tool is named like one that is never probed
+static const QString toolName = QStringLiteral("debugfs.reiser4");
+
+static QString s_Dir;
+
+/** Writes the fake tool, it prints the version and logs its arguments */
+static bool writeTool(const QByteArray& version)
+{
+    QFile tool(s_Dir + QLatin1Char('/') + toolName);
+    if (!tool.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    tool.write("#!/bin/sh\necho \"$@\" >> " + QFile::encodeName(s_Dir) + "/runs\necho version " + version + "\nexit 3\n");
+    tool.close();
+    return tool.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ExeOwner |
+                               QFileDevice::ReadGroup | QFileDevice::ExeGroup | QFileDevice::ReadOther | QFileDevice::ExeOther);
+}
+
+static int runs()
+{
+    QFile log(s_Dir + QStringLiteral("/runs"));
+    if (!log.open(QIODevice::ReadOnly))
+        return 0;
+
+    return log.readAll().count('\n');
+}
+
+static bool check(const char* name, const QStringList& args, const QByteArray& version, int expectedRuns)
+{
+    int exitCode = -1;
+    QByteArray output;
+    if (!FS::ToolProbe::probe(toolName, args, exitCode, output)) {
+        qWarning() << name << "could not probe the tool.";
+        return false;
+    }
+
+    if (exitCode != 3 || output != "version " + version + '\n' || runs() != expectedRuns) {
+        qWarning() << name << "returned" << exitCode << output << "after" << runs() << "runs, expected version" << version << "after" << expectedRuns;
+        return false;
+    }
+
+    return true;
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication app(argc, argv);
+    QStandardPaths::setTestModeEnabled(true);
+    QFile::remove(FS::ToolProbe::fileName());
+
+    std::unique_ptr<KPMCoreInitializer> i;
+    if (argc != 2) {
+        i = std::make_unique<KPMCoreInitializer>();
+        if (!i->isValid())
+            return 1;
+    } else {
+        i = std::make_unique<KPMCoreInitializer>( argv[1] );
+        if (!i->isValid())
+            return 1;
+    }
+
+    QTemporaryDir dir;
+    s_Dir = dir.path();
+    qputenv("PATH", QFile::encodeName(s_Dir) + ':' + qgetenv("PATH"));
+    if (!dir.isValid() || !writeTool("1")) {
+        qWarning() << "Could not create the fake tool.";
+        return 1;
+    }
+
+    bool rval = true;
+    rval = check("first probe", { QStringLiteral("-V") }, "1", 1) && rval;
+    rval = check("cached probe", { QStringLiteral("-V") }, "1", 1) && rval;
+
+    // Arguments are part of the key and are not merged
+    rval = check("other arguments", { QStringLiteral("-V"), QStringLiteral("-q") }, "1", 2) && rval;
+    rval = check("joined arguments", { QStringLiteral("-V -q") }, "1", 3) && rval;
+    rval = check("cached other arguments", { QStringLiteral("-V"), QStringLiteral("-q") }, "1", 3) && rval;
+
+    if (!FS::ToolProbe::save() || !QFile::exists(FS::ToolProbe::fileName())) {
+        qWarning() << "Cache was not written to" << FS::ToolProbe::fileName();
+        rval = false;
+    }
+
+    // A tool of another size is run again
+    if (!writeTool("22"))
+        return 1;
+    rval = check("changed size", { QStringLiteral("-V") }, "22", 4) && rval;
+
+    // So is a tool of the same size with another modification time
+    if (!writeTool("33"))
+        return 1;
+    QFile tool(s_Dir + QLatin1Char('/') + toolName);
+    if (!tool.open(QIODevice::ReadWrite) || !tool.setFileTime(QDateTime::currentDateTime().addSecs(3600), QFileDevice::FileModificationTime))
+        return 1;
+    tool.close();
+    rval = check("changed modification time", { QStringLiteral("-V") }, "33", 5) && rval;
+
+    int exitCode;
+    QByteArray output;
+    if (FS::ToolProbe::probe(QStringLiteral("kpmcore-no-such-tool"), {}, exitCode, output)) {
+        qWarning() << "A missing tool was probed.";
+        rval = false;
+    }
+
+    return rval ? 0 : 1;
+}
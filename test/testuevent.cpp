@@ -0,0 +1,104 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Parses uevent messages as the kernel and udev send them and checks which
+// disk and action DeviceMonitor reports for them. Needs neither root nor a
+// backend.
+
+#include "core/devicemonitor.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QtEndian>
+
+#include <cstring>
+
+// Properties of a uevent, separated by NUL characters
+static QByteArray properties(const QList<QByteArray>& pairs)
+{
+    QByteArray data;
+    for (const auto &pair : pairs)
+        data += pair + '\0';
+    return data;
+}
+
+static QByteArray kernelEvent(const QByteArray& action, const QByteArray& devPath, const QList<QByteArray>& pairs)
+{
+    return action + '@' + devPath + '\0' + properties(pairs);
+}
+
+// udev sends "libudev\0", a header in network byte order and then the properties
+static QByteArray udevEvent(const QList<QByteArray>& pairs)
+{
+    constexpr quint32 headerSize = 40;
+    const QByteArray data = properties(pairs);
+
+    QByteArray message(headerSize, '\0');
+    std::memcpy(message.data(), "libudev", 8);
+    const quint32 header[] = { qToBigEndian<quint32>(0xfeedcafe), headerSize, headerSize, static_cast<quint32>(data.size()) };
+    std::memcpy(message.data() + 8, header, sizeof(header));
+
+    return message + data;
+}
+
+static bool check(const char* name, const QByteArray& message, bool valid, const QString& deviceNode = QString(), DeviceMonitor::Action action = DeviceMonitor::Action::Change)
+{
+    QString parsedNode;
+    DeviceMonitor::Action parsedAction = DeviceMonitor::Action::Change;
+    const bool parsed = DeviceMonitor::parseEvent(message, parsedNode, parsedAction);
+
+    if (parsed != valid || (valid && (parsedNode != deviceNode || parsedAction != action))) {
+        qWarning() << name << "parsed as" << parsed << parsedNode << static_cast<int>(parsedAction)
+                   << "expected" << valid << deviceNode << static_cast<int>(action);
+        return false;
+    }
+
+    return true;
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication app(argc, argv);
+
+    bool rval = true;
+
+    const QByteArray loop = "/devices/virtual/block/loop0";
+    rval = check("kernel disk add", kernelEvent("add", loop, { "ACTION=add", "DEVPATH=" + loop, "SUBSYSTEM=block", "DEVNAME=loop0", "DEVTYPE=disk", "SEQNUM=4711" }),
+                 true, QStringLiteral("/dev/loop0"), DeviceMonitor::Action::Add) && rval;
+    rval = check("kernel disk remove", kernelEvent("remove", loop, { "ACTION=remove", "DEVPATH=" + loop, "SUBSYSTEM=block", "DEVNAME=loop0", "DEVTYPE=disk" }),
+                 true, QStringLiteral("/dev/loop0"), DeviceMonitor::Action::Remove) && rval;
+    rval = check("kernel disk change", kernelEvent("change", loop, { "ACTION=change", "DEVPATH=" + loop, "SUBSYSTEM=block", "DEVNAME=loop0", "DEVTYPE=disk" }),
+                 true, QStringLiteral("/dev/loop0"), DeviceMonitor::Action::Change) && rval;
+
+    // Partitions are reported as changes of their disk
+    const QByteArray partition = "/devices/pci0000:00/0000:00:17.0/ata1/host0/target0:0:0/0:0:0:0/block/sda/sda1";
+    rval = check("kernel partition add", kernelEvent("add", partition, { "ACTION=add", "DEVPATH=" + partition, "SUBSYSTEM=block", "DEVNAME=sda1", "DEVTYPE=partition" }),
+                 true, QStringLiteral("/dev/sda"), DeviceMonitor::Action::Change) && rval;
+
+    // "!" in kernel names stands for "/" in device nodes
+    const QByteArray cciss = "/devices/pci0000:00/0000:00:03.0/cciss0/c0d0/block/cciss!c0d0";
+    rval = check("kernel disk with slash", kernelEvent("change", cciss, { "ACTION=change", "DEVPATH=" + cciss, "SUBSYSTEM=block", "DEVNAME=cciss!c0d0", "DEVTYPE=disk" }),
+                 true, QStringLiteral("/dev/cciss/c0d0"), DeviceMonitor::Action::Change) && rval;
+
+    const QByteArray nvme = "/devices/pci0000:00/0000:00:1d.0/0000:3d:00.0/nvme/nvme0/nvme0n1";
+    rval = check("udev disk add", udevEvent({ "ACTION=add", "DEVPATH=" + nvme, "SUBSYSTEM=block", "DEVNAME=/dev/nvme0n1", "DEVTYPE=disk", "ID_MODEL=Test" }),
+                 true, QStringLiteral("/dev/nvme0n1"), DeviceMonitor::Action::Add) && rval;
+    rval = check("udev partition change", udevEvent({ "ACTION=change", "DEVPATH=" + nvme + "/nvme0n1p2", "SUBSYSTEM=block", "DEVNAME=/dev/nvme0n1p2", "DEVTYPE=partition" }),
+                 true, QStringLiteral("/dev/nvme0n1"), DeviceMonitor::Action::Change) && rval;
+
+    // Events that are not reported
+    rval = check("other subsystem", kernelEvent("add", "/devices/virtual/net/lo", { "ACTION=add", "DEVPATH=/devices/virtual/net/lo", "SUBSYSTEM=net", "INTERFACE=lo" }), false) && rval;
+    rval = check("other action", kernelEvent("bind", loop, { "ACTION=bind", "DEVPATH=" + loop, "SUBSYSTEM=block", "DEVNAME=loop0", "DEVTYPE=disk" }), false) && rval;
+    rval = check("no header", properties({ "ACTION=add", "SUBSYSTEM=block", "DEVNAME=loop0", "DEVTYPE=disk" }), false) && rval;
+    rval = check("empty", QByteArray(), false) && rval;
+
+    QByteArray truncated = udevEvent({ "ACTION=add", "SUBSYSTEM=block", "DEVNAME=/dev/sdb", "DEVTYPE=disk" });
+    truncated.chop(8);
+    rval = check("truncated udev properties", truncated, false) && rval;
+    rval = check("truncated udev header", udevEvent({}).left(20), false) && rval;
+
+    return rval ? 0 : 1;
+}
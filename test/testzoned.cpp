@@ -0,0 +1,150 @@
+/*
+    SPDX-FileCopyrightText: 2026 Andrius Štikonas <andrius@stikonas.eu>
+
+    SPDX-License-Identifier: GPL-3.0-or-later
+*/
+
+// Creates a host-managed zoned null_blk device and checks zone detection,
+// partition alignment to zones and copying to sequential zones.
+
+#include "helpers.h"
+
+#include "backend/corebackend.h"
+#include "backend/corebackendmanager.h"
+#include "core/copysourcefile.h"
+#include "core/copytargetdevice.h"
+#include "core/device.h"
+#include "core/partitionalignment.h"
+#include "util/externalcommand.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QTemporaryFile>
+
+#include <memory>
+
+static const QString nullbPath = QStringLiteral("/sys/kernel/config/nullb/kpmcoretest");
+static const qint64 zoneSize = 16 * 1024 * 1024;
+
+static bool writeAttribute(const QString& attribute, const QByteArray& value)
+{
+    QFile file(nullbPath + QLatin1Char('/') + attribute);
+    return file.open(QIODevice::WriteOnly) && file.write(value) == value.size();
+}
+
+// 256 MiB device with 16 MiB sequential zones, @return its device node or an empty string
+static QString createZonedDevice()
+{
+    QProcess modprobe;
+    modprobe.start(QStringLiteral("modprobe"), { QStringLiteral("null_blk"), QStringLiteral("nr_devices=0") });
+    modprobe.waitForFinished();
+
+    if (!QDir().mkdir(nullbPath))
+        return QString();
+
+    if (!writeAttribute(QStringLiteral("size"), "256") ||
+        !writeAttribute(QStringLiteral("memory_backed"), "1") ||
+        !writeAttribute(QStringLiteral("zoned"), "1") ||
+        !writeAttribute(QStringLiteral("zone_size"), "16") ||
+        !writeAttribute(QStringLiteral("zone_nr_conv"), "0") ||
+        !writeAttribute(QStringLiteral("power"), "1"))
+        return QString();
+
+    QFile index(nullbPath + QStringLiteral("/index"));
+    if (!index.open(QIODevice::ReadOnly))
+        return QString();
+
+    return QStringLiteral("/dev/nullb") + QString::fromLatin1(index.readAll().trimmed());
+}
+
+static void removeZonedDevice()
+{
+    writeAttribute(QStringLiteral("power"), "0");
+    QDir().rmdir(nullbPath);
+}
+
+static bool copyFile(Device& device, const QString& fileName, qint64 size)
+{
+    CopySourceFile source(fileName);
+    CopyTargetDevice target(device, zoneSize, zoneSize + size - 1);
+    if (!source.open() || !target.open())
+        return false;
+
+    ExternalCommand cmd;
+    return cmd.copyBlocks(source, target);
+}
+
+int main( int argc, char **argv )
+{
+    QCoreApplication app(argc, argv);
+    std::unique_ptr<KPMCoreInitializer> i;
+
+    if (argc != 2) {
+        i = std::make_unique<KPMCoreInitializer>();
+        if (!i->isValid())
+            return 1;
+    } else {
+        i = std::make_unique<KPMCoreInitializer>( argv[1] );
+        if (!i->isValid())
+            return 1;
+    }
+
+    const QString deviceNode = createZonedDevice();
+    if (deviceNode.isEmpty()) {
+        qDebug() << "Could not create zoned null_blk device (needs root and null_blk), skipping.";
+        removeZonedDevice();
+        return 0;
+    }
+
+    std::unique_ptr<Device> device(CoreBackendManager::self()->backend()->scanDevice(deviceNode));
+    if (!device) {
+        qWarning() << "Could not scan" << deviceNode;
+        removeZonedDevice();
+        return 1;
+    }
+
+    int rval = 0;
+    if (device->zoneModel() != Device::ZoneModel::HostManaged || device->zoneSize() != zoneSize || device->zoneCount() != 16) {
+        qWarning() << "Wrong zone information for" << deviceNode << device->zoneSize() << device->zoneCount();
+        rval = 1;
+    }
+
+    if (PartitionAlignment::sectorAlignment(*device) % (zoneSize / device->logicalSize()) != 0) {
+        qWarning() << "Sector alignment" << PartitionAlignment::sectorAlignment(*device) << "is not a multiple of the zone size.";
+        rval = 1;
+    }
+
+    // 1.5 zones, so the second zone is left partially written
+    QTemporaryFile data;
+    QByteArray pattern(zoneSize * 3 / 2, 0);
+    for (auto &byte : pattern)
+        byte = static_cast<char>(QRandomGenerator::global()->bounded(256));
+    if (!data.open() || data.write(pattern) != pattern.size() || !data.flush()) {
+        qWarning() << "Could not create data file.";
+        removeZonedDevice();
+        return 1;
+    }
+
+    // Copying twice to the same zones only works if they are reset before writing
+    for (int pass = 0; pass < 2 && rval == 0; ++pass) {
+        if (!copyFile(*device, data.fileName(), pattern.size())) {
+            qWarning() << "Copying to zoned device failed in pass" << pass;
+            rval = 1;
+        }
+    }
+
+    QFile zoned(deviceNode);
+    if (rval == 0 && (!zoned.open(QIODevice::ReadOnly) || !zoned.seek(zoneSize) || zoned.read(pattern.size()) != pattern)) {
+        qWarning() << "Data read back from" << deviceNode << "does not match.";
+        rval = 1;
+    }
+    zoned.close();
+
+    device.reset();
+    removeZonedDevice();
+    return rval;
+}